@@ -0,0 +1,480 @@
+/*
+   Headless planner benchmark and sanity check (no Qt, no GL)
+ */
+
+#include "consts.h"
+#include "fleet.h"
+#include "manager.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+
+static double now()
+{
+   return chrono::duration<double>(
+          chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void printUsage()
+{
+   cout << "Usage: decompose_bench (-w world_size) (-b max_boxes) (-n scenes) (-s seed) (-t max_threads)" << endl;
+   cout << "   Where" << endl;
+   cout << "         -w    World width and height (default 1000000)" << endl;
+   cout << "         -b    Largest number of boxes to time (default 1000)" << endl;
+   cout << "         -n    Number of random scenes to verify (default 20)" << endl;
+   cout << "         -s    Random seed (default 1)" << endl;
+   cout << "         -t    Most delta-stepping threads to time (default 64)" << endl;
+}
+
+// Consecutive path cells must be valid, collision free and share part of a
+// side, and the reported cost must be the sum of the edge weights
+static bool checkPath(Manager* manager)
+{
+   const Path& path = manager->getPath();
+   Cost sum = 0;
+   for (int i = 0; i < path.size(); i++)
+   {
+      if (!path[i].isValid || manager->isCollision(path[i].pos) != -1)
+         return false;
+      if (i == 0)
+         continue;
+
+      const Cell& a = path[i-1];
+      const Cell& b = path[i];
+      bool sideBySide = (a.R == b.L || b.R == a.L) && min(a.B, b.B) > max(a.T, b.T);
+      bool stacked    = (a.B == b.T || b.B == a.T) && min(a.R, b.R) > max(a.L, b.L);
+      if (!sideBySide && !stacked)
+         return false;
+      sum += Manager::distance(a.pos, b.pos);
+   }
+   return sum == manager->getPathCost();
+}
+
+// Sample points along every segment of a polyline, none may be strictly
+// inside an inflated obstacle (independent of the slab test)
+static bool checkSegments(Manager* manager, const Waypoints& points)
+{
+   const Obstacles& obstacles = manager->getObstacles();
+   for (int i = 1; i < points.size(); i++)
+   {
+      for (int s = 0; s <= 64; s++)
+      {
+         double x = points[i-1].X + (points[i].X - points[i-1].X) * s / 64.0;
+         double y = points[i-1].Y + (points[i].Y - points[i-1].Y) * s / 64.0;
+         for (int j = 0; j < obstacles.size(); j++)
+            if ( obstacles[j].L < x && x < obstacles[j].R &&
+                 obstacles[j].T < y && y < obstacles[j].B )
+               return false;
+      }
+   }
+   return true;
+}
+
+static bool plan(Manager* manager, const Scene& scene)
+{
+   loadScene(manager, scene);
+   manager->generatePath();
+   return manager->getPathNodesLength() > 0;
+}
+
+int main(int argc, char* argv[])
+{
+   int world    = 1000000;
+   int maxBoxes = 1000;
+   int scenes   = 20;
+   unsigned int seed = 1;
+   int maxThreads = 64;
+
+   int c = 0;
+   while((c = getopt (argc, argv, "w:b:n:s:t:")) != -1)
+   switch(c)
+   {
+      case 'w':
+         world = atoi(optarg);
+         break;
+      case 'b':
+         maxBoxes = atoi(optarg);
+         break;
+      case 'n':
+         scenes = atoi(optarg);
+         break;
+      case 's':
+         seed = atoi(optarg);
+         break;
+      case 't':
+         maxThreads = atoi(optarg);
+         break;
+      default:
+         printUsage();
+         exit(1);
+   }
+
+   Manager manager;
+   int failures = 0;
+
+   // Correctness: a scene scaled up to the large world must give the same
+   // path (same cells, in the same order) at a proportionally larger cost
+   int base   = 1000;
+   int factor = max(1, world / base);
+   cout << "Verifying " << scenes << " scenes, " << base << " -> "
+        << base*factor << " world" << endl;
+   for (int i = 0; i < scenes; i++)
+   {
+      Scene small = generateScene(base, base, 20, seed + i);
+      Scene large = scaleScene(small, factor);
+
+      bool foundSmall = plan(&manager, small);
+      Cost costSmall  = manager.getPathCost();
+      int  lenSmall   = manager.getPathNodesLength();
+      bool validSmall = checkPath(&manager);
+
+      bool foundLarge = plan(&manager, large);
+      Cost costLarge  = manager.getPathCost();
+      int  lenLarge   = manager.getPathNodesLength();
+      bool validLarge = checkPath(&manager);
+
+      bool ok = (foundSmall == foundLarge) && validSmall && validLarge;
+      if (ok && foundSmall)
+      {
+         // cell centers round to whole units, so allow a little slack
+         // (robot and dest in the same cell cost nothing at any scale)
+         double ratio = costSmall == 0 ? (costLarge == 0 ? 1.0 : 0.0) :
+                        (double) costLarge / ((double) costSmall * factor);
+         ok = (lenSmall == lenLarge) && fabs(ratio - 1.0) < 0.01 &&
+              costLarge >= 0 && costLarge < COST_INF;
+      }
+      if (!ok)
+      {
+         cout << "   FAIL scene " << i << " (seed " << seed + i << "): "
+              << "cost " << costSmall << " vs " << costLarge
+              << ", length " << lenSmall << " vs " << lenLarge << endl;
+         failures++;
+      }
+   }
+   cout << "   " << scenes - failures << "/" << scenes << " passed" << endl;
+
+   // Performance on the large world
+   cout << endl << "Planning on a " << world << " x " << world << " world" << endl;
+   printf("%8s %10s %12s %12s %14s\n", "boxes", "cells", "plan (ms)", "path cells", "cost");
+   for (int boxes = 10; boxes <= maxBoxes; boxes *= 10)
+   {
+      Scene scene = generateScene(world, world, boxes, seed);
+      double start = now();
+      plan(&manager, scene);
+      double elapsed = now() - start;
+      printf("%8d %10d %12.2f %12d %14.1f\n", boxes, manager.getNumNodes(),
+             elapsed * 1000, manager.getPathNodesLength(),
+             manager.getPathNodesLength() > 0 ?
+               (double) manager.getPathCost() / COST_SCALE : -1.0);
+   }
+
+   // Adaptive quadtree against the exact grid: far fewer cells, a path that
+   // is valid but only approximately shortest
+   cout << endl << "Quadtree decomposition (min cell = robot radius)" << endl;
+   printf("%8s %10s %10s %12s %12s %14s %8s\n", "boxes", "grid cells", "leaves",
+          "grid (ms)", "quad (ms)", "cost ratio", "valid");
+   for (int boxes = 10; boxes <= maxBoxes; boxes *= 10)
+   {
+      Scene scene = generateScene(world, world, boxes, seed);
+      manager.clearCells(); // do not time freeing the last decomposition
+      double start = now();
+      bool found = plan(&manager, scene);
+      double grid = now() - start;
+      int gridCells = manager.getNumNodes();
+      Cost gridCost = manager.getPathCost();
+
+      manager.setDecomposition(Manager::DECOMP_QUADTREE); // also clears
+      start = now();
+      bool quadFound = plan(&manager, scene);
+      double quad = now() - start;
+      bool valid = quadFound && checkPath(&manager);
+      if (quadFound && !valid)
+         failures++;
+
+      char ratio[32] = "-";
+      if (found && quadFound && gridCost > 0)
+         snprintf(ratio, sizeof(ratio), "%.3f", (double) manager.getPathCost() / gridCost);
+      printf("%8d %10d %10d %12.2f %12.2f %14s %8s\n", boxes, gridCells,
+             manager.getNumNodes(), grid * 1000, quad * 1000, ratio,
+             !quadFound ? "no path" : valid ? "yes" : "NO");
+      manager.setDecomposition(Manager::DECOMP_GRID);
+   }
+
+   // Shortcutting the cell center zig-zag
+   cout << endl << "Path smoothing" << endl;
+   printf("%8s %10s %10s %14s %14s %12s %8s\n", "boxes", "waypoints", "smoothed",
+          "length", "smoothed", "smooth (ms)", "valid");
+   for (int boxes = 10; boxes <= maxBoxes; boxes *= 10)
+   {
+      Scene scene = generateScene(world, world, boxes, seed);
+      if (!plan(&manager, scene))
+         continue;
+
+      double start = now();
+      manager.smoothPath();
+      double elapsed = now() - start;
+      bool valid = checkSegments(&manager, manager.getSmoothedPath());
+      if (!valid)
+         failures++;
+
+      Waypoints raw = manager.getWaypoints();
+      printf("%8d %10d %10d %14.1f %14.1f %12.3f %8s\n", boxes, (int) raw.size(),
+             (int) manager.getSmoothedPath().size(), Smoother::length(raw),
+             Smoother::length(manager.getSmoothedPath()), elapsed * 1000,
+             valid ? "yes" : "NO");
+   }
+
+   // Path following, fast-forwarded: a robot crossing the world in about
+   // ten seconds at 100 ticks per second
+   {
+      int boxes = min(100, maxBoxes);
+      Scene scene = generateScene(world, world, boxes, seed);
+      plan(&manager, scene);
+      manager.setSpeed(world / 10.0);
+      manager.setTickRate(100);
+
+      int traversals = 0;
+      long long ticks = 0;
+      bool arrived = true;
+      double start = now();
+      double elapsed = 0;
+      while (elapsed < 0.5)
+      {
+         manager.startFollowing();
+         ticks += manager.fastForward();
+         arrived = arrived && manager.getRobot().X == scene.dest.X &&
+                              manager.getRobot().Y == scene.dest.Y;
+         traversals++;
+         elapsed = now() - start;
+      }
+      if (!arrived)
+         failures++;
+
+      cout << endl << "Path following, " << boxes << " boxes, "
+           << manager.getWaypoints().size() << " waypoints" << endl;
+      printf("%12s %14s %14s %14s %8s\n", "traversals", "ticks each",
+             "traversals/s", "ticks/s", "arrived");
+      printf("%12d %14.1f %14.0f %14.0f %8s\n", traversals, (double) ticks / traversals,
+             traversals / elapsed, ticks / elapsed, arrived ? "yes" : "NO");
+      manager.setRobot(scene.robot);
+   }
+
+   // Sampled roadmap: built once per scene, then queried for many robots
+   cout << endl << "Roadmap (PRM), 20000 samples, 20 queries per scene" << endl;
+   printf("%8s %8s %8s %12s %12s %8s %12s %10s %8s\n", "boxes", "nodes", "edges",
+          "build (ms)", "reuse (ms)", "found", "query (ms)", "vs grid", "valid");
+   for (int boxes = 100; boxes <= maxBoxes; boxes *= 10)
+   {
+      Scene scene = generateScene(world, world, boxes, seed);
+      vector<Position> starts, goals;
+      generateRobots(scene, 20, seed, starts, goals);
+
+      // the grid's optimal cost for the first query, for comparison
+      loadScene(&manager, scene);
+      manager.setRobot(starts[0]);
+      manager.setDest(goals[0]);
+      manager.generatePath();
+      Cost gridCost = manager.getPathCost();
+
+      manager.setDecomposition(Manager::DECOMP_PRM);
+      manager.setRoadmapSamples(20000);
+      double start = now();
+      manager.generatePath();
+      double build = now() - start;
+      Cost prmCost = manager.getPathCost();
+      start = now();
+      manager.generatePath();
+      double reuse = now() - start;
+
+      int found = 0;
+      bool valid = true;
+      start = now();
+      for (int i = 0; i < starts.size(); i++)
+      {
+         manager.setRobot(starts[i]);
+         manager.setDest(goals[i]);
+         manager.generatePath();
+         if (manager.getPathCost() == COST_INF)
+            continue;
+         found++;
+         valid = valid && checkSegments(&manager, manager.getWaypoints());
+      }
+      double query = (now() - start) / starts.size();
+      if (!valid)
+         failures++;
+
+      char ratio[32] = "-";
+      if (gridCost != COST_INF && prmCost != COST_INF && gridCost > 0)
+         snprintf(ratio, sizeof(ratio), "%.3f", (double) prmCost / gridCost);
+      printf("%8d %8d %8d %12.2f %12.2f %5d/%-2d %12.3f %10s %8s\n", boxes,
+             manager.getRoadmap().numNodes(), manager.getRoadmap().numEdges(),
+             build * 1000, reuse * 1000, found, (int) starts.size(), query * 1000,
+             ratio, valid ? "yes" : "NO");
+      manager.setDecomposition(Manager::DECOMP_GRID);
+   }
+
+   // Visibility graph: swept once per scene, queries only sweep their ends;
+   // its paths are truly shortest, so never longer than the grid's
+   cout << endl << "Visibility graph, 20 queries per scene" << endl;
+   printf("%8s %8s %8s %12s %8s %12s %10s %8s\n", "boxes", "nodes", "edges",
+          "build (ms)", "found", "query (ms)", "vs grid", "valid");
+   for (int boxes = 100; boxes <= maxBoxes; boxes *= 10)
+   {
+      Scene scene = generateScene(world, world, boxes, seed);
+      vector<Position> starts, goals;
+      generateRobots(scene, 20, seed, starts, goals);
+
+      loadScene(&manager, scene);
+      manager.setRobot(starts[0]);
+      manager.setDest(goals[0]);
+      manager.generatePath();
+      Cost gridCost = manager.getPathCost();
+
+      manager.setDecomposition(Manager::DECOMP_VISIBILITY);
+      double start = now();
+      manager.generatePath();
+      double build = now() - start;
+      Cost visCost = manager.getPathCost();
+
+      int found = 0;
+      bool valid = gridCost == COST_INF || visCost <= gridCost;
+      start = now();
+      for (int i = 0; i < starts.size(); i++)
+      {
+         manager.setRobot(starts[i]);
+         manager.setDest(goals[i]);
+         manager.generatePath();
+         if (manager.getPathCost() == COST_INF)
+            continue;
+         found++;
+         valid = valid && checkSegments(&manager, manager.getWaypoints());
+      }
+      double query = (now() - start) / starts.size();
+      if (!valid)
+         failures++;
+
+      char ratio[32] = "-";
+      if (gridCost != COST_INF && visCost != COST_INF && gridCost > 0)
+         snprintf(ratio, sizeof(ratio), "%.3f", (double) visCost / gridCost);
+      printf("%8d %8d %8d %12.2f %5d/%-2d %12.3f %10s %8s\n", boxes,
+             manager.getVisibilityGraph().numNodes(), manager.getVisibilityGraph().numEdges(),
+             build * 1000, found, (int) starts.size(), query * 1000,
+             ratio, valid ? "yes" : "NO");
+      manager.setDecomposition(Manager::DECOMP_GRID);
+   }
+
+   // Delta-stepping against Dijkstra on the largest scene: every node
+   // closer than dest must get the same distance, and the same path
+   {
+      Scene scene = generateScene(world, world, maxBoxes, seed);
+      plan(&manager, scene);
+      const Nodes& nodes = manager.getNodes();
+
+      manager.setSearch(Manager::SEARCH_DIJKSTRA);
+      double start = now();
+      manager.search();
+      double serial = now() - start;
+      Cost target   = manager.getPathCost();
+      Path expected = manager.getPath();
+      vector<Cost> dists(nodes.size());
+      for (int i = 0; i < nodes.size(); i++)
+         dists[i] = nodes[i]->dist;
+
+      cout << endl << "Delta-stepping on " << nodes.size() << " cells ("
+           << thread::hardware_concurrency() << " hardware threads)" << endl;
+      printf("%8s %12s %10s %8s\n", "threads", "search (ms)", "speedup", "same");
+      printf("%8s %12.2f %10.2f %8s\n", "dijkstra", serial * 1000, 1.0, "-");
+
+      manager.setSearch(Manager::SEARCH_DELTA_STEPPING);
+      for (int t = 1; t <= maxThreads; t *= 2)
+      {
+         manager.setThreads(t);
+         manager.search(); // warm up the pool
+         start = now();
+         manager.search();
+         double elapsed = now() - start;
+
+         bool same = manager.getPathCost() == target &&
+                     manager.getPathNodesLength() == expected.size();
+         for (int i = 0; same && i < expected.size(); i++)
+            same = manager.getPath()[i] == expected[i];
+         for (int i = 0; same && i < nodes.size(); i++)
+            if (dists[i] < target)
+               same = nodes[i]->dist == dists[i];
+         if (!same)
+            failures++;
+
+         printf("%8d %12.2f %10.2f %8s\n", t, elapsed * 1000,
+                serial / elapsed, same ? "yes" : "NO");
+      }
+      manager.setSearch(Manager::SEARCH_DIJKSTRA);
+   }
+
+   // Prioritized multi-robot planning on one shared decomposition
+   {
+      int boxes = min(100, maxBoxes);
+      Scene scene = generateScene(world, world, boxes, seed);
+      loadScene(&manager, scene);
+      manager.clearCells();
+      manager.decompose();
+      manager.connectCells();
+
+      cout << endl << "Multi-robot planning, " << boxes << " boxes, "
+           << manager.getNumNodes() << " cells" << endl;
+      printf("%8s %8s %10s %10s %12s %12s\n", "robots", "planned", "makespan",
+             "conflicts", "plan (ms)", "robots/s");
+      for (int robots = 10; robots <= 100; robots *= 2)
+      {
+         vector<Position> starts, goals;
+         generateRobots(scene, robots, seed, starts, goals);
+         Fleet fleet(&manager);
+         for (int i = 0; i < robots; i++)
+            fleet.addRobot(starts[i], goals[i]);
+
+         double start = now();
+         int planned = fleet.plan();
+         double elapsed = now() - start;
+         int conflicts = fleet.countConflicts();
+         if (conflicts > 0)
+            failures++;
+
+         printf("%8d %8d %10d %10d %12.2f %12.1f\n", robots, planned,
+                fleet.getMakespan(), conflicts, elapsed * 1000, planned / elapsed);
+      }
+   }
+
+   // Configuration space: a mixed fleet re-plans with a few radii, the
+   // inflated and merged obstacles are only built once per radius
+   Scene scene = generateScene(world, world, maxBoxes, seed);
+   loadScene(&manager, scene);
+   int radii[3] = { scene.robotRadius, scene.robotRadius * 2, scene.robotRadius * 4 };
+   cout << endl << "C-space for " << maxBoxes << " boxes" << endl;
+   printf("%8s %10s %14s %14s\n", "radius", "obstacles", "first (ms)", "cached (ms)");
+   for (int i = 0; i < 3; i++)
+   {
+      manager.setRobotRadius(radii[i]);
+      double start = now();
+      int count = manager.getObstacles().size();
+      double first = now() - start;
+
+      // switch away and back: the cache should make this free
+      manager.setRobotRadius(radii[(i+1) % 3]);
+      manager.setRobotRadius(radii[i]);
+      start = now();
+      manager.getObstacles();
+      double cached = now() - start;
+      printf("%8d %10d %14.3f %14.3f\n", radii[i], count, first * 1000, cached * 1000);
+   }
+
+   return failures == 0 ? 0 : 1;
+}
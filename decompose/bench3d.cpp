@@ -0,0 +1,177 @@
+/*
+   Headless 3D planner benchmark and sanity check (no Qt, no GL)
+ */
+
+#include "consts.h"
+#include "planner3d.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <unistd.h>
+
+using namespace std;
+
+
+static double now()
+{
+   return chrono::duration<double>(
+          chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void printUsage()
+{
+   cout << "Usage: decompose_bench3d (-w world_size) (-b max_boxes) (-n scenes) (-s seed) (-t threads)" << endl;
+   cout << "   Where" << endl;
+   cout << "         -w    World width, height and depth (default 100000)" << endl;
+   cout << "         -b    Largest number of cubes to time (default 1000)" << endl;
+   cout << "         -n    Number of random scenes to verify (default 20)" << endl;
+   cout << "         -s    Random seed (default 1)" << endl;
+   cout << "         -t    Delta-stepping threads (default 0 = one per core)" << endl;
+}
+
+// Consecutive path cells must be free, collision free and share part of a
+// face, and the reported cost must be the sum of the edge weights
+static bool checkPath(Planner3D* planner)
+{
+   const Path3& path = planner->getPath();
+   Cost sum = 0;
+   for (int i = 0; i < path.size(); i++)
+   {
+      if (!path[i].isValid || planner->isCollision(path[i].pos) != -1)
+         return false;
+      if (i == 0)
+         continue;
+
+      const Cell3& a = path[i-1];
+      const Cell3& b = path[i];
+      bool overlapX = min(a.R, b.R) > max(a.L, b.L);
+      bool overlapY = min(a.B, b.B) > max(a.T, b.T);
+      bool overlapZ = min(a.F, b.F) > max(a.N, b.N);
+      bool touchX = a.R == b.L || b.R == a.L;
+      bool touchY = a.B == b.T || b.B == a.T;
+      bool touchZ = a.F == b.N || b.F == a.N;
+      if ( !(touchX && overlapY && overlapZ) &&
+           !(touchY && overlapX && overlapZ) &&
+           !(touchZ && overlapX && overlapY) )
+         return false;
+      sum += Planner3D::distance(a.pos, b.pos);
+   }
+   return sum == planner->getPathCost();
+}
+
+int main(int argc, char* argv[])
+{
+   int world    = 100000;
+   int maxBoxes = 1000;
+   int scenes   = 20;
+   unsigned int seed = 1;
+   int threads  = 0;
+
+   int c = 0;
+   while((c = getopt (argc, argv, "w:b:n:s:t:")) != -1)
+   switch(c)
+   {
+      case 'w':
+         world = atoi(optarg);
+         break;
+      case 'b':
+         maxBoxes = atoi(optarg);
+         break;
+      case 'n':
+         scenes = atoi(optarg);
+         break;
+      case 's':
+         seed = atoi(optarg);
+         break;
+      case 't':
+         threads = atoi(optarg);
+         break;
+      default:
+         printUsage();
+         exit(1);
+   }
+
+   Planner3D planner;
+   planner.setThreads(threads);
+   int failures = 0;
+
+   // Correctness: valid paths, and delta-stepping must agree with Dijkstra
+   cout << "Verifying " << scenes << " 3D scenes of 50 cubes" << endl;
+   int found = 0;
+   for (int i = 0; i < scenes; i++)
+   {
+      Scene3 scene = generateScene3(world, world, world, 50, seed + i);
+      loadScene(&planner, scene);
+      planner.setSearch(Manager::SEARCH_DIJKSTRA);
+      planner.generatePath();
+      Cost cost = planner.getPathCost();
+      Path3 expected = planner.getPath();
+      bool ok = checkPath(&planner);
+
+      planner.setSearch(Manager::SEARCH_DELTA_STEPPING);
+      planner.search();
+      ok = ok && planner.getPathCost() == cost &&
+           planner.getPath().size() == expected.size();
+      for (int j = 0; ok && j < expected.size(); j++)
+         ok = planner.getPath()[j] == expected[j];
+
+      if (!expected.empty())
+         found++;
+      if (!ok)
+      {
+         cout << "   FAIL scene " << i << " (seed " << seed + i << ")" << endl;
+         failures++;
+      }
+   }
+   cout << "   " << scenes - failures << "/" << scenes << " passed, "
+        << found << " with a path" << endl;
+
+   cout << endl << "Planning on a " << world << "^3 world" << endl;
+   printf("%8s %10s %12s %12s %12s %10s %14s\n", "boxes", "leaves", "plan (ms)",
+          "dijkstra", "delta-step", "path", "cost");
+   for (int boxes = 10; boxes <= maxBoxes; boxes *= 10)
+   {
+      Scene3 scene = generateScene3(world, world, world, boxes, seed);
+      loadScene(&planner, scene);
+      planner.clearCells(); // do not time freeing the last decomposition
+
+      planner.setSearch(Manager::SEARCH_DIJKSTRA);
+      double start = now();
+      planner.generatePath();
+      double plan = now() - start;
+      Path3 expected = planner.getPath();
+
+      // the searches alone, on the same octree
+      double serial = 0, parallel = 0;
+      if (!expected.empty())
+      {
+         start = now();
+         planner.search();
+         serial = now() - start;
+
+         planner.setSearch(Manager::SEARCH_DELTA_STEPPING);
+         planner.search(); // warm up the pool
+         start = now();
+         planner.search();
+         parallel = now() - start;
+         if (planner.getPath().size() != expected.size() || !checkPath(&planner))
+            failures++;
+      }
+      else
+      {
+         cout << "   FAIL no path with " << boxes << " cubes" << endl;
+         failures++;
+      }
+
+      printf("%8d %10d %12.2f %12.2f %12.2f %10d %14.1f\n", boxes,
+             planner.getNumNodes(), plan * 1000, serial * 1000, parallel * 1000,
+             (int) expected.size(),
+             expected.empty() ? -1.0 : (double) planner.getPathCost() / COST_SCALE);
+   }
+
+   return failures == 0 ? 0 : 1;
+}
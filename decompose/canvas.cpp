@@ -3,16 +3,7 @@
 #include "consts.h"
 #include "manager.h"
 
-#ifdef __APPLE__
-#include <GLUT/glut.h>
-#include <OpenGL/gl.h>
-#elif __linux__
-#include <GL/glut.h>
-#include <GL/gl.h>
-#else
-#include <gl/glut.h>
-#include <gl/gl.h>
-#endif
+#include <QOpenGLShaderProgram>
 
 #include <math.h>
 #include <stdio.h>
@@ -23,216 +14,563 @@
 using namespace std;
 
 
-   Canvas::Canvas(Manager* _man) 
-:manager(_man)
+// Shared layout for both programs:
+//    location 0 = position, 1 = color, 2 = dist (lines) / radius (points)
+static const char* LINE_VERT_SRC =
+   "#version 330 core\n"
+   "layout(location = 0) in vec2  vertPos;\n"
+   "layout(location = 1) in vec3  vertColor;\n"
+   "layout(location = 2) in float vertDist;\n"
+   "uniform mat4 mvp;\n"
+   "out vec3  fragColor;\n"
+   "out float fragDist;\n"
+   "void main() {\n"
+   "   gl_Position = mvp * vec4(vertPos, 0.0, 1.0);\n"
+   "   fragColor   = vertColor;\n"
+   "   fragDist    = vertDist;\n"
+   "}\n";
+
+// dashScale (pixels per world unit) > 0 emulates the old
+// glLineStipple(1, 0x8888) pattern: one pixel on, three pixels off
+static const char* LINE_FRAG_SRC =
+   "#version 330 core\n"
+   "in vec3  fragColor;\n"
+   "in float fragDist;\n"
+   "uniform float dashScale;\n"
+   "uniform float opacity;\n"
+   "out vec4 outColor;\n"
+   "void main() {\n"
+   "   if (dashScale > 0.0 && mod(fragDist * dashScale, 4.0) >= 1.0)\n"
+   "      discard;\n"
+   "   outColor = vec4(fragColor, opacity);\n"
+   "}\n";
+
+// every attribute is per-instance, the single "vertex" is the sprite itself
+static const char* POINT_VERT_SRC =
+   "#version 330 core\n"
+   "layout(location = 0) in vec2  instPos;\n"
+   "layout(location = 1) in vec3  instColor;\n"
+   "layout(location = 2) in float instRadius;\n"
+   "uniform mat4  mvp;\n"
+   "uniform float pixelScale;\n"
+   "out vec3 fragColor;\n"
+   "void main() {\n"
+   "   gl_Position  = mvp * vec4(instPos, 0.0, 1.0);\n"
+   "   gl_PointSize = max(2.0 * instRadius * pixelScale, 1.0);\n"
+   "   fragColor    = instColor;\n"
+   "}\n";
+
+static const char* POINT_FRAG_SRC =
+   "#version 330 core\n"
+   "in vec3 fragColor;\n"
+   "out vec4 outColor;\n"
+   "void main() {\n"
+   "   vec2 c = gl_PointCoord * 2.0 - 1.0;\n"
+   "   if (dot(c, c) > 1.0)\n"
+   "      discard;\n"
+   "   outColor = vec4(fragColor, 1.0);\n"
+   "}\n";
+
+// primitive used to draw each line layer
+static const GLenum LAYER_MODES[Canvas::NUM_LINE_LAYERS] = {
+   GL_TRIANGLES,     // LAYER_SCENE
+   GL_LINES,         // LAYER_BORDERS
+   GL_LINES,         // LAYER_MARKERS
+   GL_LINE_STRIP,    // LAYER_PATH
+   GL_TRIANGLES      // LAYER_REGIONS
+};
+
+// vertices per cell in the border layer, and per bucket in the region layer
+const int BORDER_VERTS = 4;
+const int REGION_VERTS = 6;
+
+const double MIN_ZOOM = 0.5;
+const double MAX_ZOOM = 4096;
+
+
+   Canvas::Canvas(Manager* _man)
+:manager(_man),
+gl(NULL),
+lineProgram(NULL),
+pointProgram(NULL),
+pixelScale(1.0f),
+viewW(WIDTH),
+viewH(HEIGHT),
+viewX(0),
+viewY(0),
+zoom(1),
+lodMode(LOD_AUTO),
+uploadedRevision(0),
+uploadedMotion(0),
+uploaded(false)
 {
+   memset(lineVAO,  0, sizeof(lineVAO));
+   memset(lineVBO,  0, sizeof(lineVBO));
+   memset(pointVAO, 0, sizeof(pointVAO));
+   memset(pointVBO, 0, sizeof(pointVBO));
 }
 
 Canvas::~Canvas()
 {
+   delete lineProgram;
+   delete pointProgram;
 }
 
-void Canvas::init ( void )
+// Set up one vertex array: position, color and dist/radius,
+// advancing once per vertex (divisor 0) or once per instance (divisor 1).
+// first skips that many elements, since instanced draws in GL 3.3 cannot
+// start at a base instance.
+static void setupAttribs(QOpenGLFunctions_3_3_Core* gl, GLuint divisor, int first = 0)
 {
-   glMatrixMode(GL_PROJECTION);
-   glLoadIdentity();
-   glOrtho(0.0, WIDTH-1, HEIGHT-1, 0, -1.0, 1.0);
-   glMatrixMode(GL_MODELVIEW);
+   GLsizei stride = sizeof(CanvasVertex);
+   char*   base   = (char*) 0 + first * stride;
+   gl->glEnableVertexAttribArray(0);
+   gl->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, base);
+   gl->glEnableVertexAttribArray(1);
+   gl->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, base + 2*sizeof(GLfloat));
+   gl->glEnableVertexAttribArray(2);
+   gl->glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, base + 5*sizeof(GLfloat));
+   gl->glVertexAttribDivisor(0, divisor);
+   gl->glVertexAttribDivisor(1, divisor);
+   gl->glVertexAttribDivisor(2, divisor);
 }
 
-void Canvas::drawBox(int boxNum)
+void Canvas::init(QOpenGLFunctions_3_3_Core* _gl)
 {
-   int X = manager->getBox(boxNum).pos.X;
-   int Y = manager->getBox(boxNum).pos.Y;
-	int boxRadius = manager->getBox(boxNum).size;
+   gl = _gl;
+
+   lineProgram = new QOpenGLShaderProgram();
+   lineProgram->addShaderFromSourceCode(QOpenGLShader::Vertex,   LINE_VERT_SRC);
+   lineProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, LINE_FRAG_SRC);
+   if (!lineProgram->link())
+      cout << "ERROR: line shader: " << lineProgram->log().toStdString() << endl;
+
+   pointProgram = new QOpenGLShaderProgram();
+   pointProgram->addShaderFromSourceCode(QOpenGLShader::Vertex,   POINT_VERT_SRC);
+   pointProgram->addShaderFromSourceCode(QOpenGLShader::Fragment, POINT_FRAG_SRC);
+   if (!pointProgram->link())
+      cout << "ERROR: point shader: " << pointProgram->log().toStdString() << endl;
+
+   // CanvasPoint and CanvasVertex share a layout, so one attrib setup fits both
+   gl->glGenVertexArrays(NUM_LINE_LAYERS, lineVAO);
+   gl->glGenBuffers(NUM_LINE_LAYERS, lineVBO);
+   for (int i = 0; i < NUM_LINE_LAYERS; i++)
+   {
+      gl->glBindVertexArray(lineVAO[i]);
+      gl->glBindBuffer(GL_ARRAY_BUFFER, lineVBO[i]);
+      setupAttribs(gl, 0);
+   }
+
+   gl->glGenVertexArrays(NUM_POINT_LAYERS, pointVAO);
+   gl->glGenBuffers(NUM_POINT_LAYERS, pointVBO);
+   for (int i = 0; i < NUM_POINT_LAYERS; i++)
+   {
+      gl->glBindVertexArray(pointVAO[i]);
+      gl->glBindBuffer(GL_ARRAY_BUFFER, pointVBO[i]);
+      setupAttribs(gl, 1);
+   }
+   gl->glBindVertexArray(0);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   gl->glEnable(GL_PROGRAM_POINT_SIZE);
+   gl->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+   gl->glClearColor(0, 0, 0, 1);
+
+   updateView();
+   uploaded = false;
+}
+
+void Canvas::cleanup()
+{
+   if (!gl)
+      return;
+
+   gl->glDeleteVertexArrays(NUM_LINE_LAYERS, lineVAO);
+   gl->glDeleteBuffers(NUM_LINE_LAYERS, lineVBO);
+   gl->glDeleteVertexArrays(NUM_POINT_LAYERS, pointVAO);
+   gl->glDeleteBuffers(NUM_POINT_LAYERS, pointVBO);
+   delete lineProgram;
+   delete pointProgram;
+   lineProgram  = NULL;
+   pointProgram = NULL;
+   gl = NULL;
+}
+
+void Canvas::resize(int width, int height)
+{
+   if (height == 0)
+      height = 1;
+
+   gl->glViewport(0, 0, width, height);
+   viewW = width;
+   viewH = height;
+   updateView();
+}
+
+// rebuild the projection from the pan/zoom state
+void Canvas::updateView()
+{
+   double fit = min( (double) viewW / manager->getWorldWidth(),
+                     (double) viewH / manager->getWorldHeight() );
+   pixelScale = fit * zoom;
+
+   projection.setToIdentity();
+   projection.ortho(viewX, viewX + viewW / pixelScale,
+                    viewY + viewH / pixelScale, viewY, -1.0, 1.0);
+}
 
+// zoom by factor, keeping the world point under (px, py) fixed
+void Canvas::zoomAt(double px, double py, double factor)
+{
+   double wx = viewX + px / pixelScale;
+   double wy = viewY + py / pixelScale;
+
+   zoom = max(MIN_ZOOM, min(MAX_ZOOM, zoom * factor));
+   updateView();
+
+   viewX = wx - px / pixelScale;
+   viewY = wy - py / pixelScale;
+   updateView();
+}
+
+void Canvas::pan(double dx, double dy)
+{
+   viewX -= dx / pixelScale;
+   viewY -= dy / pixelScale;
+   updateView();
+}
+
+void Canvas::resetView()
+{
+   viewX = viewY = 0;
+   zoom  = 1;
+   updateView();
+}
+
+Position Canvas::toWorld(double px, double py) const
+{
+   return Position( (int) floor(viewX + px / pixelScale),
+                    (int) floor(viewY + py / pixelScale) );
+}
+
+void Canvas::addLine(CanvasVertices& layer, float x1, float y1, float x2, float y2,
+                     float r, float g, float b, float dist)
+{
+   float len = sqrt( (x2-x1)*(x2-x1) + (y2-y1)*(y2-y1) );
+   layer.push_back(CanvasVertex(x1, y1, r, g, b, dist));
+   layer.push_back(CanvasVertex(x2, y2, r, g, b, dist + len));
+}
+
+void Canvas::addBox(int boxNum)
+{
+   Box box = manager->getBox(boxNum);
+   float X = box.pos.X;
+   float Y = box.pos.Y;
+	float boxRadius = box.size;
+
+   // generated scenes can have any number of boxes, past the
+   // first three they are dark grey
+   float r = .3, g = .3, b = .3;
+   if(boxNum < 3)
+      r = g = b = 0;
    if(boxNum == 0)
-   {	
-      glColor3f(1,0,0);
+   {
+      r = 1;
    }
    else if(boxNum == 1)
    {
-      glColor3f(0,1,0);
+      g = 1;
    }
    else if(boxNum == 2)
    {
-      glColor3f(0,0,1);
+      b = 1;
    }
-	
-	glBegin(GL_QUADS);
-		glVertex2f(X+(boxRadius),Y-(boxRadius));
-		glVertex2f(X-(boxRadius),Y-(boxRadius));
-		glVertex2f(X-(boxRadius),Y+(boxRadius));
-		glVertex2f(X+(boxRadius),Y+(boxRadius));
-	glEnd();
-
-   glFlush();
-}
-
-void Canvas::drawRobot()
-{
-   int X = manager->getRobot().X;
-   int Y = manager->getRobot().Y;
-
-   glColor3f(0,0,0);
-	glBegin(GL_TRIANGLE_FAN);
-      glVertex2f(X,Y);
-
-      for(int i=0; i<=360; i++)
-      {
-         glVertex2f(X +sin(i)*2, Y + cos(i)*2);
-      }
-   glEnd();
-	
-	glBegin(GL_LINES);
-		glVertex2f(X-6-9, Y+6+6);
-		glVertex2f(X-6-9, Y-6+6);
-		glVertex2f(X-6-9, Y-6+6);
-		glVertex2f(X+3-9, Y-6+6);
-		glVertex2f(X+3-9, Y-6+6);
-		glVertex2f(X+3-9, Y+0+6);
-		glVertex2f(X+3-9, Y+0+6);
-		glVertex2f(X-6-9, Y+0+6);
-		glVertex2f(X+0-9, Y+0+6);
-		glVertex2f(X+3-9, Y+6+7);
-	glEnd();
-
-   glFlush(); 
-}
-
-void Canvas::drawDest()
-{
-   int X = manager->getDest().X;
-   int Y = manager->getDest().Y;
-
-   glColor3f(0,0,0);
-	glBegin(GL_TRIANGLE_FAN);
-      glVertex2f(X,Y);
-
-      for(int i=0; i<=360; i++)
-      {
-         glVertex2f(X +sin(i)*2, Y + cos(i)*2);
-      }
-   glEnd();
-	
-	glBegin(GL_LINES);
-	{
-      glVertex2f(X+0-9,Y-8-6);
-      glVertex2f(X+0-9,Y+6-6);
-      glVertex2f(X+0-9,Y+6-6);
-      glVertex2f(X-6-9,Y+6-6);
-      glVertex2f(X-6-9,Y+6-6);
-      glVertex2f(X-6-9,Y+0-6);
-      glVertex2f(X-6-9,Y+0-6);
-		glVertex2f(X+0-9,Y+0-6);
-	}
-	glEnd();
-	
-   glFlush(); 
-}
-
-void Canvas::drawCellNode(int row, int col)
-{  
-
-   int X = manager->getCell(row, col).pos.X;
-   int Y = manager->getCell(row, col).pos.Y;
-	if (manager->getCell(row, col).isValid)
-		glColor3f(1,1,0);
-	else glColor3f(0,0,0);
-   glBegin(GL_TRIANGLE_FAN);
-      glVertex2f(X,Y);
-
-      for(int i=0; i<=360; i++)
-      {
-         glVertex2f(X +sin(i)*3, Y + cos(i)*3);
-      }
-   glEnd();
-   
-   glFlush();   
-}
-
-void Canvas::drawCellBorders(int row, int col)
-{
-	int X1 = manager->getCell(row, col).TR.X;
-	int Y1 = manager->getCell(row, col).TR.Y;
-	int X2 = manager->getCell(row, col).TL.X;
-	int Y2 = manager->getCell(row, col).TL.Y;
-	int X3 = manager->getCell(row, col).BL.X;
-	int Y3 = manager->getCell(row, col).BL.Y;
-	int X4 = manager->getCell(row, col).BR.X;
-	int Y4 = manager->getCell(row, col).BR.Y;
-	
-	glColor3f(0,0,0);
-	
-	glPushAttrib(GL_ENABLE_BIT); 
-
-	glLineStipple(1, 0x8888);		// Spacing of dotted lines from 0x0000(no line) to 0xFFFF(black line)
-	glEnable(GL_LINE_STIPPLE);
-	
-   glBegin(GL_LINES);
-      glVertex2f(X1,Y1);
-		glVertex2f(X4,Y4);
-		
-		glVertex2f(X4,Y4);
-		glVertex2f(X3,Y3);
-   glEnd();
-	
-	glPopAttrib();
-   
-   glFlush();   
-	
-}
-
-void Canvas::drawCells()
-{
-	for (int i=0; i<manager->getCellRows(); i++)
+
+   CanvasVertices& layer = lineData[LAYER_SCENE];
+   CanvasVertex tr(X+boxRadius, Y-boxRadius, r, g, b);
+   CanvasVertex tl(X-boxRadius, Y-boxRadius, r, g, b);
+   CanvasVertex bl(X-boxRadius, Y+boxRadius, r, g, b);
+   CanvasVertex br(X+boxRadius, Y+boxRadius, r, g, b);
+   layer.push_back(tr); layer.push_back(tl); layer.push_back(bl);
+   layer.push_back(tr); layer.push_back(bl); layer.push_back(br);
+}
+
+// background, inflated obstacles and boxes
+void Canvas::buildScene()
+{
+   CanvasVertices& layer = lineData[LAYER_SCENE];
+   layer.clear();
+
+   float W = manager->getWorldWidth();
+   float H = manager->getWorldHeight();
+
+   // set greyish canvas
+   float c = .7;
+   layer.push_back(CanvasVertex(0, 0, c, c, c));
+   layer.push_back(CanvasVertex(0, H, c, c, c));
+   layer.push_back(CanvasVertex(W, H, c, c, c));
+   layer.push_back(CanvasVertex(0, 0, c, c, c));
+   layer.push_back(CanvasVertex(W, H, c, c, c));
+   layer.push_back(CanvasVertex(W, 0, c, c, c));
+
+   // configuration space obstacles under the boxes themselves
+   const Obstacles& obstacles = manager->getObstacles();
+   float o = .55;
+   for (int i = 0; i < obstacles.size(); i++)
+   {
+      CanvasVertex tr(obstacles[i].R, obstacles[i].T, o, o, o);
+      CanvasVertex tl(obstacles[i].L, obstacles[i].T, o, o, o);
+      CanvasVertex bl(obstacles[i].L, obstacles[i].B, o, o, o);
+      CanvasVertex br(obstacles[i].R, obstacles[i].B, o, o, o);
+      layer.push_back(tr); layer.push_back(tl); layer.push_back(bl);
+      layer.push_back(tr); layer.push_back(bl); layer.push_back(br);
+   }
+
+   for (int i = 0; i < manager->numBoxes(); i++)
+      addBox(i);
+}
+
+// robot and destination: a dot plus an "R" or "D" glyph
+void Canvas::buildMarkers()
+{
+   CanvasVertices& lines  = lineData[LAYER_MARKERS];
+   CanvasPoints&   points = pointData[POINTS_MARKERS];
+   lines.clear();
+   points.clear();
+
+   float X = manager->getRobot().X;
+   float Y = manager->getRobot().Y;
+   points.push_back(CanvasPoint(X, Y, 0, 0, 0, 2));
+   addLine(lines, X-6-9, Y+6+6, X-6-9, Y-6+6, 0, 0, 0);
+   addLine(lines, X-6-9, Y-6+6, X+3-9, Y-6+6, 0, 0, 0);
+   addLine(lines, X+3-9, Y-6+6, X+3-9, Y+0+6, 0, 0, 0);
+   addLine(lines, X+3-9, Y+0+6, X-6-9, Y+0+6, 0, 0, 0);
+   addLine(lines, X+0-9, Y+0+6, X+3-9, Y+6+7, 0, 0, 0);
+
+   X = manager->getDest().X;
+   Y = manager->getDest().Y;
+   points.push_back(CanvasPoint(X, Y, 0, 0, 0, 2));
+   addLine(lines, X+0-9, Y-8-6, X+0-9, Y+6-6, 0, 0, 0);
+   addLine(lines, X+0-9, Y+6-6, X-6-9, Y+6-6, 0, 0, 0);
+   addLine(lines, X-6-9, Y+6-6, X-6-9, Y+0-6, 0, 0, 0);
+   addLine(lines, X-6-9, Y+0-6, X+0-9, Y+0-6, 0, 0, 0);
+}
+
+// cell nodes and the dotted right/bottom border of every cell,
+// in index order, plus one aggregated quad per index bucket
+void Canvas::buildCells()
+{
+   CanvasPoints&   nodes   = pointData[POINTS_NODES];
+   CanvasVertices& borders = lineData[LAYER_BORDERS];
+   CanvasVertices& regions = lineData[LAYER_REGIONS];
+   nodes.clear();
+   borders.clear();
+   regions.clear();
+
+   // grid cells or quadtree leaves, the nodes cover both
+   const Nodes& managerNodes = manager->getNodes();
+   vector<Cell> cells;
+   cells.reserve(managerNodes.size());
+	for (int i=0; i<managerNodes.size(); i++)
+      cells.push_back(managerNodes[i]->cell);
+   index.build(cells, manager->getWorldWidth(), manager->getWorldHeight());
+
+	for (int i=0; i<index.size(); i++)
 	{
-		for (int j=0; j<manager->getCellCols(); j++)
-		{
-			drawCellNode(i,j);
-			drawCellBorders(i,j);
-		}		
+      const Cell& cell = cells[index.getCell(i)];
+      if (cell.isValid)
+         nodes.push_back(CanvasPoint(cell.pos.X, cell.pos.Y, 1, 1, 0, 3));
+      else
+         nodes.push_back(CanvasPoint(cell.pos.X, cell.pos.Y, 0, 0, 0, 3));
+
+      // continue the dash pattern around the corner
+      float dist = cell.BR.Y - cell.TR.Y;
+      addLine(borders, cell.TR.X, cell.TR.Y, cell.BR.X, cell.BR.Y, 0, 0, 0);
+      addLine(borders, cell.BR.X, cell.BR.Y, cell.BL.X, cell.BL.Y, 0, 0, 0, dist);
 	}
+
+   // shade each bucket from black (all blocked) to yellow (all free)
+   for (int b = 0; b < index.numBuckets(); b++)
+   {
+      Bounds reg = index.getBucketRegion(b);
+      float  f   = 0;
+      if (index.getBucketCount(b) > 0)
+         f = (float) index.getBucketValid(b) / index.getBucketCount(b);
+
+      CanvasVertex tr(reg.R, reg.T, f, f, 0);
+      CanvasVertex tl(reg.L, reg.T, f, f, 0);
+      CanvasVertex bl(reg.L, reg.B, f, f, 0);
+      CanvasVertex br(reg.R, reg.B, f, f, 0);
+      regions.push_back(tr); regions.push_back(tl); regions.push_back(bl);
+      regions.push_back(tr); regions.push_back(bl); regions.push_back(br);
+   }
 }
 
-void Canvas::drawPath()
+void Canvas::buildPath()
 {
-	glColor3f(1,1,0);
-	glBegin(GL_LINE_STRIP);
-	glVertex2f(manager->getRobot().X,manager->getRobot().Y);	
-	for (int i=0; i<manager->getPathNodesLength()-1; i++)
+   CanvasVertices& layer = lineData[LAYER_PATH];
+   layer.clear();
+
+   if (!manager->pathDrawn)
+      return;
+
+   // the shortcut path when smoothing is on
+   const Waypoints& smoothed = manager->getSmoothedPath();
+   if (manager->getSmoothing() && !smoothed.empty())
+   {
+      for (int i=0; i<smoothed.size(); i++)
+         layer.push_back(CanvasVertex(smoothed[i].X, smoothed[i].Y, 1, 1, 0));
+      return;
+   }
+
+   layer.push_back(CanvasVertex(manager->getRobot().X, manager->getRobot().Y, 1, 1, 0));
+	for (int i=0; i<manager->getPathNodesLength(); i++)
 	{
-		glVertex2f(manager->getPathNode(i).X,manager->getPathNode(i).Y);
-      glVertex2f(manager->getPathNode(i+1).X,manager->getPathNode(i+1).Y);
+      Position pos = manager->getPathNode(i);
+      layer.push_back(CanvasVertex(pos.X, pos.Y, 1, 1, 0));
 	}
-	glVertex2f(manager->getDest().X,manager->getDest().Y);	
-	glEnd();
-		
-	glFlush();
+   layer.push_back(CanvasVertex(manager->getDest().X, manager->getDest().Y, 1, 1, 0));
+}
+
+// Push every layer to the GPU.  Only called when the manager changed.
+void Canvas::upload()
+{
+   buildScene();
+   buildMarkers();
+   buildCells();
+   buildPath();
+
+   for (int i = 0; i < NUM_LINE_LAYERS; i++)
+   {
+      gl->glBindBuffer(GL_ARRAY_BUFFER, lineVBO[i]);
+      gl->glBufferData(GL_ARRAY_BUFFER, lineData[i].size() * sizeof(CanvasVertex),
+                       lineData[i].empty() ? NULL : &lineData[i][0], GL_STATIC_DRAW);
+   }
+   for (int i = 0; i < NUM_POINT_LAYERS; i++)
+   {
+      gl->glBindBuffer(GL_ARRAY_BUFFER, pointVBO[i]);
+      gl->glBufferData(GL_ARRAY_BUFFER, pointData[i].size() * sizeof(CanvasPoint),
+                       pointData[i].empty() ? NULL : &pointData[i][0], GL_STATIC_DRAW);
+   }
+   gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   uploadedRevision = manager->getRevision();
+   uploadedMotion   = manager->getMotionRevision();
+   uploaded = true;
+}
+
+// The robot moved along its path and nothing else changed: only the
+// marker buffers need refreshing
+void Canvas::uploadMarkers()
+{
+   buildMarkers();
+
+   gl->glBindBuffer(GL_ARRAY_BUFFER, lineVBO[LAYER_MARKERS]);
+   gl->glBufferData(GL_ARRAY_BUFFER, lineData[LAYER_MARKERS].size() * sizeof(CanvasVertex),
+                    &lineData[LAYER_MARKERS][0], GL_DYNAMIC_DRAW);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, pointVBO[POINTS_MARKERS]);
+   gl->glBufferData(GL_ARRAY_BUFFER, pointData[POINTS_MARKERS].size() * sizeof(CanvasPoint),
+                    &pointData[POINTS_MARKERS][0], GL_DYNAMIC_DRAW);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   uploadedMotion = manager->getMotionRevision();
+}
+
+// nodes and borders of the cells whose buckets are on screen
+void Canvas::drawCellRanges()
+{
+   double r = viewX + viewW / pixelScale;
+   double b = viewY + viewH / pixelScale;
+   index.query(viewX, viewY, r, b, visible);
+
+   pointProgram->bind();
+   pointProgram->setUniformValue("mvp", projection);
+   pointProgram->setUniformValue("pixelScale", pixelScale);
+   gl->glBindVertexArray(pointVAO[POINTS_NODES]);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, pointVBO[POINTS_NODES]);
+   for (int i = 0; i < visible.size(); i++)
+   {
+      setupAttribs(gl, 1, visible[i].first);
+      gl->glDrawArraysInstanced(GL_POINTS, 0, 1, visible[i].last - visible[i].first);
+   }
+   setupAttribs(gl, 1);
+
+   lineProgram->bind();
+   lineProgram->setUniformValue("dashScale", pixelScale);
+   gl->glBindVertexArray(lineVAO[LAYER_BORDERS]);
+   for (int i = 0; i < visible.size(); i++)
+   {
+      gl->glDrawArrays(LAYER_MODES[LAYER_BORDERS], BORDER_VERTS * visible[i].first,
+                       BORDER_VERTS * (visible[i].last - visible[i].first));
+   }
+   lineProgram->setUniformValue("dashScale", 0.0f);
+}
+
+// level of detail: one translucent quad per visible bucket
+void Canvas::drawRegions()
+{
+   double r = viewX + viewW / pixelScale;
+   double b = viewY + viewH / pixelScale;
+   index.queryBuckets(viewX, viewY, r, b, visible);
+
+   gl->glEnable(GL_BLEND);
+   lineProgram->bind();
+   lineProgram->setUniformValue("opacity", 0.5f);
+   gl->glBindVertexArray(lineVAO[LAYER_REGIONS]);
+   for (int i = 0; i < visible.size(); i++)
+   {
+      gl->glDrawArrays(LAYER_MODES[LAYER_REGIONS], REGION_VERTS * visible[i].first,
+                       REGION_VERTS * (visible[i].last - visible[i].first));
+   }
+   lineProgram->setUniformValue("opacity", 1.0f);
+   gl->glDisable(GL_BLEND);
 }
 
 void Canvas::display ( void )
 {
-   glClear ( GL_COLOR_BUFFER_BIT );
-        
+   if (!uploaded || uploadedRevision != manager->getRevision())
+      upload();
+   else if (uploadedMotion != manager->getMotionRevision())
+      uploadMarkers();
 
-   // set greyish canvas
-   glColor3f (.7,.7,.7);
-   glBegin (GL_POLYGON);
-   glVertex2f (0, 0);
-   glVertex2f (0, HEIGHT);
-   glVertex2f (WIDTH, HEIGHT);
-   glVertex2f (WIDTH, 0);
-   glEnd();
-
-	drawBox(0);
-	drawBox(1);
-	drawBox(2);
-	drawRobot();
-	drawDest();
-	drawCells();
-	
-	if (manager->pathDrawn)
-		drawPath();
+   gl->glClear ( GL_COLOR_BUFFER_BIT );
+
+   lineProgram->bind();
+   lineProgram->setUniformValue("mvp", projection);
+   lineProgram->setUniformValue("dashScale", 0.0f);
+   lineProgram->setUniformValue("opacity", 1.0f);
+   gl->glBindVertexArray(lineVAO[LAYER_SCENE]);
+   gl->glDrawArrays(LAYER_MODES[LAYER_SCENE], 0, lineData[LAYER_SCENE].size());
+   gl->glBindVertexArray(lineVAO[LAYER_MARKERS]);
+   gl->glDrawArrays(LAYER_MODES[LAYER_MARKERS], 0, lineData[LAYER_MARKERS].size());
+
+   // average on-screen size of a cell decides the level of detail
+   bool lod = (lodMode == LOD_ALWAYS);
+   if (lodMode == LOD_AUTO && index.size() > 0)
+   {
+      double area = (double) manager->getWorldWidth() * manager->getWorldHeight();
+      double cellSide = sqrt( area / index.size() );
+      lod = cellSide * pixelScale < LOD_CELL_PIXELS;
+   }
+
+   if (lod)
+      drawRegions();
+   else
+      drawCellRanges();
+
+   // markers and path stay on top
+   pointProgram->bind();
+   pointProgram->setUniformValue("mvp", projection);
+   pointProgram->setUniformValue("pixelScale", pixelScale);
+   gl->glBindVertexArray(pointVAO[POINTS_MARKERS]);
+   gl->glDrawArraysInstanced(GL_POINTS, 0, 1, pointData[POINTS_MARKERS].size());
+
+   lineProgram->bind();
+   lineProgram->setUniformValue("dashScale", 0.0f);
+   gl->glBindVertexArray(lineVAO[LAYER_PATH]);
+   gl->glDrawArrays(LAYER_MODES[LAYER_PATH], 0, lineData[LAYER_PATH].size());
+
+   gl->glBindVertexArray(0);
+   lineProgram->release();
 }
 
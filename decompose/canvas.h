@@ -2,28 +2,140 @@
 #ifndef CANVAS_H_
 #define CANVAS_H_
 
+#include "cellindex.h"
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QMatrix4x4>
+#include <vector>
+
 class Manager;
+class QOpenGLShaderProgram;
+
+// A colored vertex for the line and triangle layers.
+// dist is the distance along the line, used for the dotted cell borders
+struct CanvasVertex {
+   GLfloat x, y;
+   GLfloat r, g, b;
+   GLfloat dist;
+   CanvasVertex(GLfloat _x = 0, GLfloat _y = 0,
+                GLfloat _r = 0, GLfloat _g = 0, GLfloat _b = 0,
+                GLfloat _dist = 0)
+   : x(_x), y(_y), r(_r), g(_g), b(_b), dist(_dist) {};
+};
+
+// One instance of a round point sprite (cell nodes, robot and dest markers)
+struct CanvasPoint {
+   GLfloat x, y;
+   GLfloat r, g, b;
+   GLfloat radius;
+   CanvasPoint(GLfloat _x = 0, GLfloat _y = 0,
+               GLfloat _r = 0, GLfloat _g = 0, GLfloat _b = 0,
+               GLfloat _radius = 0)
+   : x(_x), y(_y), r(_r), g(_g), b(_b), radius(_radius) {};
+};
+
+typedef std::vector<CanvasVertex>  CanvasVertices;
+typedef std::vector<CanvasPoint>   CanvasPoints;
 
+/*
+ * Retained-mode renderer for the decomposition.
+ *
+ * Every layer lives in its own vertex buffer and is only re-uploaded when
+ * the manager's revision changes, so an idle frame is just a handful of
+ * draw calls regardless of the number of cells.
+ *
+ * Cells are stored in CellIndex bucket order, so culling against the view
+ * only picks sub-ranges of the buffers.  When cells are smaller than a few
+ * pixels the per-bucket region layer is drawn instead (level of detail).
+ */
 class Canvas
 {
 public:
+   // the vertex buffers
+   enum Layer {
+      LAYER_SCENE = 0,  // background, c-space and boxes (triangles)
+      LAYER_BORDERS,    // dotted cell borders (lines)
+      LAYER_MARKERS,    // robot and dest glyphs (lines)
+      LAYER_PATH,       // the path from robot to dest (line strip)
+      LAYER_REGIONS,    // one quad per index bucket (triangles)
+      NUM_LINE_LAYERS
+   };
+   enum PointLayer {
+      POINTS_NODES = 0, // cell nodes
+      POINTS_MARKERS,   // robot and dest
+      NUM_POINT_LAYERS
+   };
+
+   enum LODMode {
+      LOD_AUTO = 0,     // aggregate when cells get smaller than LOD_CELL_PIXELS
+      LOD_NEVER,
+      LOD_ALWAYS
+   };
+   static const int LOD_CELL_PIXELS = 4;
 
    Canvas(Manager* _man);
    ~Canvas();
 
-   void init();
+   // GL must be current for all of these
+   void init(QOpenGLFunctions_3_3_Core* _gl);
+   void cleanup();
 	void display();
-   void drawBox(int boxNum);
-   void drawRobot();
-   void drawDest(); 
-   void drawCellNode(int row, int col);
-	void drawCellBorders(int row, int col);
-	void drawCells();
-	void drawPath();
-   
+   void resize(int width, int height);
+
+   // view controls, all in device pixels
+   void     zoomAt(double px, double py, double factor);
+   void     pan(double dx, double dy);
+   void     resetView();
+   Position toWorld(double px, double py) const;
+
+   void     setLODMode(LODMode mode) {lodMode = mode;}
+   LODMode  getLODMode() const       {return lodMode;}
+
+   // rebuild the CPU-side copies of the layers from the manager
+   void buildScene();
+   void buildMarkers();
+   void buildCells();
+	void buildPath();
+
 private:
    Manager* manager;
-	
+   QOpenGLFunctions_3_3_Core* gl;
+
+   QOpenGLShaderProgram* lineProgram;
+   QOpenGLShaderProgram* pointProgram;
+   QMatrix4x4           projection;
+   float                pixelScale; // device pixels per world unit
+   int                  viewW;      // viewport size in device pixels
+   int                  viewH;
+   double               viewX;      // world position at the top left corner
+   double               viewY;
+   double               zoom;       // 1 = whole world fits the viewport
+   LODMode              lodMode;
+
+   CellIndex            index;
+   CellRanges           visible;
+
+   unsigned int         uploadedRevision;
+   unsigned int         uploadedMotion;   // robot position, while following
+   bool                 uploaded;
+
+   GLuint         lineVAO[NUM_LINE_LAYERS];
+   GLuint         lineVBO[NUM_LINE_LAYERS];
+   CanvasVertices lineData[NUM_LINE_LAYERS];
+
+   GLuint         pointVAO[NUM_POINT_LAYERS];
+   GLuint         pointVBO[NUM_POINT_LAYERS];
+   CanvasPoints   pointData[NUM_POINT_LAYERS];
+
+   void upload();
+   void uploadMarkers();
+   void updateView();
+   void drawCellRanges();
+   void drawRegions();
+   void addBox(int boxNum);
+   void addLine(CanvasVertices& layer, float x1, float y1, float x2, float y2,
+                float r, float g, float b, float dist = 0);
+
 };
 
 #endif
@@ -3,21 +3,36 @@
 #include "consts.h"
 #include "canvas.h"
 
+#include <QSurfaceFormat>
+#include <QOpenGLContext>
+#include <QMouseEvent>
+#include <QWheelEvent>
+
 #include <cmath>
 
 using namespace std;
 
 
 CanvasWidget::CanvasWidget(Canvas* _canvas, QWidget* _parent)
-: QGLWidget(QGLFormat(QGL::SampleBuffers), _parent),
-canvas(_canvas)
+: QOpenGLWidget(_parent),
+canvas(_canvas),
+panning(false)
 {
+   // instancing and point sprites need a 3.3 core context
+   // (Mesa's llvmpipe provides one when there is no GPU)
+   QSurfaceFormat format;
+   format.setVersion(3, 3);
+   format.setProfile(QSurfaceFormat::CoreProfile);
+   format.setSamples(4);
+   setFormat(format);
+
    setFixedSize(WIDTH, HEIGHT);
    setAutoFillBackground(false);
 }
 
 CanvasWidget::~CanvasWidget()
 {
+   cleanup();
 }
 
 QSize CanvasWidget::sizeHint() const
@@ -25,35 +40,107 @@ QSize CanvasWidget::sizeHint() const
    return QSize(640, 480);
 }
 
+Position CanvasWidget::toWorld(const QPoint& point) const
+{
+   int ratio = devicePixelRatio();
+   return canvas->toWorld(point.x() * ratio, point.y() * ratio);
+}
+
+void CanvasWidget::resetView()
+{
+   canvas->resetView();
+   update();
+}
+
+void CanvasWidget::cycleLODMode()
+{
+   int mode = (canvas->getLODMode() + 1) % 3;
+   canvas->setLODMode( (Canvas::LODMode) mode );
+   update();
+}
+
 void CanvasWidget::animate()
 {
-   repaint();
+   update();
 }
 
-void CanvasWidget::paintEvent(QPaintEvent *event)
+// release the GL resources while the context is still alive
+void CanvasWidget::cleanup()
 {
-   QPainter painter;
-   painter.begin(this);
-   painter.setRenderHint(QPainter::Antialiasing);
-   canvas->display();
-   painter.end();
+   makeCurrent();
+   canvas->cleanup();
+   doneCurrent();
 }
 
 void CanvasWidget::initializeGL()
 {
-   glEnable(GL_DEPTH_TEST);
-   glEnable(GL_CULL_FACE);
+   initializeOpenGLFunctions();
+   connect(context(), SIGNAL(aboutToBeDestroyed()), this, SLOT(cleanup()));
 
-   qglClearColor(QColor(Qt::black));
+   canvas->init(this);
+}
 
-   canvas->init();
+void CanvasWidget::paintGL()
+{
+   canvas->display();
 }
 
 void CanvasWidget::resizeGL(int width, int height)
 {
-   if (height == 0)
-      height = 1;
+   int ratio = devicePixelRatio();
+   canvas->resize(width * ratio, height * ratio);
+}
 
-   glViewport(0, 0, width, height);
+void CanvasWidget::wheelEvent(QWheelEvent* event)
+{
+   int ratio = devicePixelRatio();
+   // one notch (120) zooms by 25%
+   double factor = pow(1.25, event->angleDelta().y() / 120.0);
+   canvas->zoomAt(event->pos().x() * ratio, event->pos().y() * ratio, factor);
+   update();
+   event->accept();
+}
+
+void CanvasWidget::mousePressEvent(QMouseEvent* event)
+{
+   if (event->button() == Qt::RightButton)
+   {
+      panning = true;
+      lastPos = event->pos();
+      event->accept();
+   }
+   else
+   {
+      // left clicks place objects in the window
+      event->ignore();
+   }
+}
+
+void CanvasWidget::mouseMoveEvent(QMouseEvent* event)
+{
+   if (!panning)
+   {
+      event->ignore();
+      return;
+   }
+
+   int ratio = devicePixelRatio();
+   QPoint delta = event->pos() - lastPos;
+   lastPos = event->pos();
+   canvas->pan(delta.x() * ratio, delta.y() * ratio);
+   update();
+}
+
+void CanvasWidget::mouseReleaseEvent(QMouseEvent* event)
+{
+   if (panning && event->button() == Qt::RightButton)
+   {
+      panning = false;
+      event->accept();
+   }
+   else
+   {
+      event->ignore();
+   }
 }
 
@@ -4,15 +4,14 @@
 
 #include "consts.h"
 
-#include <QGLWidget>
-#include <QMatrix>
-#include <QVector>
-#include <QGLShaderProgram>
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QPoint>
 
 
 class Canvas;
 
-class CanvasWidget : public QGLWidget
+class CanvasWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
 {
    Q_OBJECT
 
@@ -22,20 +21,34 @@ public:
    
    QSize sizeHint() const;
 
+   // map a point in widget coordinates through the current pan/zoom
+   Position toWorld(const QPoint& point) const;
+
 signals:
    void jointsChanged();
    void brushPosChanged();
 
 public slots:
    void animate();
+   void cleanup();
+   void resetView();
+   void cycleLODMode();
 
 protected:
-   void paintEvent(QPaintEvent *event);
    void initializeGL();
+   void paintGL();
    void resizeGL(int width, int height);
 
+   // wheel zooms around the cursor, right-drag pans
+   void wheelEvent(QWheelEvent* event);
+   void mousePressEvent(QMouseEvent* event);
+   void mouseMoveEvent(QMouseEvent* event);
+   void mouseReleaseEvent(QMouseEvent* event);
+
 private:
    Canvas*  canvas;
+   bool     panning;
+   QPoint   lastPos;
 };
 
 #endif
@@ -0,0 +1,141 @@
+
+#include "cellindex.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+// aim for roughly this many cells per bucket
+const int CELLS_PER_BUCKET = 8;
+const int MAX_BUCKETS_PER_SIDE = 256;
+
+CellIndex::CellIndex()
+: width(1),
+height(1),
+rows(0),
+cols(0),
+bucketW(1),
+bucketH(1)
+{
+}
+
+CellIndex::~CellIndex()
+{
+}
+
+void CellIndex::clear()
+{
+   rows = cols = 0;
+   order.clear();
+   start.clear();
+   valid.clear();
+   bounds.clear();
+}
+
+int CellIndex::bucketOf(const Position& pos) const
+{
+   int c = (int) (pos.X / bucketW);
+   int r = (int) (pos.Y / bucketH);
+   c = max(0, min(cols-1, c));
+   r = max(0, min(rows-1, r));
+   return r*cols + c;
+}
+
+void CellIndex::build(const vector<Cell>& cells, int _width, int _height)
+{
+   clear();
+   width  = max(1, _width);
+   height = max(1, _height);
+
+   int side = (int) sqrt( (double) cells.size() / CELLS_PER_BUCKET );
+   side = max(1, min(MAX_BUCKETS_PER_SIDE, side));
+   rows = cols = side;
+   bucketW = (double) width  / cols;
+   bucketH = (double) height / rows;
+
+   int n = numBuckets();
+   start.assign(n+1, 0);
+   valid.assign(n, 0);
+   bounds.assign(n, Bounds(width, 0, height, 0));
+
+   // counting sort of the cells into their buckets
+   vector<int> bucket(cells.size());
+   for (int i = 0; i < cells.size(); i++)
+   {
+      int b = bucketOf(cells[i].pos);
+      bucket[i] = b;
+      start[b+1]++;
+
+      Bounds& bb = bounds[b];
+      bb.L = min(bb.L, cells[i].L);
+      bb.R = max(bb.R, cells[i].R);
+      bb.T = min(bb.T, cells[i].T);
+      bb.B = max(bb.B, cells[i].B);
+      if (cells[i].isValid)
+         valid[b]++;
+   }
+   for (int b = 0; b < n; b++)
+      start[b+1] += start[b];
+
+   vector<int> fill(start.begin(), start.end()-1);
+   order.resize(cells.size());
+   for (int i = 0; i < cells.size(); i++)
+      order[fill[bucket[i]]++] = i;
+}
+
+// Buckets are tested against their cell bounds rather than their grid
+// region, since a cell can hang over the edge of its bucket.
+void CellIndex::queryBuckets(double l, double t, double r, double b,
+                             CellRanges& ranges) const
+{
+   ranges.clear();
+   for (int row = 0; row < rows; row++)
+   {
+      int first = -1;
+      for (int col = 0; col < cols; col++)
+      {
+         int bucket = row*cols + col;
+         bool visible = getBucketCount(bucket) > 0 &&
+                        bounds[bucket].intersects(l, t, r, b);
+         if (visible && first < 0)
+            first = bucket;
+         if (!visible && first >= 0)
+         {
+            ranges.push_back(CellRange(first, bucket));
+            first = -1;
+         }
+      }
+      if (first >= 0)
+         ranges.push_back(CellRange(first, (row+1)*cols));
+   }
+}
+
+void CellIndex::query(double l, double t, double r, double b,
+                      CellRanges& ranges) const
+{
+   CellRanges buckets;
+   queryBuckets(l, t, r, b, buckets);
+
+   // empty buckets are skipped, so merge runs that touch in cell order
+   ranges.clear();
+   for (int i = 0; i < buckets.size(); i++)
+   {
+      int first = start[buckets[i].first];
+      int last  = start[buckets[i].last];
+      if (!ranges.empty() && ranges.back().last == first)
+         ranges.back().last = last;
+      else
+         ranges.push_back(CellRange(first, last));
+   }
+}
+
+Bounds CellIndex::getBucketRegion(int bucket) const
+{
+   int r = bucket / cols;
+   int c = bucket % cols;
+   return Bounds( (int) (c*bucketW),  (int) ((c+1)*bucketW),
+                  (int) (r*bucketH),  (int) ((r+1)*bucketH) );
+}
+
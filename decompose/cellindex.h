@@ -0,0 +1,85 @@
+
+#ifndef CELLINDEX_H_
+#define CELLINDEX_H_
+
+#include "consts.h"
+
+#include <vector>
+
+// axis-aligned bounds of everything in one bucket
+struct Bounds {
+   int L;
+   int R;
+   int T;
+   int B;
+   Bounds(int _l = 0, int _r = 0, int _t = 0, int _b = 0)
+   : L(_l), R(_r), T(_t), B(_b) {};
+
+   bool intersects(double l, double t, double r, double b) const {
+      return L <= r && R >= l && T <= b && B >= t;
+   }
+};
+
+// A contiguous run of cells [first, last) in bucket order
+struct CellRange {
+   int first;
+   int last;
+   CellRange(int _first = 0, int _last = 0) : first(_first), last(_last) {};
+};
+
+typedef std::vector<CellRange> CellRanges;
+
+/*
+ * Uniform bucket grid over the world, used to cull cells against the view.
+ *
+ * Every cell belongs to the bucket holding its node position, and cells are
+ * stored sorted by bucket (row-major), so a row of visible buckets is one
+ * contiguous range that can be drawn straight out of a vertex buffer.
+ * Each bucket keeps the union of its cells' rectangles, so large cells are
+ * never culled while any part of them is on screen.
+ */
+class CellIndex
+{
+public:
+   CellIndex();
+   ~CellIndex();
+
+   void  build(const std::vector<Cell>& cells, int width, int height);
+   void  clear();
+
+   // ranges of (bucket-ordered) cells whose buckets touch the given rect
+   void  query(double l, double t, double r, double b, CellRanges& ranges) const;
+   // same, but in bucket indices (for the aggregated level-of-detail layer)
+   void  queryBuckets(double l, double t, double r, double b, CellRanges& ranges) const;
+
+   int   size()          const {return order.size();}
+   int   getBucketRows() const {return rows;}
+   int   getBucketCols() const {return cols;}
+   int   numBuckets()    const {return rows*cols;}
+
+   // cell index (into the vector given to build()) of the i'th sorted cell
+   int   getCell(int i)  const {return order[i];}
+
+   // region covered by a bucket, and how many of its cells are valid
+   Bounds getBucketRegion(int bucket) const;
+   int    getBucketCount(int bucket)  const {return start[bucket+1] - start[bucket];}
+   int    getBucketValid(int bucket)  const {return valid[bucket];}
+
+private:
+   int   width;
+   int   height;
+   int   rows;
+   int   cols;
+   double bucketW;
+   double bucketH;
+
+   std::vector<int>     order;  // cell indices sorted by bucket
+   std::vector<int>     start;  // start[b] .. start[b+1] is bucket b in order
+   std::vector<int>     valid;  // number of valid cells per bucket
+   std::vector<Bounds>  bounds; // union of the cell rects in each bucket
+
+   int   bucketOf(const Position& pos) const;
+};
+
+#endif
+
@@ -4,10 +4,12 @@
 
 #include <vector>
 #include <ostream>
+#include <limits>
+#include <cstddef>
 
 const double PI = 3.1415926;
-const int WIDTH  = 500;		//Window Size
-const int HEIGHT = 500;		//Window Size
+const int WIDTH  = 500;		//Window Size (and the default world size)
+const int HEIGHT = 500;		//Window Size (and the default world size)
 
 const int NUM_BOXES = 3;
 const int BOX0_SIZE = 200/2;
@@ -20,39 +22,79 @@ const int BUFFER = 50; // 50 pixel buffer for randomly generated locations
 // meaning nothing can be randomly generated along the outer 50 pixels
 // of the canvas
 
-struct Position {
+// Path costs are 64-bit fixed point with COST_SCALE units per world unit,
+// so sums are exact (no ties from truncation, no overflow) even on
+// 10^6 x 10^6 worlds with millions of cells
+typedef long long Cost;
+const Cost COST_SCALE = 1024;
+const Cost COST_INF   = std::numeric_limits<Cost>::max();
+
+// Positions, boxes, cells and graph nodes are templated on the number of
+// dimensions.  The 2D and 3D versions are explicit specializations with
+// named members (X/Y/Z, L/R/T/B/N/F), so the 2D planner and the GUI compile
+// to exactly the plain structs they always used.
+template <int D> struct PositionT;
+template <int D> struct CellT;
+template <int D> struct NodeT;
+
+template <>
+struct PositionT<2> {
    int X;
    int Y;
-   Position(int _x = -1, int _y = -1) : X(_x), Y(_y) {};
+   PositionT(int _x = -1, int _y = -1) : X(_x), Y(_y) {};
 	
-	void operator=(const Position& other) {
+	void operator=(const PositionT& other) {
 		X = other.X;
 		Y = other.Y;
 	}
 };
 
+template <>
+struct PositionT<3> {
+   int X;
+   int Y;
+   int Z;
+   PositionT(int _x = -1, int _y = -1, int _z = -1) : X(_x), Y(_y), Z(_z) {};
+};
+
+typedef PositionT<2> Position;
+typedef PositionT<3> Position3;
+
 inline std::ostream& operator<<(std::ostream& os, const Position& pos) {
    os << "Pos(" << pos.X << ", " << pos.Y << ")";
    return os;
 }
 
+inline std::ostream& operator<<(std::ostream& os, const Position3& pos) {
+   os << "Pos(" << pos.X << ", " << pos.Y << ", " << pos.Z << ")";
+   return os;
+}
+
 typedef Position Robot;
 typedef Position Destination;
 
-struct Box {
-   Position pos;
-   int      size;
-	Box(Position _pos = Position(), int _size = 0) : pos(_pos), size(_size) {};
+// a square (cube in 3D) of half-width size around pos
+template <int D>
+struct BoxT {
+   PositionT<D> pos;
+   int          size;
+	BoxT(PositionT<D> _pos = PositionT<D>(), int _size = 0) : pos(_pos), size(_size) {};
 };
 
-inline std::ostream& operator<<(std::ostream& os, const Box& box) {
+typedef BoxT<2> Box;
+typedef BoxT<3> Box3;
+
+template <int D>
+inline std::ostream& operator<<(std::ostream& os, const BoxT<D>& box) {
    os << "Box at " << box.pos << " of size " << box.size;
    return os;
 }
 
 typedef std::vector<Box>   Boxes;
+typedef std::vector<Box3>  Boxes3;
 
-struct Cell {
+template <>
+struct CellT<2> {
    Position pos;     // node position in this cell (center? random?)
    int      L;       // Left Edge
    int      R;       // Right Edge
@@ -64,7 +106,7 @@ struct Cell {
    Position BR;      // Bottom Right Vertex
    bool     isValid; // is this cell valid? true; is this cell in collision? false
 	
-	void operator=(const Cell& other) {
+	void operator=(const CellT& other) {
 		pos = other.pos;
 		L = other.L;
 		R = other.R;
@@ -78,6 +120,22 @@ struct Cell {
 	}
 };
 
+// a box shaped cell, [L,R) x [T,B) x [N,F)
+template <>
+struct CellT<3> {
+   Position3 pos;    // node position, the center
+   int       L;      // Left Face   (min X)
+   int       R;      // Right Face  (max X)
+   int       T;      // Top Face    (min Y)
+   int       B;      // Bottom Face (max Y)
+   int       N;      // Near Face   (min Z)
+   int       F;      // Far Face    (max Z)
+   bool      isValid;
+};
+
+typedef CellT<2> Cell;
+typedef CellT<3> Cell3;
+
 inline std::ostream& operator<<(std::ostream& os, const Cell& cell) {
    os << "Cell at " << cell.pos << " isValid (" << cell.isValid << ")";
    return os;
@@ -90,50 +148,67 @@ inline bool operator==(const Cell& lhs, const Cell& rhs) {
    return false;
 }
 
+inline bool operator==(const Cell3& lhs, const Cell3& rhs) {
+   return lhs.pos.X == rhs.pos.X &&
+          lhs.pos.Y == rhs.pos.Y &&
+          lhs.pos.Z == rhs.pos.Z;
+}
+
 typedef std::vector<Cell>  Path; // the path from src cell to dest cell
 typedef std::vector<Cell>  CRow; // a cell row
 typedef std::vector<CRow>  Cells;// a 2D grid of cells (of varying sizes)
-
-struct Node;
+typedef std::vector<Cell3> Path3;
 
 // an edge is a line between two positions
-struct Edge {
-   Node* src;
-   Node* dest;
-   int   weight;
-
-	void operator=(const Edge& other) {
+template <int D>
+struct EdgeT {
+   NodeT<D>* src;
+   NodeT<D>* dest;
+   Cost      weight;
+   EdgeT(NodeT<D>* _src = NULL, NodeT<D>* _dest = NULL, Cost _weight = 0)
+   : src(_src), dest(_dest), weight(_weight) {};
+
+	void operator=(const EdgeT& other) {
       src  = other.src;
       dest = other.dest;
+      weight = other.weight;
    }
 };
 
-typedef std::vector<Edge>  Edges;
-
 // a graph node is a node and its list of edges
-struct Node {
-   Cell  cell;
-   Edges edges;
+template <int D>
+struct NodeT {
+   CellT<D> cell;
+   std::vector< EdgeT<D> > edges;
    bool  visited;
    bool  spset; // is this node part of the shortest path?
-   int   dist;  // distance for Dijkstra's Algorithm
+   Cost  dist;  // distance for Dijkstra's Algorithm
+   int   index; // position in the manager's node list
 
-   Edge hasEdge(Node* dest) {
+   EdgeT<D> hasEdge(NodeT<D>* dest) {
       for (int i = 0; i < edges.size(); i++)
          if (edges[i].dest->cell == dest->cell)
             return edges[i];
-      return Edge();
+      return EdgeT<D>();
    }
 };
 
-inline bool operator==(const Node& lhs, const Node& rhs) {
+template <int D>
+inline bool operator==(const NodeT<D>& lhs, const NodeT<D>& rhs) {
    if (lhs.cell == rhs.cell)
       return true;
    return false;
 }
 
+typedef EdgeT<2>            Edge;
+typedef std::vector<Edge>   Edges;
+typedef NodeT<2>            Node;
 typedef std::vector<Node*>  Nodes;
 typedef std::vector<Node*>  Graph;
 
+typedef EdgeT<3>            Edge3;
+typedef NodeT<3>            Node3;
+typedef std::vector<Node3*> Nodes3;
+
 #endif
 
@@ -0,0 +1,345 @@
+
+#include "cspace.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+CSpace::CSpace()
+: cornerSteps(1)
+{
+}
+
+CSpace::~CSpace()
+{
+}
+
+void CSpace::invalidate()
+{
+   cache.clear();
+}
+
+void CSpace::setCornerSteps(int steps)
+{
+   cornerSteps = max(1, steps);
+   invalidate();
+}
+
+const Obstacles& CSpace::getObstacles(const Boxes& boxes, int width, int height, int radius)
+{
+   map<int, Obstacles>::iterator it = cache.find(radius);
+   if (it != cache.end())
+      return it->second;
+
+   Obstacles inflated;
+   for (int i = 0; i < boxes.size(); i++)
+      inflate(boxes[i], radius, cornerSteps, inflated);
+
+   // the robot's center has to stay radius away from the world border too
+   if (radius > 0)
+   {
+      inflated.push_back(Obstacle(0,            width,  0,             radius));
+      inflated.push_back(Obstacle(0,            width,  height-radius, height));
+      inflated.push_back(Obstacle(0,            radius, 0,             height));
+      inflated.push_back(Obstacle(width-radius, width,  0,             height));
+   }
+
+   Obstacles& merged = cache[radius];
+   merge(inflated, merged);
+   return merged;
+}
+
+// Minkowski sum of a box with a disk: the box grown by radius on each side,
+// with the corners cut to a staircase outside the rounded corners.
+// Step k spans x in [x_{k-1}, x_k] and must reach as high as the circle
+// does at x_{k-1}, so the staircase always covers the disk.
+void CSpace::inflate(const Box& box, int radius, int steps, Obstacles& out)
+{
+   int L = box.pos.X - box.size;
+   int R = box.pos.X + box.size;
+   int T = box.pos.Y - box.size;
+   int B = box.pos.Y + box.size;
+   if (box.size <= 0 && radius <= 0)
+      return;
+
+   if (radius <= 0 || steps <= 1)
+   {
+      out.push_back(Obstacle(L - radius, R + radius, T - radius, B + radius));
+      return;
+   }
+
+   for (int k = 0; k < steps; k++)
+   {
+      double x0 = (double) radius * k / steps;
+      int    dx = (int) ceil( (double) radius * (k+1) / steps );
+      int    dy = (int) ceil( sqrt( (double) radius*radius - x0*x0 ) );
+      // a band dx wider on each side and dy taller above and below
+      out.push_back(Obstacle(L - dx, R + dx, T - dy, B + dy));
+   }
+}
+
+// sort obstacles (by index) on their left edge
+struct ObstacleLess {
+   const Obstacles& obstacles;
+   ObstacleLess(const Obstacles& _obstacles) : obstacles(_obstacles) {};
+   bool operator()(int a, int b) const {return obstacles[a].L < obstacles[b].L;}
+};
+
+// union-find with path halving
+static int find(vector<int>& parent, int i)
+{
+   while (parent[i] != i)
+   {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
+   }
+   return i;
+}
+
+static void join(vector<int>& parent, int a, int b)
+{
+   a = find(parent, a);
+   b = find(parent, b);
+   if (a != b)
+      parent[max(a, b)] = min(a, b);
+}
+
+// Group touching obstacles (sweep over x with union-find), then replace
+// each group with disjoint rectangles covering its union
+void CSpace::merge(const Obstacles& in, Obstacles& out)
+{
+   out.clear();
+   int n = in.size();
+
+   vector<int> order(n);
+   for (int i = 0; i < n; i++)
+      order[i] = i;
+   sort(order.begin(), order.end(), ObstacleLess(in));
+
+   vector<int> parent(n);
+   for (int i = 0; i < n; i++)
+      parent[i] = i;
+
+   vector<int> active;
+   for (int i = 0; i < n; i++)
+   {
+      const Obstacle& a = in[order[i]];
+      // drop obstacles that end before this one starts
+      int kept = 0;
+      for (int j = 0; j < active.size(); j++)
+      {
+         const Obstacle& b = in[active[j]];
+         if (b.R < a.L)
+            continue;
+         active[kept++] = active[j];
+         if (a.touches(b))
+            join(parent, order[i], active[j]);
+      }
+      active.resize(kept);
+      active.push_back(order[i]);
+   }
+
+   map<int, Obstacles> groups;
+   for (int i = 0; i < n; i++)
+      groups[find(parent, i)].push_back(in[i]);
+
+   for (map<int, Obstacles>::iterator it = groups.begin(); it != groups.end(); it++)
+   {
+      if (it->second.size() == 1)
+         out.push_back(it->second[0]);
+      else
+         mergeGroup(it->second, out);
+   }
+}
+
+// Exact union of a group of rectangles as disjoint rectangles: compress the
+// edge coordinates, count coverage with a 2D difference array, cut every
+// x strip into covered y runs and grow runs that continue unchanged into
+// the next strip
+void CSpace::mergeGroup(const Obstacles& group, Obstacles& out)
+{
+   vector<int> xs, ys;
+   for (int i = 0; i < group.size(); i++)
+   {
+      xs.push_back(group[i].L);
+      xs.push_back(group[i].R);
+      ys.push_back(group[i].T);
+      ys.push_back(group[i].B);
+   }
+   sort(xs.begin(), xs.end());
+   sort(ys.begin(), ys.end());
+   xs.erase( unique(xs.begin(), xs.end()), xs.end() );
+   ys.erase( unique(ys.begin(), ys.end()), ys.end() );
+
+   int cols = ys.size();
+   vector<int> cover( xs.size() * cols, 0 );
+   for (int i = 0; i < group.size(); i++)
+   {
+      int r0 = lower_bound(xs.begin(), xs.end(), group[i].L) - xs.begin();
+      int r1 = lower_bound(xs.begin(), xs.end(), group[i].R) - xs.begin();
+      int c0 = lower_bound(ys.begin(), ys.end(), group[i].T) - ys.begin();
+      int c1 = lower_bound(ys.begin(), ys.end(), group[i].B) - ys.begin();
+      cover[r0*cols + c0]++;
+      cover[r0*cols + c1]--;
+      cover[r1*cols + c0]--;
+      cover[r1*cols + c1]++;
+   }
+   for (int r = 0; r < xs.size(); r++)
+      for (int c = 1; c < cols; c++)
+         cover[r*cols + c] += cover[r*cols + c-1];
+   for (int r = 1; r < xs.size(); r++)
+      for (int c = 0; c < cols; c++)
+         cover[r*cols + c] += cover[(r-1)*cols + c];
+
+   // rectangles still growing, keyed by their (T, B) run
+   map< pair<int,int>, Obstacle > growing;
+   for (int r = 0; r+1 < xs.size(); r++)
+   {
+      map< pair<int,int>, Obstacle > next;
+      int c = 0;
+      while (c+1 < cols)
+      {
+         if (cover[r*cols + c] <= 0)
+         {
+            c++;
+            continue;
+         }
+         int start = c;
+         while (c+1 < cols && cover[r*cols + c] > 0)
+            c++;
+
+         pair<int,int> run(ys[start], ys[c]);
+         map< pair<int,int>, Obstacle >::iterator it = growing.find(run);
+         if (it != growing.end())
+         {
+            it->second.R = xs[r+1];
+            next[run] = it->second;
+            growing.erase(it);
+         }
+         else
+         {
+            next[run] = Obstacle(xs[r], xs[r+1], run.first, run.second);
+         }
+      }
+
+      // runs that did not continue are finished
+      for (map< pair<int,int>, Obstacle >::iterator it = growing.begin(); it != growing.end(); it++)
+         out.push_back(it->second);
+      growing.swap(next);
+   }
+   for (map< pair<int,int>, Obstacle >::iterator it = growing.begin(); it != growing.end(); it++)
+      out.push_back(it->second);
+}
+
+
+void Seams::clear()
+{
+   seamsX.clear();
+   seamsY.clear();
+   pinches.clear();
+}
+
+int Seams::covered(const Obstacles& obstacles, const Position& pos, int dx, int dy)
+{
+   int x0 = min(pos.X, pos.X + dx), x1 = max(pos.X, pos.X + dx);
+   int y0 = min(pos.Y, pos.Y + dy), y1 = max(pos.Y, pos.Y + dy);
+   for (int i = 0; i < obstacles.size(); i++)
+      if ( obstacles[i].L <= x0 && x1 <= obstacles[i].R &&
+           obstacles[i].T <= y0 && y1 <= obstacles[i].B )
+         return 1;
+   return 0;
+}
+
+// where a rectangle's side meets another rectangle's opposite side
+static void overlaps(const map<int, vector< pair<int,int> > >& before,
+                     const map<int, vector< pair<int,int> > >& after,
+                     map<int, vector< pair<int,int> > >& seams)
+{
+   map<int, vector< pair<int,int> > >::const_iterator it;
+   for (it = before.begin(); it != before.end(); it++)
+   {
+      map<int, vector< pair<int,int> > >::const_iterator other = after.find(it->first);
+      if (other == after.end())
+         continue;
+      for (int i = 0; i < it->second.size(); i++)
+         for (int j = 0; j < other->second.size(); j++)
+         {
+            int lo = max(it->second[i].first,  other->second[j].first);
+            int hi = min(it->second[i].second, other->second[j].second);
+            if (lo < hi)
+               seams[it->first].push_back(make_pair(lo, hi));
+         }
+   }
+}
+
+// A pinch is a rectangle corner with two covered quadrants facing each
+// other
+void Seams::find(const Obstacles& obstacles)
+{
+   clear();
+
+   map<int, Intervals> endsAtX, startsAtX, endsAtY, startsAtY;
+   vector<Position> all;
+   for (int i = 0; i < obstacles.size(); i++)
+   {
+      const Obstacle& o = obstacles[i];
+      endsAtX[o.R].push_back(make_pair(o.T, o.B));
+      startsAtX[o.L].push_back(make_pair(o.T, o.B));
+      endsAtY[o.B].push_back(make_pair(o.L, o.R));
+      startsAtY[o.T].push_back(make_pair(o.L, o.R));
+      all.push_back(Position(o.L, o.T));
+      all.push_back(Position(o.R, o.T));
+      all.push_back(Position(o.L, o.B));
+      all.push_back(Position(o.R, o.B));
+   }
+   overlaps(endsAtX, startsAtX, seamsX);
+   overlaps(endsAtY, startsAtY, seamsY);
+
+   sort(all.begin(), all.end(), [](const Position& a, const Position& b) {
+      return a.X < b.X || (a.X == b.X && a.Y < b.Y);
+   });
+   for (int i = 0; i < all.size(); i++)
+   {
+      const Position& p = all[i];
+      if (i > 0 && p.X == all[i-1].X && p.Y == all[i-1].Y)
+         continue;
+      int nw = covered(obstacles, p, -1, -1);
+      int ne = covered(obstacles, p,  1, -1);
+      int sw = covered(obstacles, p, -1,  1);
+      int se = covered(obstacles, p,  1,  1);
+      if (nw + ne + sw + se == 2 && nw == se)
+         pinches.push_back(p);
+   }
+}
+
+bool Seams::segmentFree(const Position& a, const Position& b) const
+{
+   if (a.X == b.X || a.Y == b.Y)
+   {
+      bool vertical = a.X == b.X;
+      const map<int, Intervals>& seams = vertical ? seamsX : seamsY;
+      map<int, Intervals>::const_iterator it = seams.find(vertical ? a.X : a.Y);
+      if (it != seams.end())
+      {
+         int lo = vertical ? min(a.Y, b.Y) : min(a.X, b.X);
+         int hi = vertical ? max(a.Y, b.Y) : max(a.X, b.X);
+         for (int i = 0; i < it->second.size(); i++)
+            if (max(lo, it->second[i].first) < min(hi, it->second[i].second))
+               return false;
+      }
+   }
+
+   long long dx = (long long) b.X - a.X;
+   long long dy = (long long) b.Y - a.Y;
+   for (int i = 0; i < pinches.size(); i++)
+   {
+      long long px = (long long) pinches[i].X - a.X;
+      long long py = (long long) pinches[i].Y - a.Y;
+      long long along = px * dx + py * dy;
+      if (px * dy - py * dx == 0 && along > 0 && along < dx * dx + dy * dy)
+         return false;
+   }
+   return true;
+}
@@ -0,0 +1,97 @@
+
+#ifndef CSPACE_H_
+#define CSPACE_H_
+
+#include "consts.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+// An axis-aligned obstacle rectangle covering [L,R) x [T,B)
+struct Obstacle {
+   int L;
+   int R;
+   int T;
+   int B;
+   Obstacle(int _l = 0, int _r = 0, int _t = 0, int _b = 0)
+   : L(_l), R(_r), T(_t), B(_b) {};
+
+   // true if the interiors overlap or the rectangles share an edge
+   bool touches(const Obstacle& other) const {
+      return L <= other.R && other.L <= R && T <= other.B && other.T <= B;
+   }
+};
+
+inline bool operator==(const Obstacle& a, const Obstacle& b) {
+   return a.L == b.L && a.R == b.R && a.T == b.T && a.B == b.B;
+}
+
+typedef std::vector<Obstacle> Obstacles;
+
+/*
+ * Configuration space of a round robot among the boxes.
+ *
+ * Each box is grown by the robot radius (a Minkowski sum with the robot's
+ * disk), the world border is grown inwards by the same amount, and
+ * touching obstacles are merged into disjoint rectangles covering their
+ * union.  The decomposition is exact for axis-aligned rectangles, so the
+ * rounded corners of the Minkowski sum are approximated from outside by a
+ * staircase of cornerSteps steps (1 = square corners).  Results are cached
+ * per radius until the boxes or world change.
+ */
+class CSpace
+{
+public:
+   CSpace();
+   ~CSpace();
+
+   const Obstacles& getObstacles(const Boxes& boxes, int width, int height, int radius);
+   void  invalidate();
+
+   void  setCornerSteps(int steps);
+   int   getCornerSteps() const {return cornerSteps;}
+   int   numCached()      const {return cache.size();}
+
+   // the pieces, exposed for the tools
+   static void inflate(const Box& box, int radius, int steps, Obstacles& out);
+   static void merge(const Obstacles& in, Obstacles& out);
+
+private:
+   int   cornerSteps;
+   std::map<int, Obstacles> cache;  // radius -> merged obstacles
+
+   static void mergeGroup(const Obstacles& group, Obstacles& out);
+};
+
+/*
+ * Where the merged c-space rectangles of one blob touch.
+ *
+ * Each rectangle is open, so a segment running along a side is clear of
+ * it.  Where two rectangles share that side (a seam) or only touch
+ * diagonally at a corner (a pinch) the segment runs through the obstacle
+ * union though, and testing the rectangles one by one misses it.
+ */
+class Seams
+{
+public:
+   void  find(const Obstacles& obstacles);
+   void  clear();
+
+   // false if ab runs along a seam or through a pinch
+   bool  segmentFree(const Position& a, const Position& b) const;
+
+   // 1 if the unit square next to pos towards (dx, dy) is inside an
+   // obstacle (all coordinates are integers, so a square is in or out)
+   static int covered(const Obstacles& obstacles, const Position& pos, int dx, int dy);
+
+private:
+   typedef std::vector< std::pair<int,int> > Intervals;
+
+   // open intervals where rectangles touch on both sides of a line
+   std::map<int, Intervals> seamsX;  // x -> y intervals
+   std::map<int, Intervals> seamsY;  // y -> x intervals
+   std::vector<Position>    pinches;
+};
+
+#endif
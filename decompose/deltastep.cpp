@@ -0,0 +1,167 @@
+
+#include "deltastep.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+// frontier nodes per parallel chunk; tiny frontiers run on the caller
+const int RELAX_GRAIN = 256;
+
+DeltaStepping::DeltaStepping(ThreadPool* _pool)
+: pool(_pool),
+delta(1),
+size(0),
+pass(0)
+{
+}
+
+DeltaStepping::~DeltaStepping()
+{
+}
+
+template <int D>
+Cost DeltaStepping::defaultDelta(const vector<NodeT<D>*>& nodes)
+{
+   Cost total = 0;
+   long long count = 0;
+   for (int i = 0; i < nodes.size(); i++)
+   {
+      for (int e = 0; e < nodes[i]->edges.size(); e++)
+         total += nodes[i]->edges[e].weight;
+      count += nodes[i]->edges.size();
+   }
+   return count > 0 ? max((Cost) 1, total / count) : 1;
+}
+
+// keep each node once per pass, and only if it still belongs to the
+// bucket being processed (stale copies are left behind when dist drops)
+void DeltaStepping::dedupe(vector<int>& list)
+{
+   pass++;
+   int kept = 0;
+   for (int i = 0; i < list.size(); i++)
+   {
+      int v = list[i];
+      if (stamp[v] == pass)
+         continue;
+      stamp[v] = pass;
+      list[kept++] = v;
+   }
+   list.resize(kept);
+}
+
+// relax the light or heavy edges out of every frontier node in parallel
+template <int D>
+void DeltaStepping::relax(const vector<NodeT<D>*>& nodes, const vector<int>& frontier, bool light)
+{
+   pool->parallelFor(frontier.size(), RELAX_GRAIN, [&](int begin, int end, int worker) {
+      vector<int>& out = improved[worker];
+      for (int i = begin; i < end; i++)
+      {
+         const NodeT<D>* u = nodes[frontier[i]];
+         Cost du = dist[u->index].load(memory_order_relaxed);
+         for (int e = 0; e < u->edges.size(); e++)
+         {
+            const EdgeT<D>& edge = u->edges[e];
+            if ( (edge.weight <= delta) != light )
+               continue;
+
+            // atomic min
+            int  v  = edge.dest->index;
+            Cost nd = du + edge.weight;
+            Cost old = dist[v].load(memory_order_relaxed);
+            while (nd < old)
+            {
+               if (dist[v].compare_exchange_weak(old, nd, memory_order_relaxed))
+               {
+                  out.push_back(v);
+                  break;
+               }
+            }
+         }
+      }
+   });
+}
+
+// move the improved nodes into the buckets of their new distances
+void DeltaStepping::collect()
+{
+   for (int w = 0; w < improved.size(); w++)
+   {
+      for (int i = 0; i < improved[w].size(); i++)
+      {
+         int  v = improved[w][i];
+         long b = dist[v].load(memory_order_relaxed) / delta;
+         if (b >= buckets.size())
+            buckets.resize(b + 1);
+         buckets[b].push_back(v);
+      }
+      improved[w].clear();
+   }
+}
+
+template <int D>
+void DeltaStepping::run(const vector<NodeT<D>*>& nodes, NodeT<D>* src, NodeT<D>* dest, Cost _delta)
+{
+   delta = _delta > 0 ? _delta : defaultDelta(nodes);
+
+   if (size != nodes.size())
+   {
+      size = nodes.size();
+      dist.reset(new atomic<Cost>[size]);
+      stamp.assign(size, 0);
+      pass = 0;
+   }
+   for (int i = 0; i < size; i++)
+      dist[i].store(COST_INF, memory_order_relaxed);
+   improved.assign(pool->size(), vector<int>());
+   buckets.clear();
+
+   dist[src->index].store(0);
+   buckets.push_back(vector<int>(1, src->index));
+
+   vector<int> frontier;
+   vector<int> settled;
+   for (long i = 0; i < buckets.size(); i++)
+   {
+      settled.clear();
+      while (!buckets[i].empty())
+      {
+         frontier.swap(buckets[i]);
+         buckets[i].clear();
+
+         // drop copies whose node has since moved to a lower bucket
+         int kept = 0;
+         for (int j = 0; j < frontier.size(); j++)
+            if (dist[frontier[j]].load(memory_order_relaxed) / delta == i)
+               frontier[kept++] = frontier[j];
+         frontier.resize(kept);
+         dedupe(frontier);
+
+         settled.insert(settled.end(), frontier.begin(), frontier.end());
+         relax(nodes, frontier, true);
+         collect();
+      }
+
+      dedupe(settled);
+      relax(nodes, settled, false);
+      collect();
+
+      // dest is final once its bucket is done
+      if (dest && dist[dest->index].load() / delta <= i)
+         break;
+   }
+
+   for (int i = 0; i < size; i++)
+   {
+      nodes[i]->dist  = dist[i].load(memory_order_relaxed);
+      nodes[i]->spset = nodes[i]->dist != COST_INF;
+   }
+}
+
+template void DeltaStepping::run<2>(const Nodes&, Node*, Node*, Cost);
+template void DeltaStepping::run<3>(const Nodes3&, Node3*, Node3*, Cost);
+template Cost DeltaStepping::defaultDelta<2>(const Nodes&);
+template Cost DeltaStepping::defaultDelta<3>(const Nodes3&);
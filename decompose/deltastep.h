@@ -0,0 +1,55 @@
+
+#ifndef DELTASTEP_H_
+#define DELTASTEP_H_
+
+#include "consts.h"
+#include "threadpool.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+/*
+ * Parallel delta-stepping single source shortest paths (Meyer & Sanders).
+ *
+ * Nodes are kept in buckets of width delta.  All nodes of the lowest
+ * bucket are relaxed at once across the thread pool: light edges
+ * (weight <= delta) until the bucket stops refilling, then heavy edges once.
+ * Distances are updated with an atomic min, so they come out exactly as
+ * Dijkstra's would for the integer Cost type, whatever the thread count.
+ */
+class DeltaStepping
+{
+public:
+   DeltaStepping(ThreadPool* _pool);
+   ~DeltaStepping();
+
+   // Fill in dist for the nodes, stopping once dest (if any) is final.
+   // Everything closer than dest is final too, so tracing a path from
+   // dest back to src only ever sees exact distances.
+   // (instantiated for 2D and 3D cell graphs)
+   template <int D>
+   void  run(const std::vector<NodeT<D>*>& nodes, NodeT<D>* src, NodeT<D>* dest, Cost delta = 0);
+
+   // bucket width used when run() is given none: the mean edge weight
+   template <int D>
+   static Cost defaultDelta(const std::vector<NodeT<D>*>& nodes);
+
+private:
+   ThreadPool* pool;
+   Cost        delta;
+   int         size;
+   std::unique_ptr< std::atomic<Cost>[] > dist;
+
+   std::vector< std::vector<int> > buckets;
+   std::vector< std::vector<int> > improved; // per worker, nodes whose dist dropped
+   std::vector<int>  stamp;                  // dedupes nodes within one pass
+   int               pass;
+
+   template <int D>
+   void  relax(const std::vector<NodeT<D>*>& nodes, const std::vector<int>& frontier, bool light);
+   void  collect();
+   void  dedupe(std::vector<int>& list);
+};
+
+#endif
@@ -0,0 +1,254 @@
+
+#include "fleet.h"
+#include "manager.h"
+
+#include <algorithm>
+#include <iostream>
+#include <queue>
+#include <unordered_set>
+
+using namespace std;
+
+
+// (node, time step) packed into one hash key
+static inline unsigned long long stateKey(int node, int t)
+{
+   return ((unsigned long long) node << 32) | (unsigned int) t;
+}
+
+Fleet::Fleet(Manager* _manager)
+: manager(_manager),
+horizon(0),
+slack(64)
+{
+}
+
+Fleet::~Fleet()
+{
+}
+
+void Fleet::addRobot(Position start, Position goal)
+{
+   starts.push_back(start);
+   goals.push_back(goal);
+}
+
+void Fleet::clearRobots()
+{
+   starts.clear();
+   goals.clear();
+   paths.clear();
+   steps.clear();
+}
+
+int Fleet::getMakespan() const
+{
+   int makespan = 0;
+   for (int i = 0; i < steps.size(); i++)
+      makespan = max(makespan, (int) steps[i].size() - 1);
+   return makespan;
+}
+
+// Hop counts from every cell to goal over the static graph, a lower bound
+// on the number of steps whatever the other robots do.  Robots sharing a
+// goal share the table.
+const vector<int>& Fleet::hopsTo(int goal)
+{
+   unordered_map< int, vector<int> >::iterator found = hops.find(goal);
+   if (found != hops.end())
+      return found->second;
+
+   const Nodes& nodes = manager->getNodes();
+   vector<int>& dist = hops[goal];
+   dist.assign(nodes.size(), -1);
+
+   // edges are symmetric, so a forward BFS from goal gives the hops to it
+   vector<int> queue(1, goal);
+   dist[goal] = 0;
+   for (int q = 0; q < queue.size(); q++)
+   {
+      const Node* u = nodes[queue[q]];
+      for (int e = 0; e < u->edges.size(); e++)
+      {
+         int v = u->edges[e].dest->index;
+         if (dist[v] < 0)
+         {
+            dist[v] = dist[u->index] + 1;
+            queue.push_back(v);
+         }
+      }
+   }
+   return dist;
+}
+
+bool Fleet::isFree(int node, int t) const
+{
+   if (parkedFrom[node] >= 0 && parkedFrom[node] <= t)
+      return false;
+   return vertexTable.find(stateKey(node, t)) == vertexTable.end();
+}
+
+// would moving from -> to during step t swap places with a planned robot?
+// (only one robot can leave a cell at a given step, so (to, t) is enough)
+bool Fleet::isSwap(int from, int to, int t) const
+{
+   unordered_map<unsigned long long, int>::const_iterator found =
+      edgeTable.find(stateKey(to, t));
+   return found != edgeTable.end() && found->second == from;
+}
+
+int Fleet::plan()
+{
+   paths.assign(starts.size(), Path());
+   steps.assign(starts.size(), vector<int>());
+
+   // the roadmap and visibility graph have no cells to reserve
+   if (!manager->hasCells())
+   {
+      cout << "ERROR: fleet planning needs the grid or quadtree decomposition" << endl;
+      return 0;
+   }
+   if (!manager->cellsAreCurrent())
+   {
+      manager->clearCells();
+      manager->decompose();
+      manager->connectCells();
+   }
+
+   const Nodes& nodes = manager->getNodes();
+   vertexTable.clear();
+   edgeTable.clear();
+   parkedFrom.assign(nodes.size(), -1);
+   lastReserved.assign(nodes.size(), -1);
+   hops.clear();
+   horizon = 0;
+
+   int planned = 0;
+   for (int i = 0; i < starts.size(); i++)
+   {
+      Node* start = manager->findNode(starts[i]);
+      Node* goal  = manager->findNode(goals[i]);
+      if (!start || !goal || !start->cell.isValid || !goal->cell.isValid)
+         continue;
+
+      if (planRobot(i, start->index, goal->index))
+      {
+         reserve(i);
+         planned++;
+      }
+   }
+   return planned;
+}
+
+// Space-time A* for one robot.  g is the time step, h the hop count to
+// the goal; a step costs 1 whether it moves or waits.
+bool Fleet::planRobot(int robot, int start, int goal)
+{
+   const Nodes&       nodes = manager->getNodes();
+   const vector<int>& h     = hopsTo(goal);
+   if (h[start] < 0 || !isFree(start, 0))
+      return false;
+
+   // give up once the robot could have arrived long after everyone parked
+   int maxT = horizon + h[start] + slack;
+
+   // (f, -t, node): lowest f first, latest step on ties
+   typedef pair< int, pair<int, int> > OpenEntry;
+   priority_queue<OpenEntry, vector<OpenEntry>, greater<OpenEntry> > open;
+   unordered_map<unsigned long long, unsigned long long> parent;
+   unordered_set<unsigned long long> closed;
+
+   parent[stateKey(start, 0)] = stateKey(start, 0);
+   open.push(OpenEntry(h[start], make_pair(0, start)));
+
+   while (!open.empty())
+   {
+      OpenEntry top = open.top();
+      open.pop();
+      int t    = -top.second.first;
+      int node = top.second.second;
+      unsigned long long key = stateKey(node, t);
+      if (!closed.insert(key).second)
+         continue;
+
+      // arrived, and nobody planned earlier passes through the goal later
+      if (node == goal && t > lastReserved[goal])
+      {
+         vector<int>& path = steps[robot];
+         path.assign(t + 1, 0);
+         for (int s = t; s >= 0; s--)
+         {
+            path[s] = (int) (key >> 32);
+            key = parent[key];
+         }
+         for (int s = 0; s < path.size(); s++)
+            paths[robot].push_back(nodes[path[s]]->cell);
+         return true;
+      }
+      if (t >= maxT)
+         continue;
+
+      // wait, or move to a free neighbor without swapping with anyone
+      const Node* u = nodes[node];
+      for (int e = -1; e < (int) u->edges.size(); e++)
+      {
+         int next = e < 0 ? node : u->edges[e].dest->index;
+         if (h[next] < 0 || !isFree(next, t + 1))
+            continue;
+         if (next != node && isSwap(node, next, t))
+            continue;
+
+         unsigned long long nextKey = stateKey(next, t + 1);
+         if (closed.count(nextKey) || parent.count(nextKey))
+            continue;
+         parent[nextKey] = key;
+         open.push(OpenEntry(t + 1 + h[next], make_pair(-(t + 1), next)));
+      }
+   }
+   return false;
+}
+
+void Fleet::reserve(int robot)
+{
+   const vector<int>& path = steps[robot];
+   for (int t = 0; t < path.size(); t++)
+   {
+      vertexTable[stateKey(path[t], t)] = robot;
+      lastReserved[path[t]] = max(lastReserved[path[t]], t);
+      if (t + 1 < path.size() && path[t+1] != path[t])
+         edgeTable[stateKey(path[t], t)] = path[t+1];
+   }
+   parkedFrom[path.back()] = path.size() - 1;
+   horizon = max(horizon, (int) path.size() - 1);
+}
+
+// Check every pair of planned robots at every step, parked robots included
+int Fleet::countConflicts() const
+{
+   int conflicts = 0;
+   int makespan  = getMakespan();
+   for (int a = 0; a < steps.size(); a++)
+   {
+      if (steps[a].empty())
+         continue;
+      for (int b = a + 1; b < steps.size(); b++)
+      {
+         if (steps[b].empty())
+            continue;
+         const vector<int>& pa = steps[a];
+         const vector<int>& pb = steps[b];
+         for (int t = 0; t <= makespan; t++)
+         {
+            int a0 = pa[min(t, (int) pa.size() - 1)];
+            int b0 = pb[min(t, (int) pb.size() - 1)];
+            int a1 = pa[min(t + 1, (int) pa.size() - 1)];
+            int b1 = pb[min(t + 1, (int) pb.size() - 1)];
+            if (a0 == b0)
+               conflicts++;
+            else if (t < makespan && a0 == b1 && a1 == b0)
+               conflicts++;
+         }
+      }
+   }
+   return conflicts;
+}
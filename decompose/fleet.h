@@ -0,0 +1,77 @@
+
+#ifndef FLEET_H_
+#define FLEET_H_
+
+#include "consts.h"
+
+#include <unordered_map>
+#include <vector>
+
+class Manager;
+
+/*
+ * Prioritized multi-robot planning on the manager's cell graph.
+ *
+ * Robots are planned one at a time in the order they were added.  Each
+ * one runs A* over (cell, time step) states, where a step either moves
+ * to a neighboring cell or waits, and steers clear of the robots planned
+ * before it through a hashed reservation table:
+ *    - vertex conflicts: two robots in the same cell at the same step
+ *    - edge conflicts:   two robots swapping cells during the same step
+ * A robot that reaches its goal stays there, so its goal cell is blocked
+ * from its arrival on.  All robots share one static decomposition.
+ */
+class Fleet
+{
+public:
+   Fleet(Manager* _manager);
+   ~Fleet();
+
+   void  addRobot(Position start, Position goal);
+   void  clearRobots();
+
+   // decompose (unless the manager's cells are current) and plan every
+   // robot, returns the number that found a plan.  Needs the grid or
+   // quadtree decomposition, plans nothing on the others.
+   int   plan();
+
+   int   numRobots()            const {return starts.size();}
+   bool  isPlanned(int robot)   const {return !paths[robot].empty();}
+   // the robot's cell at every time step, from start to goal (waits repeat)
+   const Path& getPath(int robot) const {return paths[robot];}
+   int   getMakespan()          const;
+
+   // extra steps beyond the shortest possible arrival that a robot may
+   // spend waiting and detouring (after everyone planned before it parks)
+   void  setSlack(int _slack)   {slack = _slack;}
+
+   // vertex and edge conflicts between the planned robots (0 if the
+   // reservations did their job)
+   int   countConflicts() const;
+
+private:
+   Manager* manager;
+
+   std::vector<Position>          starts;
+   std::vector<Position>          goals;
+   std::vector<Path>              paths;
+   std::vector< std::vector<int> > steps; // node index per time step
+
+   // reservations of the robots planned so far
+   std::unordered_map<unsigned long long, int> vertexTable; // (node, t) -> robot
+   std::unordered_map<unsigned long long, int> edgeTable;   // (from, t) -> to
+   std::vector<int>  parkedFrom;   // per node, the step a robot parks there for good
+   std::vector<int>  lastReserved; // per node, the last step anyone passes through
+   int               horizon;      // last step of any plan so far
+   int               slack;
+
+   std::unordered_map< int, std::vector<int> > hops; // goal -> hop counts to it
+
+   const std::vector<int>& hopsTo(int goal);
+   bool  isFree(int node, int t) const;
+   bool  isSwap(int from, int to, int t) const;
+   bool  planRobot(int robot, int start, int goal);
+   void  reserve(int robot);
+};
+
+#endif
@@ -0,0 +1,92 @@
+
+#include "kdtree.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+KdTree::KdTree()
+{
+}
+
+KdTree::~KdTree()
+{
+}
+
+void KdTree::build(const vector<Position>& _points)
+{
+   points = _points;
+   order.resize(points.size());
+   for (int i = 0; i < order.size(); i++)
+      order[i] = i;
+   build(0, order.size(), 0);
+}
+
+void KdTree::build(int begin, int end, int axis)
+{
+   if (end - begin <= 1)
+      return;
+   int mid = begin + (end - begin) / 2;
+   const vector<Position>& p = points;
+   nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+               [&](int a, int b) {
+                  return axis == 0 ? p[a].X < p[b].X : p[a].Y < p[b].Y;
+               });
+   build(begin, mid, 1 - axis);
+   build(mid + 1, end, 1 - axis);
+}
+
+// heap is a max-heap on squared distance holding the best k so far
+void KdTree::search(int begin, int end, int axis, const Position& pos, int k,
+                    vector< pair<double, int> >& heap) const
+{
+   if (begin >= end)
+      return;
+   int mid = begin + (end - begin) / 2;
+   const Position& p = points[order[mid]];
+
+   double dx = (double) p.X - pos.X;
+   double dy = (double) p.Y - pos.Y;
+   double d  = dx*dx + dy*dy;
+   if (heap.size() < k)
+   {
+      heap.push_back(make_pair(d, order[mid]));
+      push_heap(heap.begin(), heap.end());
+   }
+   else if (d < heap.front().first)
+   {
+      pop_heap(heap.begin(), heap.end());
+      heap.back() = make_pair(d, order[mid]);
+      push_heap(heap.begin(), heap.end());
+   }
+
+   // near side first, the far side only if the splitting line is closer
+   // than the worst point kept
+   double split = axis == 0 ? dx : dy;
+   bool   left  = split > 0;
+   if (left)
+      search(begin, mid, 1 - axis, pos, k, heap);
+   else
+      search(mid + 1, end, 1 - axis, pos, k, heap);
+   if (heap.size() < k || split * split < heap.front().first)
+   {
+      if (left)
+         search(mid + 1, end, 1 - axis, pos, k, heap);
+      else
+         search(begin, mid, 1 - axis, pos, k, heap);
+   }
+}
+
+void KdTree::nearest(const Position& pos, int k, vector<int>& out) const
+{
+   vector< pair<double, int> > heap;
+   heap.reserve(k + 1);
+   if (k > 0)
+      search(0, order.size(), 0, pos, k, heap);
+
+   sort_heap(heap.begin(), heap.end());
+   out.resize(heap.size());
+   for (int i = 0; i < heap.size(); i++)
+      out[i] = heap[i].second;
+}
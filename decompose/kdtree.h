@@ -0,0 +1,38 @@
+
+#ifndef KDTREE_H_
+#define KDTREE_H_
+
+#include "consts.h"
+
+#include <vector>
+
+/*
+ * Static 2D kd-tree over a set of points for k-nearest neighbor queries.
+ *
+ * The tree is implicit: build() orders an index array so that every
+ * subrange has its median (on alternating axes) in the middle.
+ */
+class KdTree
+{
+public:
+   KdTree();
+   ~KdTree();
+
+   void  build(const std::vector<Position>& _points);
+
+   // indices of the (up to) k points closest to pos, nearest first.
+   // Points exactly at pos count too.
+   void  nearest(const Position& pos, int k, std::vector<int>& out) const;
+
+   int   size() const {return order.size();}
+
+private:
+   std::vector<Position> points;
+   std::vector<int>      order;
+
+   void  build(int begin, int end, int axis);
+   void  search(int begin, int end, int axis, const Position& pos, int k,
+                std::vector< std::pair<double, int> >& heap) const;
+};
+
+#endif
@@ -0,0 +1,214 @@
+
+/*
+   Load generator for decompose_service: every connection sends its scene
+   inline once, then refers to it by id.  Reports request latency
+   percentiles and throughput.
+ */
+
+#include "consts.h"
+#include "protocol.h"
+#include "scene.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+static double now()
+{
+   return chrono::duration<double>(
+          chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static int connectTo(const string& path)
+{
+   sockaddr_un addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+   int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (fd >= 0 && connect(fd, (sockaddr*) &addr, sizeof(addr)) < 0)
+   {
+      close(fd);
+      fd = -1;
+   }
+   return fd;
+}
+
+struct ClientStats {
+   vector<double> latencies;   // seconds per request
+   int            answered;    // requests answered with STATUS_OK
+   long long      paths;       // queries answered with a path
+   int            failures;    // transport errors or bad status
+   ClientStats() : answered(0), paths(0), failures(0) {};
+};
+
+static void runClient(const string& path, const Scene& scene, int requests,
+                      int queries, unsigned int seed, bool smooth,
+                      ClientStats& stats)
+{
+   int fd = connectTo(path);
+   if (fd < 0)
+   {
+      stats.failures += requests;
+      return;
+   }
+
+   PlanRequest  request;
+   PlanResponse response;
+   vector<char> out, in;
+   request.flags = smooth ? FLAG_SMOOTH : 0;
+   request.scene = scene;
+   request.sceneId = 0;
+
+   for (int r = 0; r < requests; r++)
+   {
+      request.type = request.sceneId ? REQUEST_SCENE_ID : REQUEST_INLINE;
+      generateRobots(scene, queries, seed + r, request.starts, request.goals);
+      encodeRequest(request, out);
+
+      double start = now();
+      bool ok = writeFrame(fd, out) && readFrame(fd, in) &&
+                decodeResponse(in, response);
+      stats.latencies.push_back(now() - start);
+
+      if (!ok)
+      {
+         stats.failures += requests - r;
+         break;
+      }
+      if (response.status == STATUS_UNKNOWN_SCENE)
+      {
+         request.sceneId = 0;   // evicted, resend inline next time
+         stats.failures++;
+         continue;
+      }
+      if (response.status != STATUS_OK || response.results.size() != queries)
+      {
+         stats.failures++;
+         continue;
+      }
+      stats.answered++;
+      request.sceneId = response.sceneId;
+      for (int q = 0; q < response.results.size(); q++)
+         if (response.results[q].cost != COST_INF)
+            stats.paths++;
+   }
+   close(fd);
+}
+
+static double percentile(const vector<double>& sorted, double p)
+{
+   if (sorted.empty())
+      return 0;
+   int at = min((int) sorted.size() - 1, (int) (p * sorted.size()));
+   return sorted[at];
+}
+
+void printUsage()
+{
+   cout << "Usage: decompose_loadgen (-s socket) (-c connections) (-n requests) (-q queries)" << endl;
+   cout << "                         (-b boxes) (-w world_size) (-r seed) (-S)" << endl;
+   cout << "   Where" << endl;
+   cout << "         -s    Socket path (default /tmp/decompose.sock)" << endl;
+   cout << "         -c    Concurrent connections (default 4)" << endl;
+   cout << "         -n    Requests per connection (default 200)" << endl;
+   cout << "         -q    Start / goal pairs per request (default 16)" << endl;
+   cout << "         -b    Boxes per scene (default 100)" << endl;
+   cout << "         -w    World width and height (default 100000)" << endl;
+   cout << "         -r    Random seed (default 1)" << endl;
+   cout << "         -S    Ask for smoothed paths" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+   string path = "/tmp/decompose.sock";
+   int  clients  = 4;
+   int  requests = 200;
+   int  queries  = 16;
+   int  boxes    = 100;
+   int  world    = 100000;
+   unsigned int seed = 1;
+   bool smooth   = false;
+
+   int c;
+   while((c = getopt (argc, argv, "s:c:n:q:b:w:r:S")) != -1)
+   switch (c)
+   {
+      case 's':
+         path = optarg;
+         break;
+      case 'c':
+         clients = max(1, atoi(optarg));
+         break;
+      case 'n':
+         requests = max(1, atoi(optarg));
+         break;
+      case 'q':
+         queries = max(1, atoi(optarg));
+         break;
+      case 'b':
+         boxes = atoi(optarg);
+         break;
+      case 'w':
+         world = atoi(optarg);
+         break;
+      case 'r':
+         seed = atoi(optarg);
+         break;
+      case 'S':
+         smooth = true;
+         break;
+      default:
+         printUsage();
+         exit(1);
+   }
+
+   // two scenes shared between the connections so the cache gets reused
+   Scene scenes[2] = {generateScene(world, world, boxes, seed),
+                      generateScene(world, world, boxes, seed + 1)};
+
+   vector<ClientStats> stats(clients);
+   vector<thread> threads;
+   double start = now();
+   for (int i = 0; i < clients; i++)
+      threads.push_back(thread(runClient, path, scenes[i % 2], requests, queries,
+                               seed * 7919 + i * 104729, smooth, ref(stats[i])));
+   for (int i = 0; i < threads.size(); i++)
+      threads[i].join();
+   double elapsed = now() - start;
+
+   vector<double> all;
+   long long paths = 0;
+   int answered = 0, failures = 0;
+   for (int i = 0; i < clients; i++)
+   {
+      all.insert(all.end(), stats[i].latencies.begin(), stats[i].latencies.end());
+      answered += stats[i].answered;
+      paths    += stats[i].paths;
+      failures += stats[i].failures;
+   }
+   sort(all.begin(), all.end());
+
+   cout << clients << " connections x " << requests << " requests x "
+        << queries << " queries, " << boxes << " boxes, "
+        << world << "x" << world << (smooth ? ", smoothed" : "") << endl;
+   printf("   p50 %.3f ms   p99 %.3f ms   max %.3f ms\n",
+          percentile(all, 0.50) * 1000, percentile(all, 0.99) * 1000,
+          all.empty() ? 0 : all.back() * 1000);
+   printf("   %.0f requests/s   %.0f queries/s   %lld paths   %d failures\n",
+          answered / elapsed, (double) answered * queries / elapsed,
+          paths, failures);
+   return failures ? 1 : 0;
+}
@@ -9,6 +9,7 @@
 #include <QApplication>
 #include <QDebug>
 
+#include <algorithm>
 #include <cmath>
 #include <unistd.h>
 #include <time.h>
@@ -19,10 +20,11 @@ using namespace std;
 
 void printUsage()
 {
-   cout << "Usage: vehicles (-c num_cars) (-l num_lights)" << endl;
+   cout << "Usage: decompose (-w world_width) (-h world_height) (-v speed)" << endl;
    cout << "   Where" << endl; 
-   cout << "         -c    Number of cars to create initially" << endl;
-   cout << "         -l    Number of lights to create initially" << endl;
+   cout << "         -w    Width of the world (default " << WIDTH << ")" << endl;
+   cout << "         -h    Height of the world (default " << HEIGHT << ")" << endl;
+   cout << "         -v    Robot speed along the path, world units per second (default 100)" << endl;
 }
 
 int main(int argc, char* argv[])
@@ -31,16 +33,48 @@ int main(int argc, char* argv[])
 	
 	srand(time(NULL));
 
+   // parse args
+   int width  = WIDTH;
+   int height = HEIGHT;
+   double speed = 100;
+   int c = 0;
+
+   // get command line args
+   while((c = getopt (argc, argv, "w:h:v:")) != -1)
+   switch(c)
+   {
+      case 'w': // world width
+         width = atoi(optarg);
+         break;
+
+      case 'h': // world height
+         height = atoi(optarg);
+         break;
+
+      case 'v': // robot speed
+         speed = atof(optarg);
+         break;
+
+      default:
+         printUsage();
+         exit(1);
+   }
+
    // create the manager
-   Manager* manager = new Manager();
+   Manager* manager = new Manager(width, height);
+   manager->setSpeed(speed);
+
+   // scale the fixed box sizes and margin with the world
+   double scale  = (double) min(width, height) / min(WIDTH, HEIGHT);
+   int    buffer = BUFFER * scale;
 	
    // Create randomly placed obstacles
 	Position pos;
 	for (int i=0; i<NUM_BOXES; i++)
 	{	
 		do {
-			int x = rand() % (WIDTH-BUFFER*2) + BUFFER;
-			int y = rand() % (HEIGHT-BUFFER*2) + BUFFER;
+			int x = rand() % (width-buffer*2) + buffer;
+			int y = rand() % (height-buffer*2) + buffer;
 			pos = Position(x,y);
 		}
 		while (manager->isCollision(pos) != -1);
@@ -49,26 +83,26 @@ int main(int argc, char* argv[])
 	}
 	
 	// Set box sizes
-	manager->setBoxSize(0, BOX0_SIZE);
-	manager->setBoxSize(1, BOX1_SIZE);
-	manager->setBoxSize(2, BOX2_SIZE);
+	manager->setBoxSize(0, BOX0_SIZE * scale);
+	manager->setBoxSize(1, BOX1_SIZE * scale);
+	manager->setBoxSize(2, BOX2_SIZE * scale);
 	
 	// Robot
 	do {
-		int x = rand() % (WIDTH-BUFFER*2) + BUFFER;
-		int y = rand() % (HEIGHT-BUFFER*2) + BUFFER;
+		int x = rand() % (width-buffer*2) + buffer;
+		int y = rand() % (height-buffer*2) + buffer;
 		pos = Position(x,y);
 	}
-	while (manager->isCollision(pos) != -1);
+	while (!manager->isFree(pos));	// clear of the boxes grown by the robot radius
 	manager->setRobot(pos);
 	
 	// Destination
 	do {
-		int x = rand() % (WIDTH-BUFFER*2) + BUFFER;
-		int y = rand() % (HEIGHT-BUFFER*2) + BUFFER;
+		int x = rand() % (width-buffer*2) + buffer;
+		int y = rand() % (height-buffer*2) + buffer;
 		pos = Position(x,y);
 	}
-	while (manager->isCollision(pos) != -1);
+	while (!manager->isFree(pos));
 	manager->setDest(pos);
 	
 	
@@ -1,42 +1,149 @@
 
 #include "manager.h"
+#include "deltastep.h"
+#include "search.h"
+#include "threadpool.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <vector>
-#include <list>
 
 using namespace std;
 
 
-Manager::Manager()
+Manager::Manager(int _width, int _height)
+: width(_width),
+height(_height),
+robotRadius(ROBOT_RADIUS),
+roadmapCost(COST_INF),
+cellsCurrent(false),
+smoothing(false),
+decompMode(DECOMP_GRID),
+minCellSize(0),
+srcNode(NULL),
+destNode(NULL),
+searchMode(SEARCH_DIJKSTRA),
+threads(0),
+delta(0),
+pool(NULL),
+stepper(NULL),
+followIndex(0),
+followX(0),
+followY(0),
+following(false),
+speed(100),
+tickRate(100),
+lastStep(-1),
+accumulator(0),
+motionRevision(0)
 {
 	for (int i=0; i<NUM_BOXES; i++)
 	{
 		boxes.push_back(Box());
 	}
 	pathDrawn = false;
+	revision = 0;
 }
 
 Manager::~Manager()
 {
+	clearCells();
+	delete stepper;
+	delete pool;
 }
 
 // Return the node with this cell
 Node* Manager::getNode(const Cell& cell) const
 {
-   for (int i = 0; i < nodes.size(); i++)
+   if (decompMode == DECOMP_QUADTREE)
    {
-      if (cell == nodes[i]->cell)
-      {
-         return nodes[i];
-      }
+      int leaf = quadtree.locate(cell.L, cell.T);
+      if (leaf >= 0 && leaf < nodes.size() && cell == nodes[leaf]->cell)
+         return nodes[leaf];
+      return NULL;
    }
+
+   // the cell edges are sorted, so find its row and column directly
+   int r = lower_bound(xcoords.begin(), xcoords.end(), cell.L) - xcoords.begin();
+   int c = lower_bound(ycoords.begin(), ycoords.end(), cell.T) - ycoords.begin();
+   Node* node = getNode(r, c);
+   if (node && cell == node->cell)
+      return node;
    
    return NULL;
 }
 
+// Return the node of cells[r][c]
+Node* Manager::getNode(int r, int c) const
+{
+   if (r < 0 || r >= getCellRows() || c < 0 || c >= getCellCols())
+      return NULL;
+   return nodes[r*getCellCols() + c];
+}
+
+// Return the node whose cell contains pos, NULL outside the cells
+// The cell holding pos.  A point on the border of an occupied cell is
+// still free (paths may run along obstacles), so then take the free cell
+// on the other side of the border.
+Node* Manager::findNode(const Position& pos) const
+{
+   Node* node = locateNode(pos);
+   if (node && node->cell.isValid)
+      return node;
+
+   for (int i = 1; i < 4; i++)
+   {
+      Node* other = locateNode(Position(pos.X - (i & 1), pos.Y - (i >> 1)));
+      if ( other && other->cell.isValid &&
+           other->cell.L <= pos.X && pos.X <= other->cell.R &&
+           other->cell.T <= pos.Y && pos.Y <= other->cell.B )
+         return other;
+   }
+   return node;
+}
+
+// findNode() for the robot and dest.  A quadtree leaf of the smallest
+// size that is only partly inside an obstacle counts as occupied, so a
+// free end may fall in one; then take the nearest free leaf across its
+// sides, as Planner3D::findNode() does across faces.
+Node* Manager::findEnd(const Position& pos)
+{
+   Node* node = findNode(pos);
+   if (!node || node->cell.isValid || decompMode != DECOMP_QUADTREE || !isFree(pos))
+      return node;
+
+   vector<int> next;
+   quadtree.neighbors(node->index, next);
+   Cost nearest = COST_INF;
+   for (int n = 0; n < next.size(); n++)
+   {
+      Node* other = nodes[next[n]];
+      Cost d = distance(pos, other->cell.pos);
+      if (other->cell.isValid && d < nearest)
+      {
+         node    = other;
+         nearest = d;
+      }
+   }
+   return node;
+}
+
+Node* Manager::locateNode(const Position& pos) const
+{
+   if (decompMode == DECOMP_QUADTREE)
+   {
+      int leaf = quadtree.locate(pos.X, pos.Y);
+      return leaf >= 0 && leaf < nodes.size() ? nodes[leaf] : NULL;
+   }
+
+   // the last cell edge at or left of (above) pos
+   int r = upper_bound(xcoords.begin(), xcoords.end(), pos.X) - xcoords.begin() - 1;
+   int c = upper_bound(ycoords.begin(), ycoords.end(), pos.Y) - ycoords.begin() - 1;
+   return getNode(r, c);
+}
+
 // Return true if cell is within boundaries and the cell is not in a box
 bool Manager::isValidCell(int r, int c) const
 {
@@ -48,10 +155,94 @@ bool Manager::isValidCell(int r, int c) const
    return validCell;
 }
 
-// Called from window
+// longest stretch of real time one timeStep() catches up on, so a stalled
+// UI does not make the robot jump or the loop spiral
+const double MAX_CATCH_UP = 0.25;
+
+// Called from window: advance the follower at the fixed tick rate,
+// however often the window's timer fires
 void Manager::timeStep()
 {
-	
+   double now = chrono::duration<double>(
+                chrono::steady_clock::now().time_since_epoch()).count();
+   if (lastStep < 0 || !following)
+   {
+      lastStep = now;
+      accumulator = 0;
+      return;
+   }
+
+   accumulator = min(accumulator + now - lastStep, MAX_CATCH_UP);
+   lastStep = now;
+
+   double dt = 1.0 / tickRate;
+   while (accumulator >= dt && following)
+   {
+      tick();
+      accumulator -= dt;
+   }
+}
+
+// Move speed / tickRate along the path.  Returns false once at dest.
+bool Manager::tick()
+{
+   if (!following)
+      return false;
+
+   double step = speed / tickRate;
+   while (step > 0 && followIndex + 1 < followPath.size())
+   {
+      const Position& next = followPath[followIndex + 1];
+      double dx = next.X - followX;
+      double dy = next.Y - followY;
+      double d  = sqrt(dx*dx + dy*dy);
+      if (d <= step)
+      {
+         followX = next.X;
+         followY = next.Y;
+         followIndex++;
+         step -= d;
+      }
+      else
+      {
+         followX += dx * step / d;
+         followY += dy * step / d;
+         step = 0;
+      }
+   }
+
+   robot = Position(lround(followX), lround(followY));
+   motionRevision++;
+   if (followIndex + 1 >= followPath.size())
+      following = false;
+   return following;
+}
+
+// Run ticks until the robot arrives (or maxTicks, if >= 0), returns the
+// number of ticks
+int Manager::fastForward(int maxTicks)
+{
+   int ticks = 0;
+   while (following && (maxTicks < 0 || ticks < maxTicks))
+   {
+      tick();
+      ticks++;
+   }
+   return ticks;
+}
+
+// (Re)start from the beginning of the last planned path
+void Manager::startFollowing()
+{
+   if (followPath.size() < 2)
+      return;
+   followIndex = 0;
+   followX = followPath[0].X;
+   followY = followPath[0].Y;
+   robot = followPath[0];
+   following = true;
+   lastStep = -1;
+   motionRevision++;
 }
 
 // Find a path from robot to destination, avoiding obstacles
@@ -60,6 +251,30 @@ void Manager::generatePath()
    // clear out our last path
    clearCells();
 
+   if (!hasCells())
+   {
+      // no cells: query the roadmap or visibility graph, only rebuilt
+      // when the obstacles change
+      if (decompMode == DECOMP_PRM)
+      {
+         roadmap.update(getObstacles(), width, height, getPool());
+         pathDrawn = roadmap.query(robot, dest, path, roadmapCost);
+      }
+      else
+      {
+         visibility.update(getObstacles(), width, height, getPool());
+         pathDrawn = visibility.query(robot, dest, path, roadmapCost);
+      }
+      if (!pathDrawn)
+         cout << "ERROR: no path on the roadmap" << endl;
+      else if (smoothing)
+         smoothPath();
+      followPath = smoothing ? smoothed : getWaypoints();
+      startFollowing();
+      revision++;
+      return;
+   }
+
    // Step 1: decompose free space into cells
    decompose();
 
@@ -67,6 +282,35 @@ void Manager::generatePath()
    connectCells();
 
    // Step 3: find a path from robot to destination
+   searchCells();
+
+   // Complete!
+}
+
+// Plan on the cells already built: when only the robot and dest moved
+// there is no need to decompose again.  Falls back to generatePath() if
+// there are no cells, or the boxes changed since they were built.
+void Manager::replan()
+{
+   if (!hasCells() || nodes.empty() || !cellsCurrent)
+   {
+      generatePath();
+      return;
+   }
+
+   path.clear();
+   smoothed.clear();
+   pathDrawn = false;
+   following = false;
+   followPath.clear();
+   srcNode  = findEnd(robot);
+   destNode = findEnd(dest);
+   searchCells();
+}
+
+// search from srcNode to destNode and hand the path to the follower
+void Manager::searchCells()
+{
    // check errors: robot or dest inside a box
    if ( !srcNode || 
         !srcNode->cell.isValid || 
@@ -78,33 +322,52 @@ void Manager::generatePath()
       return;
    }
    else
-   {
-      dijkstra();
-   }
+      search();
 
 	if (path.size() > 0)
+	{
 		pathDrawn = true;
-
-   // Complete!
+		if (smoothing)
+			smoothPath();
+		followPath = smoothing ? smoothed : getWaypoints();
+		startFollowing();
+	}
+	revision++;
 }
 
+// Nothing to do for the roadmap and visibility graph, they have no cells
+// and are built on demand by generatePath()
 void Manager::decompose()
 {
-   vector<int> xcoords;
-   vector<int> ycoords;
+   if (!hasCells())
+      return;
+   if (decompMode == DECOMP_QUADTREE)
+      decomposeQuadTree();
+   else
+      decomposeGrid();
+}
+
+void Manager::decomposeGrid()
+{
+   xcoords.clear();
+   ycoords.clear();
+
+   // work in configuration space: boxes grown by the robot radius
+   const Obstacles& obstacles = getObstacles();
 
    xcoords.push_back(0);
    ycoords.push_back(0);
-   // decompose the area into cells based on the box locations
-   for (int i = 0; i < NUM_BOXES; i++)
+   // decompose the area into cells based on the obstacle locations
+   // (clamped, so obstacles hanging off the world do not add cells outside it)
+   for (int i = 0; i < obstacles.size(); i++)
    {
-      xcoords.push_back( boxes[i].pos.X - boxes[i].size );
-      xcoords.push_back( boxes[i].pos.X + boxes[i].size );
-      ycoords.push_back( boxes[i].pos.Y - boxes[i].size );
-      ycoords.push_back( boxes[i].pos.Y + boxes[i].size );
+      xcoords.push_back( max(0, min(width,  obstacles[i].L)) );
+      xcoords.push_back( max(0, min(width,  obstacles[i].R)) );
+      ycoords.push_back( max(0, min(height, obstacles[i].T)) );
+      ycoords.push_back( max(0, min(height, obstacles[i].B)) );
    }
-   xcoords.push_back(WIDTH);
-   ycoords.push_back(HEIGHT);
+   xcoords.push_back(width);
+   ycoords.push_back(height);
 
    // sort the edge coordinates
    sort(xcoords.begin(), xcoords.end());
@@ -114,10 +377,36 @@ void Manager::decompose()
    xcoords.erase( unique(xcoords.begin(), xcoords.end()), xcoords.end() );
    ycoords.erase( unique(ycoords.begin(), ycoords.end()), ycoords.end() );
 
+   // count the obstacles covering each cell with a 2D difference array,
+   // instead of testing every cell center against every obstacle
+   int rows = xcoords.size() - 1;
+   int cols = ycoords.size() - 1;
+   vector<int> cover( (rows+1) * (cols+1), 0 );
+   for (int i = 0; i < obstacles.size(); i++)
+   {
+      int r0 = lower_bound(xcoords.begin(), xcoords.end(), max(0, min(width,  obstacles[i].L))) - xcoords.begin();
+      int r1 = lower_bound(xcoords.begin(), xcoords.end(), max(0, min(width,  obstacles[i].R))) - xcoords.begin();
+      int c0 = lower_bound(ycoords.begin(), ycoords.end(), max(0, min(height, obstacles[i].T))) - ycoords.begin();
+      int c1 = lower_bound(ycoords.begin(), ycoords.end(), max(0, min(height, obstacles[i].B))) - ycoords.begin();
+      cover[r0*(cols+1) + c0]++;
+      cover[r0*(cols+1) + c1]--;
+      cover[r1*(cols+1) + c0]--;
+      cover[r1*(cols+1) + c1]++;
+   }
+   for (int r = 0; r <= rows; r++)
+      for (int c = 1; c <= cols; c++)
+         cover[r*(cols+1) + c] += cover[r*(cols+1) + c-1];
+   for (int r = 1; r <= rows; r++)
+      for (int c = 0; c <= cols; c++)
+         cover[r*(cols+1) + c] += cover[(r-1)*(cols+1) + c];
+
+   nodes.reserve(rows * cols);
+
    // create cells based on edge coordinates
    for (int i = 1; i < xcoords.size(); i++)
    {
       CRow row;
+      row.reserve(cols);
       for (int j = 1; j < ycoords.size(); j++)
       {
          Cell cell;
@@ -135,9 +424,9 @@ void Manager::decompose()
          Position pos(nodeX, nodeY);
          cell.pos = pos;
 
-         // if this cell position is within a box, make it an invalid cell
+         // if this cell is within a box, make it an invalid cell
          // (but keep it...useful for graph construction)
-         if (isCollision(pos) == -1)
+         if (cover[(i-1)*(cols+1) + (j-1)] == 0)
             cell.isValid = true;
          else
             cell.isValid = false;
@@ -146,17 +435,57 @@ void Manager::decompose()
 
          Node* node = new Node();
          node->cell = cell;
+         node->visited = false;
          node->spset = false;
-         node->dist = 999999;
+         node->dist = COST_INF;
+         node->index = nodes.size();
          nodes.push_back(node);
       }
       cells.push_back(row);
    }
+   revision++;
+}
+
+// Approximate decomposition: the quadtree leaves become the nodes, in leaf
+// order, so leaf i is nodes[i].  There is no row / column grid.
+void Manager::decomposeQuadTree()
+{
+   quadtree.build(getObstacles(), width, height, getMinCellSize());
+
+   nodes.reserve(quadtree.numLeaves());
+   for (int i = 0; i < quadtree.numLeaves(); i++)
+   {
+      Node* node = new Node();
+      node->cell = quadtree.getLeaf(i);
+      node->visited = false;
+      node->spset = false;
+      node->dist = COST_INF;
+      node->index = nodes.size();
+      nodes.push_back(node);
+   }
+   revision++;
 }
 
-// generate a connectivity graph based on the vector of cells given
 void Manager::connectCells()
 {
+   if (!hasCells())
+      return;
+   if (decompMode == DECOMP_QUADTREE)
+      connectQuadTree();
+   else
+      connectGrid();
+   srcNode  = findEnd(robot);
+   destNode = findEnd(dest);
+   cellsCurrent = true;
+}
+
+// generate a connectivity graph based on the vector of cells given
+void Manager::connectGrid()
+{
+   // right, bottom, left and top neighbors
+   const int dr[4] = { 0, 1,  0, -1 };
+   const int dc[4] = { 1, 0, -1,  0 };
+
    // loop through rows
    for (int i = 0; i < cells.size(); i++)
    {
@@ -165,10 +494,8 @@ void Manager::connectCells()
       {
          // Only add an edge to a node if BOTH this cell and
          // its neighbor are valid
-         Cell cell  = cells[i][j];
-         Node* node = getNode(cell);
-         Edge edge;
-         edge.src = node;
+         const Cell& cell = cells[i][j];
+         Node* node = getNode(i, j);
 
          // if this cell is not valid, move to the next
          if (!isValidCell(i, j))
@@ -176,147 +503,158 @@ void Manager::connectCells()
             continue;
          }
 
-         // update the source and dest nodes
-         if ( (robot.X >= cell.L) &&
-              (robot.X <  cell.R) &&
-              (robot.Y >= cell.T) &&
-              (robot.Y <  cell.B) )
-         {
-            srcNode = node;
-         }
-         if ( (dest.X >= cell.L) &&
-              (dest.X <  cell.R) &&
-              (dest.Y >= cell.T) &&
-              (dest.Y <  cell.B) )
-         {
-            destNode = node;
-         }
-
-         // right neighbor
-         if (isValidCell(i, j+1))
-         {
-            Node* dest = getNode(cells[i][j+1]);
-            edge.dest = dest;
-            edge.weight = sqrt(pow(dest->cell.pos.X - cell.pos.X, 2) + pow(dest->cell.pos.Y - cell.pos.Y,2));
-            node->edges.push_back(edge);
-         }
-
-         // bottom neighbor
-         if (isValidCell(i+1, j))
+         node->edges.reserve(4);
+         for (int n = 0; n < 4; n++)
          {
-            Node* dest = getNode(cells[i+1][j]);
-            edge.dest = dest;
-            edge.weight = sqrt(pow(dest->cell.pos.X - cell.pos.X, 2) + pow(dest->cell.pos.Y - cell.pos.Y,2));
-            node->edges.push_back(edge);
+            if (isValidCell(i+dr[n], j+dc[n]))
+            {
+               Node* next = getNode(i+dr[n], j+dc[n]);
+               Cost weight = distance(cell.pos, next->cell.pos);
+               node->edges.push_back(Edge(node, next, weight));
+            }
          }
-
-         // left neighbor
-         if (isValidCell(i, j-1))
-         {
-            Node* dest = getNode(cells[i][j-1]);
-            edge.dest = dest;
-            edge.weight = sqrt(pow(dest->cell.pos.X - cell.pos.X, 2) + pow(dest->cell.pos.Y - cell.pos.Y,2));
-            node->edges.push_back(edge);
-         }
-
-         // top neighbor
-         if (isValidCell(i-1, j))
-         {
-            Node* dest = getNode(cells[i-1][j]);
-            edge.dest = dest;
-            edge.weight = sqrt(pow(dest->cell.pos.X - cell.pos.X, 2) + pow(dest->cell.pos.Y - cell.pos.Y,2));
-            node->edges.push_back(edge);
-         }
-
-         nodes.push_back(node);
       }
    }
 }
 
-// utility function for Dijkstra's algorithm
-// dist is the list of shortest distance paths
-// spset[i] is true if node i is in the shortest path
-int Manager::minDistance()
+// Leaves are connected to every free leaf sharing a side with them, which
+// may be several smaller ones along each side
+void Manager::connectQuadTree()
 {
-   int min = 999999;
-   int minIndex;
-   for (int n = 0; n < nodes.size(); n++)
+   vector<int> next;
+   for (int i = 0; i < nodes.size(); i++)
    {
-      if ( !nodes[n]->spset && nodes[n]->dist <= min )
+      Node* node = nodes[i];
+      if (!node->cell.isValid)
+         continue;
+
+      quadtree.neighbors(i, next);
+      node->edges.reserve(next.size());
+      for (int n = 0; n < next.size(); n++)
       {
-         min = nodes[n]->dist;
-         minIndex = n;
+         Node* other = nodes[next[n]];
+         if (other->cell.isValid)
+            node->edges.push_back(Edge(node, other, distance(node->cell.pos, other->cell.pos)));
       }
    }
-   return minIndex;
+}
+
+// Run the selected search.  Both fill in the same distances, and
+// tracePath() turns those into the same path.
+void Manager::search()
+{
+   if (searchMode == SEARCH_DELTA_STEPPING)
+      deltaStepping();
+   else
+      dijkstra();
 }
 
 // Find the shortest path from the robot to destination using
-// Dijkstra's SSSP Algorithm
+// Dijkstra's SSSP Algorithm (binary heap with lazy deletion)
 void Manager::dijkstra()
 {
-   // add source node to path and see if source == dest
-   path.push_back(srcNode->cell);
-   if (*srcNode == *destNode)
-   {
-      return;
-   }
+   dijkstraSearch(nodes, srcNode, destNode);
 
-   // set distance of source node to 0 (and visited)
-   srcNode->dist = 0;
+   tracePath();
+}
 
-   // DIJKSTRA
-   for (int i = 0; i < nodes.size(); i++)
-   {
-      // find the minimum distance node
-      int u = minDistance();
+// Find the shortest path from the robot to destination using
+// parallel delta-stepping on the thread pool
+void Manager::deltaStepping()
+{
+   getPool();
+   stepper->run(nodes, srcNode, destNode, delta);
 
-      // mark the discovered minimum distance node as part of the shortest path
-      nodes[u]->spset = true;
+   tracePath();
+}
 
-      if (*nodes[u] == *destNode)
-      {
-         break;
-      }
+// The path follows tight edges back from dest, so any search that
+// produces the same distances produces the same path
+void Manager::tracePath()
+{
+   traceShortestPath(srcNode, destNode, path);
+}
+
+// Shortcut the zig-zag through the cell centers wherever a straight line
+// stays clear of the inflated obstacles
+void Manager::smoothPath()
+{
+   smoothed.clear();
+   if (getPathCost() == COST_INF)
+      return;
+   smoother.setObstacles(getObstacles());
+   smoother.smooth(getWaypoints(), smoothed);
+   revision++;
+}
 
-      // update dist value of adjacent nodes of the picked node
-      for (int n = 0; n < nodes.size(); n++)
+Waypoints Manager::getWaypoints() const
+{
+   Waypoints points;
+   if (getPathCost() == COST_INF)
+      return points;
+   points.reserve(path.size() + 2);
+   points.push_back(robot);
+   for (int i = 0; i < path.size(); i++)
+   {
+      // between cells of different size the line joining the centers can
+      // miss the shared side and cut through a third cell: go through the
+      // nearest point of the shared side instead
+      if (i > 0 && hasCells())
       {
-         Edge edge = nodes[u]->hasEdge(nodes[n]);
-         // update the distance of node n if ...
-         if ( !nodes[n]->spset &&          // not already in spset
-              edge.dest &&                 // there is an edge from u to n
-              nodes[u]->dist != 999999 &&  // total weight from u to n is < ...
-              nodes[u]->dist + edge.weight < nodes[n]->dist ) // current dist
+         const Cell& a = path[i-1];
+         const Cell& b = path[i];
+         double dx = b.pos.X - a.pos.X;
+         double dy = b.pos.Y - a.pos.Y;
+         if (a.R == b.L || b.R == a.L)
+         {
+            int x  = a.R == b.L ? a.R : a.L;
+            int lo = max(a.T, b.T);
+            int hi = min(a.B, b.B);
+            double y = a.pos.Y + dy * (x - a.pos.X) / dx;
+            if (y < lo || y > hi)
+               points.push_back(Position(x, y < lo ? lo : hi));
+         }
+         else
          {
-            nodes[n]->dist = nodes[u]->dist + edge.weight;
+            int y  = a.B == b.T ? a.B : a.T;
+            int lo = max(a.L, b.L);
+            int hi = min(a.R, b.R);
+            double x = a.pos.X + dx * (y - a.pos.Y) / dy;
+            if (x < lo || x > hi)
+               points.push_back(Position(x < lo ? lo : hi, y));
          }
       }
+      points.push_back(path[i].pos);
    }
+   points.push_back(dest);
+   return points;
+}
 
-   // now traverse the graph to find the shortest path specifically from
-   // dest to src, then reverse it and viola! we have our path
-   list<Cell> pathList;
-   pathList.push_back(destNode->cell);
-   Node* currentNode = destNode;
-   while (currentNode != srcNode)
+ThreadPool* Manager::getPool()
+{
+   if (!pool)
    {
-      int shortest = currentNode->dist;
-      int prevIndex = 0;
-      for (int i = 0; i < currentNode->edges.size(); i++)
-      {
-         Node* prev = currentNode->edges[i].dest;
-         if (prev->dist <= shortest && prev->spset)
-         {
-            shortest = prev->dist;
-            prevIndex = i;
-         }
-      }
-      currentNode = currentNode->edges[prevIndex].dest;
-      pathList.push_back(currentNode->cell);
+      pool    = new ThreadPool(threads);
+      stepper = new DeltaStepping(pool);
    }
-   pathList.reverse();
-   path = Path(pathList.begin(), pathList.end());
+   return pool;
+}
+
+Cost Manager::getPathCost() const
+{
+   if (!pathDrawn)
+      return COST_INF;
+   if (!hasCells())
+      return roadmapCost;
+   return destNode ? destNode->dist : COST_INF;
+}
+
+Cost Manager::distance(const Position& a, const Position& b)
+{
+   // doubles hold the squared distance exactly for coordinates up to 2^26
+   double dx = (double) b.X - a.X;
+   double dy = (double) b.Y - a.Y;
+   return llround( sqrt(dx*dx + dy*dy) * COST_SCALE );
 }
 
 // Return index of box that collides
@@ -325,7 +663,7 @@ int Manager::isCollision(Position pos)
 {	
 	int X = pos.X;
 	int Y = pos.Y;
-	for (int i=0; i<NUM_BOXES; i++)
+	for (int i=0; i<boxes.size(); i++)
 	{
 		if ( ( X < boxes[i].pos.X + (boxes[i].size) ) &&
 			  ( X > boxes[i].pos.X - (boxes[i].size) ) &&
@@ -337,20 +675,126 @@ int Manager::isCollision(Position pos)
 	return -1;
 }
 
+bool Manager::isFree(const Position& pos)
+{
+   if (pos.X < 0 || pos.X >= width || pos.Y < 0 || pos.Y >= height)
+      return false;
+   smoother.setObstacles(getObstacles());
+   return smoother.segmentFree(pos, pos);
+}
+
 void Manager::setBox(int boxNum, Position pos)
 {
 	if (boxNum >= 0 && boxNum < boxes.size() )
+	{
 		boxes[boxNum].pos = pos;
+		cspace.invalidate();
+		cellsCurrent = false;
+		revision++;
+	}
 	else cout << "Error: Out of Bounds in setBox" <<endl;
 }
 
 void Manager::setBoxSize(int boxNum, int size)
 {
 	if (boxNum >= 0 && boxNum < boxes.size() )
+	{
 		boxes[boxNum].size = size;
+		cspace.invalidate();
+		cellsCurrent = false;
+		revision++;
+	}
 	else cout << "Error: Out of Bounds in setBoxSize" <<endl;
 }
 
+void Manager::addBox(Box box)
+{
+	boxes.push_back(box);
+	cspace.invalidate();
+	cellsCurrent = false;
+	revision++;
+}
+
+void Manager::clearBoxes()
+{
+	boxes.clear();
+	cspace.invalidate();
+	cellsCurrent = false;
+	revision++;
+}
+
+// Resize the world; the old decomposition no longer covers it
+void Manager::setWorldSize(int _width, int _height)
+{
+	clearCells();
+	width  = _width;
+	height = _height;
+	cspace.invalidate();
+}
+
+// Plan for a robot of this radius.  Obstacles for each radius stay cached,
+// so switching between the radii of a mixed fleet costs nothing.
+void Manager::setRobotRadius(int radius)
+{
+	if (radius == robotRadius)
+		return;
+	clearCells();
+	robotRadius = radius;
+}
+
+// The pool is rebuilt with the new size on the next delta-stepping search
+void Manager::setThreads(int _threads)
+{
+	if (_threads == threads)
+		return;
+	threads = _threads;
+	delete stepper;
+	delete pool;
+	stepper = NULL;
+	pool    = NULL;
+}
+
+// Switching throws away the current cells and path
+void Manager::setDecomposition(Decomposition decomp)
+{
+	if (decomp == decompMode)
+		return;
+	clearCells();
+	decompMode = decomp;
+}
+
+void Manager::setSmoothing(bool smooth)
+{
+	smoothing = smooth;
+	if (smoothing)
+		smoothPath();
+	else
+		smoothed.clear();
+	revision++;
+}
+
+void Manager::setMinCellSize(int size)
+{
+	if (size == minCellSize)
+		return;
+	clearCells();
+	minCellSize = size;
+}
+
+// Default to the robot radius, which keeps the number of leaves in
+// proportion to the obstacle outlines measured in robot sizes
+int Manager::getMinCellSize() const
+{
+	if (minCellSize > 0)
+		return minCellSize;
+	return max(1, robotRadius);
+}
+
+const Obstacles& Manager::getObstacles()
+{
+	return cspace.getObstacles(boxes, width, height, robotRadius);
+}
+
 Box Manager::getBox(int boxNum)
 {
 	if (boxNum >= 0 && boxNum < boxes.size() )
@@ -392,9 +836,20 @@ Position Manager::findCellIndex(Cell c) const
 
 void Manager::clearCells()
 {
+   cellsCurrent = false;
+   following = false;
+   followPath.clear();
 	cells.clear();
+	quadtree.clear();
+   for (int i = 0; i < nodes.size(); i++)
+      delete nodes[i];
    nodes.clear();
+   srcNode  = NULL;
+   destNode = NULL;
    path.clear();
+   smoothed.clear();
+   roadmapCost = COST_INF;
 	pathDrawn = false;
+	revision++;
 }
  
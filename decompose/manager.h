@@ -1,61 +1,197 @@
-
 #ifndef MANAGER_H_
 #define MANAGER_H_
 
 #include "consts.h"
+#include "cspace.h"
+#include "prm.h"
+#include "quadtree.h"
+#include "smoother.h"
+#include "visibility.h"
+
+class ThreadPool;
+class DeltaStepping;
 
 
 class Manager
 {
 
 public:
-   Manager();
+   // shortest path search used by generatePath()
+   enum Search {
+      SEARCH_DIJKSTRA = 0,    // serial, binary heap
+      SEARCH_DELTA_STEPPING   // parallel buckets across a thread pool
+   };
+
+   // how decompose() splits free space into cells
+   enum Decomposition {
+      DECOMP_GRID = 0,        // exact, cut along every obstacle edge
+      DECOMP_QUADTREE,        // approximate, adaptive quadtree leaves
+      DECOMP_PRM,             // no cells, a sampled roadmap kept across queries
+      DECOMP_VISIBILITY       // no cells, shortest paths over the obstacle corners
+   };
+
+   Manager(int _width = WIDTH, int _height = HEIGHT);
    ~Manager();
 	
 	bool pathDrawn;
    
    Node* getNode(const Cell& cell) const;
+   Node* getNode(int r, int c) const;
+   Node* findNode(const Position& pos) const;
    bool  isValidCell(int r, int c) const;
    
 
+	// path following: timeStep() runs as many fixed rate ticks as real
+	// time has passed since its last call, fastForward() runs them back to
+	// back without a clock
 	void  timeStep();
+	bool  tick();
+	int   fastForward(int maxTicks = -1);
+	void  startFollowing();
+	void  stopFollowing()	{following = false;}
+	bool  isFollowing()	const {return following;}
    void  generatePath();
+   void  replan();
    void  decompose();
+   void  decomposeGrid();
+   void  decomposeQuadTree();
    void  connectCells();
-   int   minDistance();
+   void  connectGrid();
+   void  connectQuadTree();
+   void  search();
    void  dijkstra();
+   void  deltaStepping();
+   void  tracePath();
+   void  smoothPath();
 	int 	isCollision(Position pos);
+	// grid or quadtree: the decompositions with cells to plan on
+	bool	hasCells() const {return decompMode == DECOMP_GRID || decompMode == DECOMP_QUADTREE;}
+	// the cells and edges are built and match the boxes
+	bool	cellsAreCurrent() const {return hasCells() && !nodes.empty() && cellsCurrent;}
+	// true if the robot's center may be at pos: in the world and outside
+	// the union of the inflated obstacles
+	bool	isFree(const Position& pos);
 	void 	clearCells();
 
 	// SET Functions
+	void setWorldSize(int _width, int _height);
 	void setBox(int boxNum, Position pos);
 	void setBoxSize(int boxNum, int size);
-	void setRobot(Position pos)	{robot= pos;}
-	void setDest(Position pos)	{dest = pos;}
+	void addBox(Box box);
+	void clearBoxes();
+	void setRobotRadius(int radius);
+	void setSearch(Search _search)	{searchMode = _search;}
+	void setThreads(int threads);
+	void setDecomposition(Decomposition decomp);
+	void setMinCellSize(int size);
+	void setSmoothing(bool smooth);
+	void setRoadmapSamples(int samples)	{roadmap.setSamples(samples);}
+	void setRoadmapNeighbors(int k)	{roadmap.setNeighbors(k);}
+	void setDelta(Cost _delta)	{delta = _delta;}
+	void setRobot(Position pos)	{robot= pos; following = false; revision++;}
+	void setSpeed(double _speed)	{speed = _speed;}
+	void setTickRate(double rate)	{tickRate = rate;}
+	void setDest(Position pos)	{dest = pos; revision++;}
 
 	// GET Functions
+	int			getWorldWidth()	const {return width;}
+	int			getWorldHeight()	const {return height;}
    Box         getBox(int boxNum);
+	int			numBoxes()	const {return boxes.size();}
+	int			getRobotRadius()	const {return robotRadius;}
+	Search		getSearch()	const {return searchMode;}
+	int			getThreads()	const {return threads;}
+	Decomposition getDecomposition()	const {return decompMode;}
+	int			getMinCellSize()	const;
+	const QuadTree& getQuadTree()	const {return quadtree;}
+	const Roadmap&	getRoadmap()	const {return roadmap;}
+	const VisibilityGraph& getVisibilityGraph()	const {return visibility;}
+   const Nodes& getNodes()	const {return nodes;}
+	CSpace&		getCSpace()	{return cspace;}
+	// boxes inflated by the robot radius and merged, what decompose() sees
+	const Obstacles& getObstacles();
 	Robot 		getRobot()	const {return robot;}
 	Destination getDest()	const {return dest;}
    Cell        getCell(int row, int col); 
 	int			getCellRows()	const	{return cells.size();}
-	int			getCellCols()	const	{return cells[0].size();}
+	int			getCellCols()	const	{return cells.empty() ? 0 : cells[0].size();}
+	int			getNumNodes()	const	{return nodes.size();}
 	Position		getPathNode(int nodeNum);
 	int			getPathNodesLength();
+	Cost			getPathCost()	const;
+   const Path& getPath()	const {return path;}
+	// robot, the path's cell centers, dest
+	Waypoints	getWaypoints()	const;
+	// the same after shortcutting (empty unless smoothing is on)
+	const Waypoints& getSmoothedPath()	const {return smoothed;}
+	bool			getSmoothing()	const {return smoothing;}
+	double		getSpeed()	const {return speed;}
+	double		getTickRate()	const {return tickRate;}
    
    Position    findCellIndex(Cell c) const;
+
+   // bumped on every change to the scene, cells or path so that the
+   // canvas knows when its vertex buffers are stale
+   unsigned int getRevision() const {return revision;}
+   // bumped when only the robot moved along its path
+   unsigned int getMotionRevision() const {return motionRevision;}
+
+   // fixed-point length of the straight line between two positions
+   static Cost distance(const Position& a, const Position& b);
 	
 private:
+   int         width;   // world extent, cells cover [0,width) x [0,height)
+   int         height;
+   int         robotRadius;
+   CSpace      cspace;  // inflated obstacles, cached per robot radius
+
    Boxes       boxes;	// typedef'd to std::vector<Box>
 	Robot 		robot;
 	Destination dest;
 
    Cells       cells;	// typedef'd to std::vector<Cell>
-   Nodes       nodes;
+   Nodes       nodes;   // cells[r][c] is nodes[r*cols + c], or quadtree leaf i
    Path        path;    // typedef'd to std::vector<Cell>
+   std::vector<int> xcoords; // cell edges, cells[r] spans xcoords[r..r+1]
+   std::vector<int> ycoords; // cell edges, cells[r][c] spans ycoords[c..c+1]
+   QuadTree    quadtree;
+   Smoother    smoother;
+   Roadmap     roadmap;
+   VisibilityGraph visibility;
+   Cost        roadmapCost; // cost of the last roadmap / visibility graph query
+   bool        cellsCurrent;// cells and edges match the boxes
+   bool        smoothing;
+   Waypoints   smoothed;
+   Decomposition decompMode;
+   int         minCellSize; // smallest quadtree leaf, 0 = the robot radius
 	
    Node*       srcNode;
    Node*       destNode;
+
+   Search      searchMode;
+   int         threads; // delta-stepping workers, 0 = one per core
+   Cost        delta;   // delta-stepping bucket width, 0 = mean edge weight
+   ThreadPool*    pool;
+   DeltaStepping* stepper;
+
+   unsigned int revision;
+
+   // path follower
+   Waypoints   followPath; // the last planned path, robot to dest
+   int         followIndex;// last waypoint passed
+   double      followX;    // exact robot position, robot holds it rounded
+   double      followY;
+   bool        following;
+   double      speed;      // world units per second
+   double      tickRate;   // ticks per second
+   double      lastStep;   // clock at the last timeStep(), < 0 before the first
+   double      accumulator;// real time not yet simulated
+   unsigned int motionRevision;
+
+   ThreadPool* getPool();
+   void        searchCells();
+   Node*       locateNode(const Position& pos) const;
+   Node*       findEnd(const Position& pos);
 };
 
 #endif
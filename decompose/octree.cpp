@@ -0,0 +1,182 @@
+
+#include "octree.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+Octree::Octree()
+: minSize(1)
+{
+}
+
+Octree::~Octree()
+{
+}
+
+void Octree::clear()
+{
+   octs.clear();
+   leaves.clear();
+}
+
+int Octree::addOct(int L, int R, int T, int B, int N, int F)
+{
+   Oct oct;
+   oct.L = L;
+   oct.R = R;
+   oct.T = T;
+   oct.B = B;
+   oct.N = N;
+   oct.F = F;
+   oct.mx = R;
+   oct.my = B;
+   oct.mz = F;
+   for (int c = 0; c < 8; c++)
+      oct.child[c] = -1;
+   oct.leaf = -1;
+   octs.push_back(oct);
+   return octs.size() - 1;
+}
+
+void Octree::addLeaf(int o, bool free)
+{
+   const Oct& oct = octs[o];
+   Cell3 cell;
+   cell.L = oct.L;
+   cell.R = oct.R;
+   cell.T = oct.T;
+   cell.B = oct.B;
+   cell.N = oct.N;
+   cell.F = oct.F;
+   cell.pos = Position3(cell.L + (cell.R - cell.L) / 2,
+                        cell.T + (cell.B - cell.T) / 2,
+                        cell.N + (cell.F - cell.N) / 2);
+   cell.isValid = free;
+
+   octs[o].leaf = leaves.size();
+   leaves.push_back(cell);
+}
+
+void Octree::build(const Obstacles3& obstacles, const Obstacle3& region, int _minSize)
+{
+   clear();
+   minSize = max(1, _minSize);
+
+   vector<int> all(obstacles.size());
+   for (int i = 0; i < obstacles.size(); i++)
+      all[i] = i;
+
+   if (region.L >= region.R || region.T >= region.B || region.N >= region.F)
+      return;
+   addOct(region.L, region.R, region.T, region.B, region.N, region.F);
+   split(0, obstacles, all);
+}
+
+// candidates are the obstacles touching the parent, keep the ones
+// touching this octant
+void Octree::split(int o, const Obstacles3& obstacles, const vector<int>& candidates)
+{
+   Oct oct = octs[o];
+
+   vector<int> inside;
+   bool full = false;
+   for (int i = 0; i < candidates.size() && !full; i++)
+   {
+      const Obstacle3& ob = obstacles[candidates[i]];
+      if ( ob.R <= oct.L || ob.L >= oct.R ||
+           ob.B <= oct.T || ob.T >= oct.B ||
+           ob.F <= oct.N || ob.N >= oct.F )
+         continue;
+      inside.push_back(candidates[i]);
+      full = ob.L <= oct.L && ob.R >= oct.R &&
+             ob.T <= oct.T && ob.B >= oct.B &&
+             ob.N <= oct.N && ob.F >= oct.F;
+   }
+
+   bool splitX = (oct.R - oct.L) > minSize;
+   bool splitY = (oct.B - oct.T) > minSize;
+   bool splitZ = (oct.F - oct.N) > minSize;
+   if (inside.empty() || full || (!splitX && !splitY && !splitZ))
+   {
+      addLeaf(o, inside.empty());
+      return;
+   }
+
+   int xs[3] = { oct.L, splitX ? oct.L + (oct.R - oct.L) / 2 : oct.R, oct.R };
+   int ys[3] = { oct.T, splitY ? oct.T + (oct.B - oct.T) / 2 : oct.B, oct.B };
+   int zs[3] = { oct.N, splitZ ? oct.N + (oct.F - oct.N) / 2 : oct.F, oct.F };
+   octs[o].mx = xs[1];
+   octs[o].my = ys[1];
+   octs[o].mz = zs[1];
+
+   for (int c = 0; c < 8; c++)
+   {
+      int cx = c & 1;
+      int cy = (c >> 1) & 1;
+      int cz = (c >> 2) & 1;
+      if (xs[cx] == xs[cx+1] || ys[cy] == ys[cy+1] || zs[cz] == zs[cz+1])
+         continue;
+      int child = addOct(xs[cx], xs[cx+1], ys[cy], ys[cy+1], zs[cz], zs[cz+1]);
+      octs[o].child[c] = child;
+      split(child, obstacles, inside);
+   }
+}
+
+int Octree::locate(int x, int y, int z) const
+{
+   if (octs.empty())
+      return -1;
+   const Oct* oct = &octs[0];
+   if ( x < oct->L || x >= oct->R ||
+        y < oct->T || y >= oct->B ||
+        z < oct->N || z >= oct->F )
+      return -1;
+
+   while (oct->leaf < 0)
+   {
+      int c = (x >= oct->mx ? 1 : 0) + (y >= oct->my ? 2 : 0) + (z >= oct->mz ? 4 : 0);
+      if (oct->child[c] < 0)
+         return -1;
+      oct = &octs[oct->child[c]];
+   }
+   return oct->leaf;
+}
+
+// all leaves overlapping the region, descending only into octants that do
+void Octree::collect(int o, const Obstacle3& region, vector<int>& out) const
+{
+   const Oct& oct = octs[o];
+   if ( region.R <= oct.L || region.L >= oct.R ||
+        region.B <= oct.T || region.T >= oct.B ||
+        region.F <= oct.N || region.N >= oct.F )
+      return;
+
+   if (oct.leaf >= 0)
+   {
+      out.push_back(oct.leaf);
+      return;
+   }
+   for (int c = 0; c < 8; c++)
+      if (oct.child[c] >= 0)
+         collect(oct.child[c], region, out);
+}
+
+// The neighbors across each face are the leaves overlapping a one unit
+// thick slab just outside it.  Faces of a leaf can border many smaller
+// leaves in two directions, so this is a range query rather than a walk.
+void Octree::neighbors(int leaf, vector<int>& out) const
+{
+   out.clear();
+   if (octs.empty())
+      return;
+   const Cell3& c = leaves[leaf];
+
+   collect(0, Obstacle3(c.R,   c.R+1, c.T,   c.B,   c.N,   c.F  ), out);
+   collect(0, Obstacle3(c.L-1, c.L,   c.T,   c.B,   c.N,   c.F  ), out);
+   collect(0, Obstacle3(c.L,   c.R,   c.B,   c.B+1, c.N,   c.F  ), out);
+   collect(0, Obstacle3(c.L,   c.R,   c.T-1, c.T,   c.N,   c.F  ), out);
+   collect(0, Obstacle3(c.L,   c.R,   c.T,   c.B,   c.F,   c.F+1), out);
+   collect(0, Obstacle3(c.L,   c.R,   c.T,   c.B,   c.N-1, c.N  ), out);
+}
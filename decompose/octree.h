@@ -0,0 +1,71 @@
+
+#ifndef OCTREE_H_
+#define OCTREE_H_
+
+#include "consts.h"
+
+#include <vector>
+
+// An axis-aligned obstacle box covering [L,R) x [T,B) x [N,F)
+struct Obstacle3 {
+   int L;
+   int R;
+   int T;
+   int B;
+   int N;
+   int F;
+   Obstacle3(int _l = 0, int _r = 0, int _t = 0, int _b = 0, int _n = 0, int _f = 0)
+   : L(_l), R(_r), T(_t), B(_b), N(_n), F(_f) {};
+};
+
+typedef std::vector<Obstacle3> Obstacles3;
+
+/*
+ * Adaptive octree decomposition of a 3D world, the counterpart of QuadTree.
+ *
+ * A region is split in eight while it is mixed and larger than the minimum
+ * cell size.  Obstacles may overlap, so a region only counts as full when
+ * one obstacle covers it; a region covered by several of them is split
+ * down to the minimum size and then labelled occupied like any mixed one.
+ */
+class Octree
+{
+public:
+   Octree();
+   ~Octree();
+
+   // decompose the region (a box, not necessarily from the origin)
+   void  build(const Obstacles3& obstacles, const Obstacle3& region, int minSize);
+   void  clear();
+
+   // the leaves, as cells (isValid = free)
+   int          numLeaves()    const {return leaves.size();}
+   const Cell3& getLeaf(int i) const {return leaves[i];}
+
+   // leaf containing the point, or -1 outside the region
+   int   locate(int x, int y, int z) const;
+
+   // every leaf sharing part of a face with the given leaf (6-connected)
+   void  neighbors(int leaf, std::vector<int>& out) const;
+
+   int   numNodes() const {return octs.size();}
+
+private:
+   struct Oct {
+      int L, R, T, B, N, F;
+      int mx, my, mz;   // split planes
+      int child[8];     // x + 2y + 4z order (-1 if empty or a leaf)
+      int leaf;         // index into leaves, -1 if split
+   };
+
+   std::vector<Oct>   octs;
+   std::vector<Cell3> leaves;
+   int   minSize;
+
+   void  split(int oct, const Obstacles3& obstacles, const std::vector<int>& candidates);
+   int   addOct(int L, int R, int T, int B, int N, int F);
+   void  addLeaf(int oct, bool free);
+   void  collect(int oct, const Obstacle3& region, std::vector<int>& out) const;
+};
+
+#endif
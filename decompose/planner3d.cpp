@@ -0,0 +1,236 @@
+
+#include "planner3d.h"
+#include "deltastep.h"
+#include "search.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using namespace std;
+
+
+Planner3D::Planner3D(int _width, int _height, int _depth)
+: width(_width),
+height(_height),
+depth(_depth),
+robotRadius(ROBOT_RADIUS),
+minCellSize(0),
+srcNode(NULL),
+destNode(NULL),
+searchMode(Manager::SEARCH_DIJKSTRA),
+threads(0),
+pool(NULL),
+stepper(NULL)
+{
+}
+
+Planner3D::~Planner3D()
+{
+   clearCells();
+   delete stepper;
+   delete pool;
+}
+
+// Find a path from robot to destination, avoiding obstacles
+void Planner3D::generatePath()
+{
+   clearCells();
+
+   decompose();
+   connectCells();
+
+   if ( !srcNode || !srcNode->cell.isValid ||
+        !destNode || !destNode->cell.isValid )
+   {
+      cout << "ERROR: invalid parameters" << endl;
+      cout << "robot or dest may be inside a box" << endl;
+      return;
+   }
+   search();
+}
+
+void Planner3D::decompose()
+{
+   // configuration space: grow the cubes by the robot radius (square
+   // corners, which keeps them boxes)
+   int r = robotRadius;
+   obstacles.clear();
+   for (int i = 0; i < boxes.size(); i++)
+   {
+      const Box3& box = boxes[i];
+      obstacles.push_back(Obstacle3(box.pos.X - box.size - r, box.pos.X + box.size + r,
+                                    box.pos.Y - box.size - r, box.pos.Y + box.size + r,
+                                    box.pos.Z - box.size - r, box.pos.Z + box.size + r));
+   }
+
+   // the robot's center has to stay radius away from the world border, so
+   // the octree only covers that inner box.  (Border slabs as obstacles
+   // would cover every face of the world with minimum size leaves.)
+   octree.build(obstacles, Obstacle3(r, width-r, r, height-r, r, depth-r), getMinCellSize());
+
+   nodes.reserve(octree.numLeaves());
+   for (int i = 0; i < octree.numLeaves(); i++)
+   {
+      Node3* node = new Node3();
+      node->cell = octree.getLeaf(i);
+      node->visited = false;
+      node->spset = false;
+      node->dist = COST_INF;
+      node->index = nodes.size();
+      nodes.push_back(node);
+   }
+}
+
+// connect every free leaf to the free leaves across its six faces
+void Planner3D::connectCells()
+{
+   srcNode  = findNode(robot);
+   destNode = findNode(dest);
+
+   vector<int> next;
+   for (int i = 0; i < nodes.size(); i++)
+   {
+      Node3* node = nodes[i];
+      if (!node->cell.isValid)
+         continue;
+
+      octree.neighbors(i, next);
+      node->edges.reserve(next.size());
+      for (int n = 0; n < next.size(); n++)
+      {
+         Node3* other = nodes[next[n]];
+         if (other->cell.isValid)
+            node->edges.push_back(Edge3(node, other, distance(node->cell.pos, other->cell.pos)));
+      }
+   }
+}
+
+// The leaf holding pos, NULL outside the octree.  Leaves of the smallest
+// size that are only partly inside an obstacle count as occupied, so a
+// free point may fall in one; then take the nearest free leaf across its
+// faces, as Manager::findNode() takes the free cell across a border.
+Node3* Planner3D::findNode(const Position3& pos) const
+{
+   int leaf = octree.locate(pos.X, pos.Y, pos.Z);
+   if (leaf < 0)
+      return NULL;
+   Node3* node = nodes[leaf];
+   if (node->cell.isValid)
+      return node;
+
+   for (int i = 0; i < obstacles.size(); i++)
+   {
+      const Obstacle3& o = obstacles[i];
+      if ( o.L < pos.X && pos.X < o.R && o.T < pos.Y && pos.Y < o.B &&
+           o.N < pos.Z && pos.Z < o.F )
+         return node;   // really blocked
+   }
+
+   vector<int> next;
+   octree.neighbors(leaf, next);
+   Cost nearest = COST_INF;
+   for (int n = 0; n < next.size(); n++)
+   {
+      Node3* other = nodes[next[n]];
+      Cost d = distance(pos, other->cell.pos);
+      if (other->cell.isValid && d < nearest)
+      {
+         node    = other;
+         nearest = d;
+      }
+   }
+   return node;
+}
+
+// Run the selected search, same back-ends as the 2D manager
+void Planner3D::search()
+{
+   if (searchMode == Manager::SEARCH_DELTA_STEPPING)
+   {
+      if (!pool)
+      {
+         pool    = new ThreadPool(threads);
+         stepper = new DeltaStepping(pool);
+      }
+      stepper->run(nodes, srcNode, destNode);
+   }
+   else
+   {
+      dijkstraSearch(nodes, srcNode, destNode);
+   }
+   traceShortestPath(srcNode, destNode, path);
+}
+
+void Planner3D::clearCells()
+{
+   octree.clear();
+   for (int i = 0; i < nodes.size(); i++)
+      delete nodes[i];
+   nodes.clear();
+   srcNode  = NULL;
+   destNode = NULL;
+   path.clear();
+}
+
+// Return index of box that collides
+// Return -1 on no collision
+int Planner3D::isCollision(Position3 pos) const
+{
+   for (int i = 0; i < boxes.size(); i++)
+   {
+      const Box3& box = boxes[i];
+      if ( abs(pos.X - box.pos.X) < box.size &&
+           abs(pos.Y - box.pos.Y) < box.size &&
+           abs(pos.Z - box.pos.Z) < box.size )
+         return i;
+   }
+   return -1;
+}
+
+void Planner3D::setWorldSize(int _width, int _height, int _depth)
+{
+   clearCells();
+   width  = _width;
+   height = _height;
+   depth  = _depth;
+}
+
+void Planner3D::addBox(Box3 box)
+{
+   boxes.push_back(box);
+}
+
+void Planner3D::clearBoxes()
+{
+   boxes.clear();
+}
+
+void Planner3D::setThreads(int _threads)
+{
+   if (_threads == threads)
+      return;
+   threads = _threads;
+   delete stepper;
+   delete pool;
+   stepper = NULL;
+   pool    = NULL;
+}
+
+// Leaf counts grow with obstacle surface area over the leaf size squared,
+// so the default is the robot radius but no finer than 1/128 of the world
+int Planner3D::getMinCellSize() const
+{
+   if (minCellSize > 0)
+      return minCellSize;
+   return max(max(1, robotRadius), max(width, max(height, depth)) / 128);
+}
+
+Cost Planner3D::distance(const Position3& a, const Position3& b)
+{
+   double dx = (double) b.X - a.X;
+   double dy = (double) b.Y - a.Y;
+   double dz = (double) b.Z - a.Z;
+   return llround( sqrt(dx*dx + dy*dy + dz*dz) * COST_SCALE );
+}
@@ -0,0 +1,85 @@
+
+#ifndef PLANNER3D_H_
+#define PLANNER3D_H_
+
+#include "consts.h"
+#include "manager.h"
+#include "octree.h"
+
+class ThreadPool;
+class DeltaStepping;
+
+/*
+ * Cell decomposition planner for a 3D world (drones).
+ *
+ * The world [0,width) x [0,height) x [0,depth) holds cube obstacles.  They
+ * are grown by the robot radius, the free space is split by an Octree, and
+ * the leaves are searched with the same Dijkstra and delta-stepping code
+ * as the 2D Manager, over 6-connected (face sharing) neighbors.
+ */
+class Planner3D
+{
+public:
+   Planner3D(int _width = WIDTH, int _height = HEIGHT, int _depth = WIDTH);
+   ~Planner3D();
+
+   void  generatePath();
+   void  decompose();
+   void  connectCells();
+   void  search();
+   void  clearCells();
+   int   isCollision(Position3 pos) const;
+   Node3* findNode(const Position3& pos) const;
+
+	// SET Functions
+	void setWorldSize(int _width, int _height, int _depth);
+	void addBox(Box3 box);
+	void clearBoxes();
+	void setRobotRadius(int radius)	{robotRadius = radius;}
+	void setMinCellSize(int size)	{minCellSize = size;}
+	void setSearch(Manager::Search _search)	{searchMode = _search;}
+	void setThreads(int threads);
+	void setRobot(Position3 pos)	{robot = pos;}
+	void setDest(Position3 pos)	{dest = pos;}
+
+	// GET Functions
+	int			getWorldWidth()	const {return width;}
+	int			getWorldHeight()	const {return height;}
+	int			getWorldDepth()	const {return depth;}
+	int			numBoxes()	const {return boxes.size();}
+	int			getRobotRadius()	const {return robotRadius;}
+	int			getMinCellSize()	const;
+	const Obstacles3& getObstacles()	const {return obstacles;}
+	const Octree& getOctree()	const {return octree;}
+	const Nodes3& getNodes()	const {return nodes;}
+	int			getNumNodes()	const {return nodes.size();}
+	Cost			getPathCost()	const {return destNode ? destNode->dist : COST_INF;}
+   const Path3& getPath()	const {return path;}
+
+   static Cost distance(const Position3& a, const Position3& b);
+
+private:
+   int         width;
+   int         height;
+   int         depth;
+   int         robotRadius;
+   int         minCellSize;   // smallest octree leaf, 0 = automatic
+
+   Boxes3      boxes;
+   Obstacles3  obstacles;     // boxes grown by the robot radius
+   Position3   robot;
+   Position3   dest;
+
+   Octree      octree;
+   Nodes3      nodes;         // octree leaf i is nodes[i]
+   Path3       path;
+   Node3*      srcNode;
+   Node3*      destNode;
+
+   Manager::Search searchMode;
+   int            threads;
+   ThreadPool*    pool;
+   DeltaStepping* stepper;
+};
+
+#endif
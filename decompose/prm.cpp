@@ -0,0 +1,226 @@
+
+#include "prm.h"
+#include "manager.h"
+#include "search.h"
+#include "threadpool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+// samples / edge checks per parallel chunk
+const int PRM_GRAIN = 64;
+
+// splitmix64: sample i gets the same numbers whichever thread draws it
+static unsigned long long mix(unsigned long long x)
+{
+   x += 0x9E3779B97F4A7C15ULL;
+   x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+   return x ^ (x >> 31);
+}
+
+Roadmap::Roadmap()
+: samples(4000),
+k(10),
+seed(1),
+builtWidth(-1),
+builtHeight(-1),
+builtSamples(-1),
+builtK(-1),
+builtSeed(0)
+{
+}
+
+Roadmap::~Roadmap()
+{
+   clear();
+}
+
+void Roadmap::clear()
+{
+   for (int i = 0; i < nodes.size(); i++)
+      delete nodes[i];
+   nodes.clear();
+   builtWidth = -1;
+}
+
+int Roadmap::numEdges() const
+{
+   int edges = 0;
+   for (int i = 0; i < nodes.size(); i++)
+      edges += nodes[i]->edges.size();
+   return edges / 2;
+}
+
+void Roadmap::update(const Obstacles& obstacles, int width, int height, ThreadPool* pool)
+{
+   if ( width == builtWidth && height == builtHeight &&
+        samples == builtSamples && k == builtK && seed == builtSeed &&
+        obstacles == builtObstacles )
+      return;
+   build(obstacles, width, height, pool);
+}
+
+void Roadmap::build(const Obstacles& obstacles, int width, int height, ThreadPool* pool)
+{
+   clear();
+   checker.setObstacles(obstacles);
+
+   // Step 1: sample in parallel, keep the ones in free space
+   vector<Position> drawn(samples);
+   vector<char>     valid(samples, 0);
+   pool->parallelFor(samples, PRM_GRAIN, [&](int begin, int end, int worker) {
+      for (int i = begin; i < end; i++)
+      {
+         unsigned long long r = mix(((unsigned long long) seed << 32) + i);
+         drawn[i] = Position((int) ((r & 0xFFFFFFFF) % (unsigned int) max(1, width)),
+                             (int) ((r >> 32) % (unsigned int) max(1, height)));
+         // also drops samples on a seam, inside the obstacle union
+         valid[i] = checker.segmentFree(drawn[i], drawn[i]);
+      }
+   });
+
+   vector<Position> points;
+   for (int i = 0; i < samples; i++)
+   {
+      if (!valid[i])
+         continue;
+      Node* node = new Node();
+      node->cell.pos = drawn[i];
+      node->cell.L = node->cell.R = drawn[i].X;
+      node->cell.T = node->cell.B = drawn[i].Y;
+      node->cell.TL = drawn[i];
+      node->cell.TR = drawn[i];
+      node->cell.BL = drawn[i];
+      node->cell.BR = drawn[i];
+      node->cell.isValid = true;
+      node->visited = false;
+      node->spset = false;
+      node->dist = COST_INF;
+      node->index = nodes.size();
+      nodes.push_back(node);
+      points.push_back(drawn[i]);
+   }
+
+   // Step 2: k nearest neighbors, in parallel.  A pair is a candidate if
+   // either end has the other among its neighbors; it is filed under its
+   // lower index, so each pair's segment is checked once, and linked both
+   // ways after.
+   tree.build(points);
+   int n = nodes.size();
+   vector< vector<int> > near(n);
+   pool->parallelFor(n, PRM_GRAIN, [&](int begin, int end, int worker) {
+      for (int i = begin; i < end; i++)
+         tree.nearest(points[i], k + 1, near[i]); // includes i itself
+   });
+
+   vector< vector<int> > linked(n);
+   for (int i = 0; i < n; i++)
+      for (int j = 0; j < near[i].size(); j++)
+         if (near[i][j] != i)
+            linked[min(i, near[i][j])].push_back(max(i, near[i][j]));
+
+   pool->parallelFor(n, PRM_GRAIN, [&](int begin, int end, int worker) {
+      for (int i = begin; i < end; i++)
+      {
+         vector<int>& pairs = linked[i];
+         sort(pairs.begin(), pairs.end());
+         pairs.erase(unique(pairs.begin(), pairs.end()), pairs.end());
+         int kept = 0;
+         for (int j = 0; j < pairs.size(); j++)
+            if (checker.segmentFree(points[i], points[pairs[j]]))
+               pairs[kept++] = pairs[j];
+         pairs.resize(kept);
+      }
+   });
+
+   for (int i = 0; i < n; i++)
+   {
+      for (int j = 0; j < linked[i].size(); j++)
+      {
+         Node* a = nodes[i];
+         Node* b = nodes[linked[i][j]];
+         Cost  w = Manager::distance(a->cell.pos, b->cell.pos);
+         // coincident samples: a zero weight edge adds nothing, and lets
+         // traceShortestPath() bounce between the two forever
+         if (w == 0)
+            continue;
+         a->edges.push_back(Edge(a, b, w));
+         b->edges.push_back(Edge(b, a, w));
+      }
+   }
+
+   builtObstacles = obstacles;
+   builtWidth   = width;
+   builtHeight  = height;
+   builtSamples = samples;
+   builtK       = k;
+   builtSeed    = seed;
+}
+
+// connect a temporary node to the nearest samples it can see
+void Roadmap::link(Node* node, int count)
+{
+   vector<int> near;
+   tree.nearest(node->cell.pos, count, near);
+   for (int j = 0; j < near.size(); j++)
+   {
+      Node* other = nodes[near[j]];
+      if (!checker.segmentFree(node->cell.pos, other->cell.pos))
+         continue;
+      Cost w = Manager::distance(node->cell.pos, other->cell.pos);
+      if (w == 0)   // on a sample, see build()
+         continue;
+      node->edges.push_back(Edge(node, other, w));
+      other->edges.push_back(Edge(other, node, w));
+   }
+}
+
+bool Roadmap::query(const Position& start, const Position& goal, Path& path, Cost& cost)
+{
+   path.clear();
+   cost = COST_INF;
+   if ( !checker.segmentFree(start, start) || !checker.segmentFree(goal, goal) )
+      return false;
+
+   // link start and goal in as two extra nodes
+   int   n = nodes.size();
+   Node  src, dst;
+   Node* ends[2] = { &src, &dst };
+   Position at[2] = { start, goal };
+   for (int e = 0; e < 2; e++)
+   {
+      Node* node = ends[e];
+      node->cell.pos = at[e];
+      node->cell.L = node->cell.R = at[e].X;
+      node->cell.T = node->cell.B = at[e].Y;
+      node->cell.isValid = true;
+      node->index = n + e;
+      link(node, 2 * k);
+      nodes.push_back(node);
+   }
+   if (checker.segmentFree(start, goal))
+   {
+      Cost w = Manager::distance(start, goal);
+      src.edges.push_back(Edge(&src, &dst, w));
+      dst.edges.push_back(Edge(&dst, &src, w));
+   }
+
+   dijkstraSearch(nodes, &src, &dst);
+   Path found;
+   bool ok = traceShortestPath(&src, &dst, found);
+   if (ok)
+   {
+      cost = dst.dist;
+      path.assign(found.begin() + 1, found.end() - 1);
+   }
+
+   // unlink them again, their edges were added last
+   nodes.resize(n);
+   for (int i = 0; i < n; i++)
+      while (!nodes[i]->edges.empty() && nodes[i]->edges.back().dest->index >= n)
+         nodes[i]->edges.pop_back();
+   return ok;
+}
@@ -0,0 +1,72 @@
+
+#ifndef PRM_H_
+#define PRM_H_
+
+#include "consts.h"
+#include "cspace.h"
+#include "kdtree.h"
+#include "smoother.h"
+
+#include <vector>
+
+class ThreadPool;
+
+/*
+ * Probabilistic roadmap, for scenes where the exact decomposition would
+ * produce too many cells.
+ *
+ * Random samples in the robot's free configuration space become nodes,
+ * each connected to its k nearest neighbors (kd-tree) wherever the straight
+ * segment is free.  Sampling and edge checks are spread over a thread pool.
+ * Sample i always comes from the same random numbers, so the roadmap does
+ * not depend on the thread count.
+ *
+ * The roadmap is kept until the obstacles change and answers any number
+ * of queries: the start and goal are linked in temporarily, searched with
+ * the same Dijkstra as the cells, and unlinked again.
+ */
+class Roadmap
+{
+public:
+   Roadmap();
+   ~Roadmap();
+
+   // rebuild if the obstacles, world or settings changed since last time
+   void  update(const Obstacles& obstacles, int width, int height, ThreadPool* pool);
+   void  build(const Obstacles& obstacles, int width, int height, ThreadPool* pool);
+   void  clear();
+
+   // path of roadmap samples (as cells) from start to goal, the ends not
+   // included; returns false if they are not connected
+   bool  query(const Position& start, const Position& goal, Path& path, Cost& cost);
+
+   void  setSamples(int _samples)   {samples = _samples;}
+   void  setNeighbors(int _k)       {k = _k;}
+   void  setSeed(unsigned int _seed){seed = _seed;}
+
+   int   getSamples()   const {return samples;}
+   int   numNodes()     const {return nodes.size();}
+   int   numEdges()     const;
+   const Nodes& getNodes() const {return nodes;}
+
+private:
+   int            samples;  // attempted, the ones in collision are dropped
+   int            k;
+   unsigned int   seed;
+
+   // what the current roadmap was built for
+   Obstacles      builtObstacles;
+   int            builtWidth;
+   int            builtHeight;
+   int            builtSamples;
+   int            builtK;
+   unsigned int   builtSeed;
+
+   Nodes          nodes;
+   KdTree         tree;
+   Smoother       checker;  // point and segment tests against the obstacle union
+
+   void  link(Node* node, int count);
+};
+
+#endif
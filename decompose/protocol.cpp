@@ -0,0 +1,249 @@
+
+#include "protocol.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+
+
+// append / consume plain values
+template <class T>
+static void put(vector<char>& out, T value)
+{
+   const char* bytes = (const char*) &value;
+   out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+class Reader
+{
+public:
+   Reader(const vector<char>& _in) : in(_in), at(0), ok(true) {};
+
+   template <class T>
+   T get()
+   {
+      T value = T();
+      if (at + sizeof(T) > in.size())
+      {
+         ok = false;
+         return value;
+      }
+      memcpy(&value, &in[at], sizeof(T));
+      at += sizeof(T);
+      return value;
+   }
+
+   // a count of items of itemSize bytes that must still fit in the input
+   unsigned int count(size_t itemSize)
+   {
+      unsigned int n = get<unsigned int>();
+      if ((unsigned long long) n * itemSize > in.size() - at)
+         ok = false;
+      return ok ? n : 0;
+   }
+
+   bool done() const {return ok && at == in.size();}
+
+private:
+   const vector<char>& in;
+   size_t at;
+   bool   ok;
+};
+
+void encodeRequest(const PlanRequest& request, vector<char>& out)
+{
+   out.clear();
+   put<unsigned int>(out, SERVICE_MAGIC);
+   put<unsigned int>(out, request.type);
+   put<unsigned int>(out, request.flags);
+   put<unsigned long long>(out, request.sceneId);
+   if (request.type == REQUEST_INLINE)
+   {
+      const Scene& scene = request.scene;
+      put<int>(out, scene.width);
+      put<int>(out, scene.height);
+      put<int>(out, scene.robotRadius);
+      put<unsigned int>(out, scene.boxes.size());
+      for (int i = 0; i < scene.boxes.size(); i++)
+      {
+         put<int>(out, scene.boxes[i].pos.X);
+         put<int>(out, scene.boxes[i].pos.Y);
+         put<int>(out, scene.boxes[i].size);
+      }
+   }
+   put<unsigned int>(out, request.starts.size());
+   for (int i = 0; i < request.starts.size(); i++)
+   {
+      put<int>(out, request.starts[i].X);
+      put<int>(out, request.starts[i].Y);
+      put<int>(out, request.goals[i].X);
+      put<int>(out, request.goals[i].Y);
+   }
+}
+
+bool decodeRequest(const vector<char>& in, PlanRequest& request)
+{
+   Reader reader(in);
+   if (reader.get<unsigned int>() != SERVICE_MAGIC)
+      return false;
+   request.type    = reader.get<unsigned int>();
+   request.flags   = reader.get<unsigned int>();
+   request.sceneId = reader.get<unsigned long long>();
+   if (request.type != REQUEST_INLINE && request.type != REQUEST_SCENE_ID)
+      return false;
+
+   if (request.type == REQUEST_INLINE)
+   {
+      Scene& scene = request.scene;
+      scene.width       = reader.get<int>();
+      scene.height      = reader.get<int>();
+      scene.robotRadius = reader.get<int>();
+      scene.boxes.resize(reader.count(3 * sizeof(int)));
+      for (int i = 0; i < scene.boxes.size(); i++)
+      {
+         scene.boxes[i].pos.X = reader.get<int>();
+         scene.boxes[i].pos.Y = reader.get<int>();
+         scene.boxes[i].size  = reader.get<int>();
+      }
+      if (scene.width <= 0 || scene.height <= 0 || scene.robotRadius < 0)
+         return false;
+   }
+
+   unsigned int queries = reader.count(4 * sizeof(int));
+   request.starts.resize(queries);
+   request.goals.resize(queries);
+   for (int i = 0; i < queries; i++)
+   {
+      request.starts[i].X = reader.get<int>();
+      request.starts[i].Y = reader.get<int>();
+      request.goals[i].X  = reader.get<int>();
+      request.goals[i].Y  = reader.get<int>();
+   }
+   return reader.done();
+}
+
+void encodeResponse(const PlanResponse& response, vector<char>& out)
+{
+   out.clear();
+   put<unsigned int>(out, response.status);
+   put<unsigned long long>(out, response.sceneId);
+   put<unsigned int>(out, response.results.size());
+   for (int i = 0; i < response.results.size(); i++)
+   {
+      const PlanResult& result = response.results[i];
+      put<long long>(out, result.cost == COST_INF ? -1 : result.cost);
+      put<unsigned int>(out, result.points.size());
+      for (int p = 0; p < result.points.size(); p++)
+      {
+         put<int>(out, result.points[p].X);
+         put<int>(out, result.points[p].Y);
+      }
+   }
+}
+
+bool decodeResponse(const vector<char>& in, PlanResponse& response)
+{
+   Reader reader(in);
+   response.status  = reader.get<unsigned int>();
+   response.sceneId = reader.get<unsigned long long>();
+   response.results.resize(reader.count(sizeof(long long) + sizeof(unsigned int)));
+   for (int i = 0; i < response.results.size(); i++)
+   {
+      PlanResult& result = response.results[i];
+      long long cost = reader.get<long long>();
+      result.cost = cost < 0 ? COST_INF : cost;
+      result.points.resize(reader.count(2 * sizeof(int)));
+      for (int p = 0; p < result.points.size(); p++)
+      {
+         result.points[p].X = reader.get<int>();
+         result.points[p].Y = reader.get<int>();
+      }
+   }
+   return reader.done();
+}
+
+static bool readAll(int fd, char* data, size_t size)
+{
+   while (size > 0)
+   {
+      ssize_t n = read(fd, data, size);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         return false;
+      data += n;
+      size -= n;
+   }
+   return true;
+}
+
+static bool writeAll(int fd, const char* data, size_t size)
+{
+   while (size > 0)
+   {
+      ssize_t n = write(fd, data, size);
+      if (n < 0 && errno == EINTR)
+         continue;
+      if (n <= 0)
+         return false;
+      data += n;
+      size -= n;
+   }
+   return true;
+}
+
+bool readFrame(int fd, vector<char>& payload)
+{
+   unsigned int size = 0;
+   if (!readAll(fd, (char*) &size, sizeof(size)) || size > MAX_FRAME_SIZE)
+      return false;
+   payload.resize(size);
+   return size == 0 || readAll(fd, &payload[0], size);
+}
+
+bool writeFrame(int fd, const vector<char>& payload)
+{
+   unsigned int size = payload.size();
+   return writeAll(fd, (const char*) &size, sizeof(size)) &&
+          (size == 0 || writeAll(fd, &payload[0], size));
+}
+
+int takeFrame(vector<char>& buffer, vector<char>& payload)
+{
+   unsigned int size = 0;
+   if (buffer.size() < sizeof(size))
+      return 0;
+   memcpy(&size, &buffer[0], sizeof(size));
+   if (size > MAX_FRAME_SIZE)
+      return -1;
+   if (buffer.size() < sizeof(size) + size)
+      return 0;
+   payload.assign(buffer.begin() + sizeof(size), buffer.begin() + sizeof(size) + size);
+   buffer.erase(buffer.begin(), buffer.begin() + sizeof(size) + size);
+   return 1;
+}
+
+// FNV-1a over the values that decide the decomposition
+unsigned long long sceneHash(const Scene& scene)
+{
+   unsigned long long hash = 14695981039346656037ULL;
+   vector<int> values;
+   values.push_back(scene.width);
+   values.push_back(scene.height);
+   values.push_back(scene.robotRadius);
+   for (int i = 0; i < scene.boxes.size(); i++)
+   {
+      values.push_back(scene.boxes[i].pos.X);
+      values.push_back(scene.boxes[i].pos.Y);
+      values.push_back(scene.boxes[i].size);
+   }
+   const unsigned char* bytes = (const unsigned char*) &values[0];
+   for (size_t i = 0; i < values.size() * sizeof(int); i++)
+   {
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+   }
+   return hash;
+}
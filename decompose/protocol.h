@@ -0,0 +1,84 @@
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include "consts.h"
+#include "scene.h"
+#include "smoother.h"
+
+#include <vector>
+
+/*
+ * Wire format of the planning service (decompose_service).
+ *
+ * Every message is a frame: a 32-bit payload length followed by the
+ * payload.  Integers are in host byte order, the socket never leaves the
+ * machine.
+ *
+ * Request:   magic, type, flags (32-bit), scene id (64-bit),
+ *            [REQUEST_INLINE only] width, height, robot radius, box count,
+ *                                  then x, y, size per box (32-bit each),
+ *            query count, then start x, y, goal x, y per query (32-bit)
+ * Response:  status (32-bit), scene id (64-bit), result count (32-bit),
+ *            then per query: cost (64-bit, -1 if no path), point count
+ *            (32-bit), x, y per point (32-bit)
+ *
+ * An inline request registers its scene under the returned id, later
+ * requests can refer to it by id alone while the service keeps it cached.
+ */
+
+const unsigned int SERVICE_MAGIC     = 0x31504344; // "DCP1"
+const unsigned int MAX_FRAME_SIZE    = 64 << 20;
+
+enum RequestType {
+   REQUEST_INLINE   = 1,   // scene included
+   REQUEST_SCENE_ID = 2    // scene by id
+};
+
+enum ResponseStatus {
+   STATUS_OK            = 0,
+   STATUS_UNKNOWN_SCENE = 1,  // evicted or never sent, send it inline again
+   STATUS_BAD_REQUEST   = 2
+};
+
+// request flags
+const unsigned int FLAG_SMOOTH = 1;   // shortcut the returned paths
+
+struct PlanRequest {
+   unsigned int          type;
+   unsigned int          flags;
+   unsigned long long    sceneId;
+   Scene                 scene;   // REQUEST_INLINE only (robot / dest unused)
+   std::vector<Position> starts;
+   std::vector<Position> goals;
+};
+
+struct PlanResult {
+   Cost      cost;    // COST_INF if there is no path
+   Waypoints points;  // start, cell centers (or shortcuts), goal
+};
+
+struct PlanResponse {
+   unsigned int            status;
+   unsigned long long      sceneId;
+   std::vector<PlanResult> results;
+};
+
+void  encodeRequest(const PlanRequest& request, std::vector<char>& out);
+bool  decodeRequest(const std::vector<char>& in, PlanRequest& request);
+void  encodeResponse(const PlanResponse& response, std::vector<char>& out);
+bool  decodeResponse(const std::vector<char>& in, PlanResponse& response);
+
+// blocking, false on a closed socket, error or oversized frame
+bool  readFrame(int fd, std::vector<char>& payload);
+bool  writeFrame(int fd, const std::vector<char>& payload);
+
+// for readers that buffer the bytes themselves: moves the whole frame at
+// the front of buffer into payload and returns 1, 0 if it is not all
+// there yet, -1 if it is oversized
+int   takeFrame(std::vector<char>& buffer, std::vector<char>& payload);
+
+// id of a scene's obstacles (world, radius and boxes)
+unsigned long long sceneHash(const Scene& scene);
+
+#endif
@@ -0,0 +1,196 @@
+
+/*
+   Python bindings for batch planning (pybind11, built only when pybind11
+   is found).
+
+      import numpy as np, pydecompose
+      planner = pydecompose.Planner(100000, 100000, robot_radius=700)
+      planner.set_boxes(np.array([[x, y, size], ...], dtype=np.int32))
+      costs, offsets, points = planner.plan(starts, goals)   # (n, 2) int32
+
+   Path i is points[offsets[i]:offsets[i+1]], its cost is costs[i] (world
+   units, inf if there is no path).  The outputs are handed over to NumPy
+   without copying, and plan() releases the GIL while it runs so several
+   Planners can work from Python threads at once.
+ */
+
+#include "consts.h"
+#include "manager.h"
+#include "scene.h"
+
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+using namespace std;
+
+typedef py::array_t<int, py::array::c_style | py::array::forcecast> IntArray;
+
+
+// NumPy array taking over a vector's storage, no copy
+template <class T>
+static py::array_t<T> toArray(unique_ptr<vector<T> >& data, vector<py::ssize_t> shape)
+{
+   const T* values = data->data();
+   py::capsule owner(data.get(), [](void* p) {delete (vector<T>*) p;});
+   data.release();
+   return py::array_t<T>(shape, values, owner);
+}
+
+// (n, columns) int32 array, or throws
+static void checkShape(const IntArray& array, int columns, const char* name)
+{
+   if (array.ndim() != 2 || array.shape(1) != columns)
+      throw py::value_error(string(name) + " must have shape (n, " +
+                            to_string(columns) + ")");
+}
+
+/*
+ * A Manager with its own lock: a Planner is used by one thread at a time,
+ * separate Planners plan in parallel.
+ */
+class PyPlanner
+{
+public:
+   PyPlanner(int width, int height, int robotRadius)
+   : manager(width, height)
+   {
+      manager.setRobotRadius(robotRadius);
+   }
+
+   // rows of x, y, size (box center and half width)
+   void setBoxes(IntArray boxes)
+   {
+      checkShape(boxes, 3, "boxes");
+      auto rows = boxes.unchecked<2>();
+      py::gil_scoped_release release;
+      lock_guard<mutex> guard(lock);
+      manager.clearBoxes();
+      for (py::ssize_t i = 0; i < rows.shape(0); i++)
+      {
+         Box box;
+         box.pos.X = rows(i, 0);
+         box.pos.Y = rows(i, 1);
+         box.size  = rows(i, 2);
+         manager.addBox(box);
+      }
+   }
+
+   void setDecomposition(const string& name)
+   {
+      Manager::Decomposition mode;
+      if (name == "grid")
+         mode = Manager::DECOMP_GRID;
+      else if (name == "quadtree")
+         mode = Manager::DECOMP_QUADTREE;
+      else if (name == "prm")
+         mode = Manager::DECOMP_PRM;
+      else if (name == "visibility")
+         mode = Manager::DECOMP_VISIBILITY;
+      else
+         throw py::value_error("decomposition must be grid, quadtree, prm or visibility");
+      lock_guard<mutex> guard(lock);
+      manager.setDecomposition(mode);
+   }
+
+   void setSmoothing(bool smooth)
+   {
+      lock_guard<mutex> guard(lock);
+      manager.setSmoothing(smooth);
+   }
+
+   void setMinCellSize(int size)
+   {
+      lock_guard<mutex> guard(lock);
+      manager.setMinCellSize(size);
+   }
+
+   // one path per start / goal row, see the top of the file
+   py::tuple plan(IntArray starts, IntArray goals)
+   {
+      checkShape(starts, 2, "starts");
+      checkShape(goals, 2, "goals");
+      if (starts.shape(0) != goals.shape(0))
+         throw py::value_error("starts and goals must have the same length");
+
+      auto from = starts.unchecked<2>();
+      auto to   = goals.unchecked<2>();
+      py::ssize_t queries = from.shape(0);
+
+      unique_ptr<vector<double> >    costs(new vector<double>(queries));
+      unique_ptr<vector<long long> > offsets(new vector<long long>(queries + 1, 0));
+      unique_ptr<vector<int> >       points(new vector<int>());
+      {
+         py::gil_scoped_release release;
+         lock_guard<mutex> guard(lock);
+         for (py::ssize_t i = 0; i < queries; i++)
+         {
+            Position start, goal;
+            start.X = from(i, 0);
+            start.Y = from(i, 1);
+            goal.X  = to(i, 0);
+            goal.Y  = to(i, 1);
+            (*costs)[i] = numeric_limits<double>::infinity();
+
+            // the manager complains on cout about blocked ends
+            if (manager.isFree(start) && manager.isFree(goal))
+            {
+               manager.setRobot(start);
+               manager.setDest(goal);
+               manager.replan();
+               if (manager.getPathCost() != COST_INF)
+               {
+                  (*costs)[i] = (double) manager.getPathCost() / COST_SCALE;
+                  Waypoints path = manager.getSmoothing() ? manager.getSmoothedPath()
+                                                          : manager.getWaypoints();
+                  for (int p = 0; p < path.size(); p++)
+                  {
+                     points->push_back(path[p].X);
+                     points->push_back(path[p].Y);
+                  }
+               }
+            }
+            (*offsets)[i + 1] = points->size() / 2;
+         }
+      }
+
+      py::ssize_t numPoints = points->size() / 2;
+      return py::make_tuple(toArray(costs, {queries}),
+                            toArray(offsets, {queries + 1}),
+                            toArray(points, {numPoints, (py::ssize_t) 2}));
+   }
+
+   int numCells()
+   {
+      lock_guard<mutex> guard(lock);
+      return manager.getNumNodes();
+   }
+
+private:
+   Manager  manager;
+   mutex    lock;
+};
+
+PYBIND11_MODULE(pydecompose, m)
+{
+   m.doc() = "Batch path planning with the decompose cell decomposition";
+
+   py::class_<PyPlanner>(m, "Planner")
+      .def(py::init<int, int, int>(),
+           py::arg("width"), py::arg("height"), py::arg("robot_radius") = ROBOT_RADIUS)
+      .def("set_boxes", &PyPlanner::setBoxes, py::arg("boxes"),
+           "Replace the obstacles with an (n, 3) array of x, y, size")
+      .def("set_decomposition", &PyPlanner::setDecomposition, py::arg("name"),
+           "'grid' (exact), 'quadtree', 'prm' or 'visibility' (shortest)")
+      .def("set_smoothing", &PyPlanner::setSmoothing, py::arg("smooth"))
+      .def("set_min_cell_size", &PyPlanner::setMinCellSize, py::arg("size"))
+      .def("plan", &PyPlanner::plan, py::arg("starts"), py::arg("goals"),
+           "Plan every start / goal row, returns (costs, offsets, points)")
+      .def_property_readonly("num_cells", &PyPlanner::numCells);
+}
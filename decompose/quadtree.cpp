@@ -0,0 +1,185 @@
+
+#include "quadtree.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+QuadTree::QuadTree()
+: minSize(1)
+{
+}
+
+QuadTree::~QuadTree()
+{
+}
+
+void QuadTree::clear()
+{
+   quads.clear();
+   leaves.clear();
+}
+
+int QuadTree::addQuad(int L, int R, int T, int B)
+{
+   Quad quad;
+   quad.L = L;
+   quad.R = R;
+   quad.T = T;
+   quad.B = B;
+   quad.mx = R;
+   quad.my = B;
+   quad.child[0] = quad.child[1] = quad.child[2] = quad.child[3] = -1;
+   quad.leaf = -1;
+   quads.push_back(quad);
+   return quads.size() - 1;
+}
+
+void QuadTree::addLeaf(int q, bool free)
+{
+   const Quad& quad = quads[q];
+   Cell cell;
+   cell.L  = quad.L;
+   cell.R  = quad.R;
+   cell.T  = quad.T;
+   cell.B  = quad.B;
+   cell.TL = Position(cell.L, cell.T);
+   cell.TR = Position(cell.R, cell.T);
+   cell.BL = Position(cell.L, cell.B);
+   cell.BR = Position(cell.R, cell.B);
+   cell.pos = Position(cell.L + (cell.R - cell.L) / 2,
+                       cell.T + (cell.B - cell.T) / 2);
+   cell.isValid = free;
+
+   quads[q].leaf = leaves.size();
+   leaves.push_back(cell);
+}
+
+void QuadTree::build(const Obstacles& obstacles, int width, int height, int _minSize)
+{
+   clear();
+   minSize = max(1, _minSize);
+
+   vector<int> all(obstacles.size());
+   for (int i = 0; i < obstacles.size(); i++)
+      all[i] = i;
+
+   addQuad(0, width, 0, height);
+   split(0, obstacles, all);
+}
+
+// candidates are the obstacles touching the parent; keep the ones
+// touching this quad and decide free / full / mixed from the covered area
+// (the obstacles are disjoint, so their overlaps simply add up)
+void QuadTree::split(int q, const Obstacles& obstacles, const vector<int>& candidates)
+{
+   int L = quads[q].L, R = quads[q].R, T = quads[q].T, B = quads[q].B;
+
+   vector<int> inside;
+   long long covered = 0;
+   for (int i = 0; i < candidates.size(); i++)
+   {
+      const Obstacle& o = obstacles[candidates[i]];
+      int w = min(R, o.R) - max(L, o.L);
+      int h = min(B, o.B) - max(T, o.T);
+      if (w <= 0 || h <= 0)
+         continue;
+      inside.push_back(candidates[i]);
+      covered += (long long) w * h;
+   }
+
+   long long area = (long long) (R - L) * (B - T);
+   bool splitX = (R - L) > minSize;
+   bool splitY = (B - T) > minSize;
+   if (inside.empty() || covered >= area || (!splitX && !splitY))
+   {
+      // free, full, or mixed at the minimum size (treated as occupied)
+      addLeaf(q, inside.empty());
+      return;
+   }
+
+   int mx = splitX ? L + (R - L) / 2 : R;
+   int my = splitY ? T + (B - T) / 2 : B;
+   quads[q].mx = mx;
+   quads[q].my = my;
+
+   int xs[3] = { L, mx, R };
+   int ys[3] = { T, my, B };
+   for (int c = 0; c < 4; c++)
+   {
+      int cx = c % 2;
+      int cy = c / 2;
+      if (xs[cx] == xs[cx+1] || ys[cy] == ys[cy+1])
+         continue;
+      int child = addQuad(xs[cx], xs[cx+1], ys[cy], ys[cy+1]);
+      quads[q].child[c] = child;   // quads may have grown, index again
+      split(child, obstacles, inside);
+   }
+}
+
+int QuadTree::locate(int x, int y) const
+{
+   if (quads.empty())
+      return -1;
+   const Quad* quad = &quads[0];
+   if (x < quad->L || x >= quad->R || y < quad->T || y >= quad->B)
+      return -1;
+
+   while (quad->leaf < 0)
+   {
+      int c = (y >= quad->my ? 2 : 0) + (x >= quad->mx ? 1 : 0);
+      if (quad->child[c] < 0)
+         return -1;
+      quad = &quads[quad->child[c]];
+   }
+   return quad->leaf;
+}
+
+// Walk along each side of the leaf, locating the leaf just across it and
+// jumping to that leaf's far end: O(depth) per neighbor
+void QuadTree::neighbors(int leaf, vector<int>& out) const
+{
+   out.clear();
+   const Cell& cell = leaves[leaf];
+
+   for (int y = cell.T; y < cell.B; )
+   {
+      int right = locate(cell.R, y);
+      int left  = locate(cell.L - 1, y);
+      int next  = cell.B;
+      if (right >= 0)
+      {
+         out.push_back(right);
+         next = min(next, leaves[right].B);
+      }
+      if (left >= 0)
+      {
+         if (left != right)
+            out.push_back(left);
+         next = min(next, leaves[left].B);
+      }
+      y = next;
+   }
+   for (int x = cell.L; x < cell.R; )
+   {
+      int bottom = locate(x, cell.B);
+      int top    = locate(x, cell.T - 1);
+      int next   = cell.R;
+      if (bottom >= 0)
+      {
+         out.push_back(bottom);
+         next = min(next, leaves[bottom].R);
+      }
+      if (top >= 0)
+      {
+         out.push_back(top);
+         next = min(next, leaves[top].R);
+      }
+      x = next;
+   }
+
+   // a neighbor spanning several steps of the walk shows up more than once
+   sort(out.begin(), out.end());
+   out.erase( unique(out.begin(), out.end()), out.end() );
+}
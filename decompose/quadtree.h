@@ -0,0 +1,59 @@
+
+#ifndef QUADTREE_H_
+#define QUADTREE_H_
+
+#include "consts.h"
+#include "cspace.h"
+
+#include <vector>
+
+/*
+ * Adaptive quadtree approximate cell decomposition.
+ *
+ * A region is split in four only while it is mixed (partly covered by
+ * obstacles) and larger than the minimum cell size; fully free and fully
+ * covered regions stay whole, so open space gives a few big cells and
+ * clutter gives many small ones.  Mixed regions at the minimum size are
+ * labelled occupied, so free leaves never touch an obstacle.
+ *
+ * Works on any set of disjoint obstacle rectangles (as CSpace produces).
+ */
+class QuadTree
+{
+public:
+   QuadTree();
+   ~QuadTree();
+
+   void  build(const Obstacles& obstacles, int width, int height, int minSize);
+   void  clear();
+
+   // the leaves, as cells (isValid = free)
+   int         numLeaves()    const {return leaves.size();}
+   const Cell& getLeaf(int i) const {return leaves[i];}
+
+   // leaf containing the point, or -1 outside the world
+   int   locate(int x, int y) const;
+
+   // every leaf sharing a side (not just a corner) with the given leaf
+   void  neighbors(int leaf, std::vector<int>& out) const;
+
+   int   numNodes() const {return quads.size();}
+
+private:
+   struct Quad {
+      int L, R, T, B;
+      int mx, my;       // split lines
+      int child[4];     // TL, TR, BL, BR (-1 if empty or a leaf)
+      int leaf;         // index into leaves, -1 if split
+   };
+
+   std::vector<Quad> quads;
+   std::vector<Cell> leaves;
+   int   minSize;
+
+   void  split(int quad, const Obstacles& obstacles, const std::vector<int>& candidates);
+   int   addQuad(int L, int R, int T, int B);
+   void  addLeaf(int quad, bool free);
+};
+
+#endif
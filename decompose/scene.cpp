@@ -0,0 +1,216 @@
+
+#include "scene.h"
+#include "manager.h"
+#include "planner3d.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+// Small deterministic generator so scenes do not depend on the libc rand()
+class SceneRandom
+{
+public:
+   SceneRandom(unsigned int seed) : state(seed * 2654435761u + 1) {};
+
+   // uniform in [lo, hi]
+   int range(int lo, int hi)
+   {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+      unsigned long long r = state >> 33;
+      return lo + (int) (r % (unsigned long long) (hi - lo + 1));
+   }
+
+private:
+   unsigned long long state;
+};
+
+// is pos within margin of a box?
+static bool inBox(const Boxes& boxes, const Position& pos, int margin)
+{
+   for (int i = 0; i < boxes.size(); i++)
+   {
+      int size = boxes[i].size + margin;
+      if ( pos.X < boxes[i].pos.X + size &&
+           pos.X > boxes[i].pos.X - size &&
+           pos.Y < boxes[i].pos.Y + size &&
+           pos.Y > boxes[i].pos.Y - size )
+         return true;
+   }
+   return false;
+}
+
+Scene generateScene(int width, int height, int numBoxes, unsigned int seed)
+{
+   SceneRandom random(seed);
+   Scene scene;
+   scene.width  = width;
+   scene.height = height;
+
+   // keep the same 10% margin the GUI uses (BUFFER of a 500 pixel world),
+   // and size boxes so they cover about a third of the world
+   int buffer  = max(1, min(width, height) / 10);
+   int maxSize = max(2, (int) (min(width, height) / (3.0 * sqrt((double) max(1, numBoxes)))));
+   int minSize = max(1, maxSize / 4);
+
+   // the GUI's robot is a tenth of its smallest box
+   scene.robotRadius = max(1, minSize * ROBOT_RADIUS / BOX2_SIZE);
+
+   for (int i = 0; i < numBoxes; i++)
+   {
+      Position pos(random.range(buffer, width  - buffer),
+                   random.range(buffer, height - buffer));
+      scene.boxes.push_back(Box(pos, random.range(minSize, maxSize)));
+   }
+
+   // give up on free space after a while rather than spin forever
+   for (int tries = 0; tries < 1000; tries++)
+   {
+      scene.robot = Position(random.range(buffer, width  - buffer),
+                             random.range(buffer, height - buffer));
+      if (!inBox(scene.boxes, scene.robot, scene.robotRadius))
+         break;
+   }
+   for (int tries = 0; tries < 1000; tries++)
+   {
+      scene.dest = Position(random.range(buffer, width  - buffer),
+                            random.range(buffer, height - buffer));
+      if (!inBox(scene.boxes, scene.dest, scene.robotRadius))
+         break;
+   }
+
+   return scene;
+}
+
+void generateRobots(const Scene& scene, int count, unsigned int seed,
+                    vector<Position>& starts, vector<Position>& goals)
+{
+   SceneRandom random(seed);
+   int buffer = max(1, min(scene.width, scene.height) / 10);
+   starts.clear();
+   goals.clear();
+   for (int i = 0; i < 2 * count; i++)
+   {
+      Position pos;
+      for (int tries = 0; tries < 1000; tries++)
+      {
+         pos = Position(random.range(buffer, scene.width  - buffer),
+                        random.range(buffer, scene.height - buffer));
+         if (!inBox(scene.boxes, pos, scene.robotRadius))
+            break;
+      }
+      if (i % 2 == 0)
+         starts.push_back(pos);
+      else
+         goals.push_back(pos);
+   }
+}
+
+static bool inBox(const Boxes3& boxes, const Position3& pos, int margin)
+{
+   for (int i = 0; i < boxes.size(); i++)
+   {
+      int size = boxes[i].size + margin;
+      if ( abs(pos.X - boxes[i].pos.X) < size &&
+           abs(pos.Y - boxes[i].pos.Y) < size &&
+           abs(pos.Z - boxes[i].pos.Z) < size )
+         return true;
+   }
+   return false;
+}
+
+Scene3 generateScene3(int width, int height, int depth, int numBoxes, unsigned int seed)
+{
+   SceneRandom random(seed);
+   Scene3 scene;
+   scene.width  = width;
+   scene.height = height;
+   scene.depth  = depth;
+
+   // as in 2D, but n cubes side by side span the cube root of n
+   int extent  = min(width, min(height, depth));
+   int buffer  = max(1, extent / 10);
+   int maxSize = max(2, (int) (extent / (3.0 * cbrt((double) max(1, numBoxes)))));
+   int minSize = max(1, maxSize / 4);
+   scene.robotRadius = max(1, minSize * ROBOT_RADIUS / BOX2_SIZE);
+
+   for (int i = 0; i < numBoxes; i++)
+   {
+      Position3 pos(random.range(buffer, width  - buffer),
+                    random.range(buffer, height - buffer),
+                    random.range(buffer, depth  - buffer));
+      scene.boxes.push_back(Box3(pos, random.range(minSize, maxSize)));
+   }
+
+   for (int tries = 0; tries < 1000; tries++)
+   {
+      scene.robot = Position3(random.range(buffer, width  - buffer),
+                              random.range(buffer, height - buffer),
+                              random.range(buffer, depth  - buffer));
+      if (!inBox(scene.boxes, scene.robot, scene.robotRadius))
+         break;
+   }
+   for (int tries = 0; tries < 1000; tries++)
+   {
+      scene.dest = Position3(random.range(buffer, width  - buffer),
+                             random.range(buffer, height - buffer),
+                             random.range(buffer, depth  - buffer));
+      if (!inBox(scene.boxes, scene.dest, scene.robotRadius))
+         break;
+   }
+
+   return scene;
+}
+
+bool sameObstacles(const Scene& a, const Scene& b)
+{
+   if (a.width != b.width || a.height != b.height ||
+       a.robotRadius != b.robotRadius || a.boxes.size() != b.boxes.size())
+      return false;
+   for (int i = 0; i < a.boxes.size(); i++)
+      if (a.boxes[i].pos.X != b.boxes[i].pos.X || a.boxes[i].pos.Y != b.boxes[i].pos.Y ||
+          a.boxes[i].size != b.boxes[i].size)
+         return false;
+   return true;
+}
+
+Scene scaleScene(const Scene& scene, int factor)
+{
+   Scene scaled = scene;
+   scaled.width  *= factor;
+   scaled.height *= factor;
+   scaled.robotRadius *= factor;
+   for (int i = 0; i < scaled.boxes.size(); i++)
+   {
+      scaled.boxes[i].pos.X *= factor;
+      scaled.boxes[i].pos.Y *= factor;
+      scaled.boxes[i].size  *= factor;
+   }
+   scaled.robot = Position(scene.robot.X * factor, scene.robot.Y * factor);
+   scaled.dest  = Position(scene.dest.X  * factor, scene.dest.Y  * factor);
+   return scaled;
+}
+
+void loadScene(Manager* manager, const Scene& scene)
+{
+   manager->setWorldSize(scene.width, scene.height);
+   manager->setRobotRadius(scene.robotRadius);
+   manager->clearBoxes();
+   for (int i = 0; i < scene.boxes.size(); i++)
+      manager->addBox(scene.boxes[i]);
+   manager->setRobot(scene.robot);
+   manager->setDest(scene.dest);
+}
+
+void loadScene(Planner3D* planner, const Scene3& scene)
+{
+   planner->setWorldSize(scene.width, scene.height, scene.depth);
+   planner->setRobotRadius(scene.robotRadius);
+   planner->clearBoxes();
+   for (int i = 0; i < scene.boxes.size(); i++)
+      planner->addBox(scene.boxes[i]);
+   planner->setRobot(scene.robot);
+   planner->setDest(scene.dest);
+}
@@ -0,0 +1,53 @@
+
+#ifndef SCENE_H_
+#define SCENE_H_
+
+#include "consts.h"
+
+class Manager;
+class Planner3D;
+
+// A complete planning problem, independent of any Manager
+struct Scene {
+   int         width;
+   int         height;
+   Boxes       boxes;
+   Robot       robot;
+   Destination dest;
+   int         robotRadius;
+};
+
+// The same for a 3D world of cubes
+struct Scene3 {
+   int         width;
+   int         height;
+   int         depth;
+   Boxes3      boxes;
+   Position3   robot;
+   Position3   dest;
+   int         robotRadius;
+};
+
+// true if both give the same obstacles: world, robot radius and boxes
+bool  sameObstacles(const Scene& a, const Scene& b);
+
+// Random boxes of varied size plus a robot and destination in free space.
+// The robot radius keeps the GUI's ratio of ROBOT_RADIUS to box size.
+// The same seed always gives the same scene.
+Scene generateScene(int width, int height, int numBoxes, unsigned int seed);
+
+// count start / goal pairs in the scene's free space, for a fleet
+void  generateRobots(const Scene& scene, int count, unsigned int seed,
+                     std::vector<Position>& starts, std::vector<Position>& goals);
+
+// Random cubes sized like generateScene's boxes, for the 3D planner
+Scene3 generateScene3(int width, int height, int depth, int numBoxes, unsigned int seed);
+
+// Every coordinate multiplied by factor (same topology, bigger numbers)
+Scene scaleScene(const Scene& scene, int factor);
+
+// Replace the manager's world, boxes, robot and destination
+void  loadScene(Manager* manager, const Scene& scene);
+void  loadScene(Planner3D* planner, const Scene3& scene);
+
+#endif
@@ -0,0 +1,101 @@
+
+#include "search.h"
+
+#include <iostream>
+#include <list>
+#include <queue>
+
+using namespace std;
+
+
+template <int D>
+void dijkstraSearch(const vector<NodeT<D>*>& nodes, NodeT<D>* src, NodeT<D>* dest)
+{
+   typedef pair<Cost, int> QueueEntry;
+   priority_queue<QueueEntry, vector<QueueEntry>, greater<QueueEntry> > queue;
+
+   for (int i = 0; i < nodes.size(); i++)
+   {
+      nodes[i]->dist  = COST_INF;
+      nodes[i]->spset = false;
+   }
+
+   // set distance of source node to 0
+   src->dist = 0;
+   queue.push(QueueEntry(0, src->index));
+
+   while (!queue.empty())
+   {
+      // find the minimum distance node
+      QueueEntry top = queue.top();
+      queue.pop();
+      NodeT<D>* u = nodes[top.second];
+      if (u->spset || top.first > u->dist)
+         continue; // stale entry
+
+      // mark the discovered minimum distance node as part of the shortest path
+      u->spset = true;
+
+      if (u == dest)
+      {
+         break;
+      }
+
+      // update dist value of adjacent nodes of the picked node
+      for (int e = 0; e < u->edges.size(); e++)
+      {
+         NodeT<D>* v = u->edges[e].dest;
+         Cost      d = u->dist + u->edges[e].weight;
+         if (!v->spset && d < v->dist)
+         {
+            v->dist = d;
+            queue.push(QueueEntry(d, v->index));
+         }
+      }
+   }
+}
+
+template <int D>
+bool traceShortestPath(NodeT<D>* src, NodeT<D>* dest, vector< CellT<D> >& path)
+{
+   path.clear();
+   if (!src || !dest || dest->dist == COST_INF)
+      return false;
+
+   list< CellT<D> > pathList;
+   pathList.push_back(dest->cell);
+   NodeT<D>* currentNode = dest;
+   while (currentNode != src)
+   {
+      NodeT<D>* prev = NULL;
+      for (int i = 0; i < currentNode->edges.size(); i++)
+      {
+         // edges are symmetric, so an outgoing edge doubles as incoming
+         const EdgeT<D>& edge = currentNode->edges[i];
+         NodeT<D>* n = edge.dest;
+         if ( n->dist != COST_INF &&
+              n->dist + edge.weight == currentNode->dist &&
+              (!prev || n->index < prev->index) )
+         {
+            prev = n;
+         }
+      }
+      if (!prev)
+      {
+         cout << "ERROR: broken shortest path tree" << endl;
+         path.clear();
+         return false;
+      }
+      currentNode = prev;
+      pathList.push_back(currentNode->cell);
+   }
+   // reverse it and viola! we have our path
+   pathList.reverse();
+   path.assign(pathList.begin(), pathList.end());
+   return true;
+}
+
+template void dijkstraSearch<2>(const Nodes&, Node*, Node*);
+template void dijkstraSearch<3>(const Nodes3&, Node3*, Node3*);
+template bool traceShortestPath<2>(Node*, Node*, Path&);
+template bool traceShortestPath<3>(Node3*, Node3*, Path3&);
@@ -0,0 +1,26 @@
+
+#ifndef SEARCH_H_
+#define SEARCH_H_
+
+#include "consts.h"
+
+#include <vector>
+
+/*
+ * Serial shortest path search over a cell graph, shared by the 2D manager
+ * and the 3D planner.  Instantiated for 2 and 3 dimensions in search.cpp.
+ */
+
+// Dijkstra's SSSP (binary heap with lazy deletion), stopping once dest
+// is final.  Fills in dist and spset of the nodes.
+template <int D>
+void dijkstraSearch(const std::vector<NodeT<D>*>& nodes, NodeT<D>* src, NodeT<D>* dest);
+
+// Walk back from dest to src along edges that are tight (dist[u] + w ==
+// dist[v]), taking the lowest node index on ties.  Any search that
+// produces the same distances produces the same path.  Returns false (and
+// an empty path) if dest was not reached.
+template <int D>
+bool traceShortestPath(NodeT<D>* src, NodeT<D>* dest, std::vector< CellT<D> >& path);
+
+#endif
@@ -0,0 +1,411 @@
+
+/*
+   Local planning service: answers PlanRequests (see protocol.h) on a
+   Unix domain socket.  No Qt, no GL.
+
+   The main thread polls every connection and hands each whole request
+   frame to a fixed set of worker threads, so idle clients hold no thread.
+   Decomposed scenes stay warm in an LRU cache, each cached scene keeps a
+   few idle Managers so a request only runs the search for every start /
+   goal.
+ */
+
+#include "consts.h"
+#include "manager.h"
+#include "protocol.h"
+#include "scene.h"
+
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+
+// A cached scene and the Managers that have it decomposed
+struct SceneEntry {
+   unsigned long long id;
+   Scene              scene;
+   mutex              lock;   // guards idle
+   vector<Manager*>   idle;
+
+   ~SceneEntry()
+   {
+      for (int i = 0; i < idle.size(); i++)
+         delete idle[i];
+   }
+};
+
+typedef shared_ptr<SceneEntry> SceneEntryPtr;
+
+/*
+ * Least recently used scenes.  Entries are shared so a request can keep
+ * planning on a scene that gets evicted meanwhile.
+ */
+class SceneCache
+{
+public:
+   SceneCache(int _capacity) : capacity(_capacity) {};
+
+   SceneEntryPtr find(unsigned long long id)
+   {
+      lock_guard<mutex> guard(lock);
+      map<unsigned long long, list<SceneEntryPtr>::iterator>::iterator it = byId.find(id);
+      if (it == byId.end())
+         return SceneEntryPtr();
+      entries.splice(entries.begin(), entries, it->second);
+      return *it->second;
+   }
+
+   // the scene's hash is only the first id tried: a different scene on
+   // it moves on to the next id
+   SceneEntryPtr insert(const Scene& scene)
+   {
+      lock_guard<mutex> guard(lock);
+      unsigned long long id = sceneHash(scene);
+      map<unsigned long long, list<SceneEntryPtr>::iterator>::iterator it;
+      while ((it = byId.find(id)) != byId.end() && !sameObstacles((*it->second)->scene, scene))
+         id++;
+      if (it != byId.end())
+      {
+         entries.splice(entries.begin(), entries, it->second);
+         return *it->second;
+      }
+
+      SceneEntryPtr entry = make_shared<SceneEntry>();
+      entry->id = id;
+      entry->scene = scene;
+      entries.push_front(entry);
+      byId[id] = entries.begin();
+      while (entries.size() > capacity)
+      {
+         byId.erase(entries.back()->id);
+         entries.pop_back();
+      }
+      return entry;
+   }
+
+private:
+   int                  capacity;
+   mutex                lock;
+   list<SceneEntryPtr>  entries;   // most recent first
+   map<unsigned long long, list<SceneEntryPtr>::iterator> byId;
+};
+
+static SceneCache*         cache = 0;
+static string              socketPath = "/tmp/decompose.sock";
+
+// A client connection.  While one of its requests is with a worker the
+// poller leaves it alone, so the responses go out in request order.
+struct Connection {
+   vector<char> buffer;   // read, not a whole frame yet
+   bool         busy;
+   Connection() : busy(false) {};
+};
+
+// a request frame for the workers
+struct Job {
+   int          fd;
+   vector<char> payload;
+};
+
+static mutex               queueLock;
+static condition_variable  queueReady;
+static deque<Job>          jobs;
+
+// connections handed back by the workers: fd and whether it is still open
+static mutex               doneLock;
+static deque< pair<int,bool> > done;
+static int                 wakePipe[2];   // a worker wakes the poller
+
+// a Manager holding the entry's decomposition (built on first use)
+static Manager* checkOut(SceneEntry* entry)
+{
+   {
+      lock_guard<mutex> guard(entry->lock);
+      if (!entry->idle.empty())
+      {
+         Manager* manager = entry->idle.back();
+         entry->idle.pop_back();
+         return manager;
+      }
+   }
+   Manager* manager = new Manager(entry->scene.width, entry->scene.height);
+   loadScene(manager, entry->scene);
+   return manager;
+}
+
+static void checkIn(SceneEntry* entry, Manager* manager)
+{
+   lock_guard<mutex> guard(entry->lock);
+   entry->idle.push_back(manager);
+}
+
+static void plan(const PlanRequest& request, PlanResponse& response)
+{
+   SceneEntryPtr entry;
+   if (request.type == REQUEST_INLINE)
+      entry = cache->insert(request.scene);
+   else
+      entry = cache->find(request.sceneId);
+
+   response.results.clear();
+   if (!entry)
+   {
+      response.status  = STATUS_UNKNOWN_SCENE;
+      response.sceneId = request.sceneId;
+      return;
+   }
+   response.status  = STATUS_OK;
+   response.sceneId = entry->id;
+   response.results.resize(request.starts.size());
+
+   Manager* manager = checkOut(entry.get());
+   manager->setSmoothing(request.flags & FLAG_SMOOTH);
+   for (int i = 0; i < request.starts.size(); i++)
+   {
+      PlanResult& result = response.results[i];
+      result.cost = COST_INF;
+      const Position& start = request.starts[i];
+      const Position& goal  = request.goals[i];
+      // the manager complains on cout about blocked ends, skip those here
+      if (!manager->isFree(start) || !manager->isFree(goal))
+         continue;
+
+      manager->setRobot(start);
+      manager->setDest(goal);
+      manager->replan();
+      result.cost = manager->getPathCost();
+      if (result.cost == COST_INF)
+         continue;
+      result.points = (request.flags & FLAG_SMOOTH) ? manager->getSmoothedPath()
+                                                    : manager->getWaypoints();
+   }
+   checkIn(entry.get(), manager);
+}
+
+static void workerLoop()
+{
+   vector<char> out;
+   PlanRequest  request;
+   PlanResponse response;
+   for (;;)
+   {
+      Job job;
+      {
+         unique_lock<mutex> guard(queueLock);
+         queueReady.wait(guard, [] {return !jobs.empty();});
+         job.fd = jobs.front().fd;
+         job.payload.swap(jobs.front().payload);
+         jobs.pop_front();
+      }
+
+      if (!decodeRequest(job.payload, request))
+      {
+         response.status  = STATUS_BAD_REQUEST;
+         response.sceneId = 0;
+         response.results.clear();
+      }
+      else
+         plan(request, response);
+
+      encodeResponse(response, out);
+      bool open = writeFrame(job.fd, out);
+      {
+         lock_guard<mutex> guard(doneLock);
+         done.push_back(make_pair(job.fd, open));
+      }
+      char wake = 0;
+      while (write(wakePipe[1], &wake, 1) < 0 && errno == EINTR)
+         ;
+   }
+}
+
+// hand the connection's next whole frame to a worker, false if the
+// connection has to be closed
+static bool dispatch(int fd, Connection& connection)
+{
+   vector<char> payload;
+   int got = takeFrame(connection.buffer, payload);
+   if (got <= 0)
+      return got == 0;
+
+   connection.busy = true;
+   lock_guard<mutex> guard(queueLock);
+   jobs.push_back(Job());
+   jobs.back().fd = fd;
+   jobs.back().payload.swap(payload);
+   queueReady.notify_one();
+   return true;
+}
+
+// read what the client sent, false on hang up or error
+static bool receive(int fd, Connection& connection)
+{
+   char chunk[65536];
+   ssize_t n = recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+   if (n < 0)
+      return errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK;
+   if (n == 0)
+      return false;
+   connection.buffer.insert(connection.buffer.end(), chunk, chunk + n);
+   return dispatch(fd, connection);
+}
+
+static void stopService(int)
+{
+   unlink(socketPath.c_str());
+   _exit(0);
+}
+
+void printUsage()
+{
+   cout << "Usage: decompose_service (-s socket) (-t threads) (-c scenes)" << endl;
+   cout << "   Where" << endl;
+   cout << "         -s    Socket path (default /tmp/decompose.sock)" << endl;
+   cout << "         -t    Worker threads (default 0 = one per core)" << endl;
+   cout << "         -c    Decomposed scenes to keep cached (default 16)" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+   int threads = 0;
+   int scenes  = 16;
+
+   int c;
+   while((c = getopt (argc, argv, "s:t:c:")) != -1)
+   switch (c)
+   {
+      case 's':
+         socketPath = optarg;
+         break;
+      case 't':
+         threads = atoi(optarg);
+         break;
+      case 'c':
+         scenes = atoi(optarg);
+         break;
+      default:
+         printUsage();
+         exit(1);
+   }
+   if (threads <= 0)
+      threads = max(1u, thread::hardware_concurrency());
+   if (scenes < 1)
+      scenes = 1;
+
+   sockaddr_un addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.sun_family = AF_UNIX;
+   if (socketPath.size() >= sizeof(addr.sun_path))
+   {
+      cout << "ERROR: socket path too long" << endl;
+      return 1;
+   }
+   strcpy(addr.sun_path, socketPath.c_str());
+
+   int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+   unlink(socketPath.c_str());
+   if (listener < 0 || bind(listener, (sockaddr*) &addr, sizeof(addr)) < 0 ||
+       listen(listener, 64) < 0)
+   {
+      cout << "ERROR: cannot listen on " << socketPath << ": " << strerror(errno) << endl;
+      return 1;
+   }
+
+   signal(SIGPIPE, SIG_IGN);   // a client hanging up only ends its connection
+   signal(SIGINT, stopService);
+   signal(SIGTERM, stopService);
+
+   if (pipe(wakePipe) < 0)
+   {
+      cout << "ERROR: pipe: " << strerror(errno) << endl;
+      return 1;
+   }
+
+   cache = new SceneCache(scenes);
+   for (int i = 0; i < threads; i++)
+      thread(workerLoop).detach();
+
+   cout << "Listening on " << socketPath << " with " << threads
+        << " threads, caching " << scenes << " scenes" << endl;
+
+   // the listener, the wake pipe, then every connection not with a worker
+   map<int, Connection> clients;
+   vector<pollfd> polled;
+   for (;;)
+   {
+      polled.clear();
+      pollfd listen = {listener, POLLIN, 0};
+      pollfd wake   = {wakePipe[0], POLLIN, 0};
+      polled.push_back(listen);
+      polled.push_back(wake);
+      for (map<int, Connection>::iterator it = clients.begin(); it != clients.end(); it++)
+         if (!it->second.busy)
+         {
+            pollfd client = {it->first, POLLIN, 0};
+            polled.push_back(client);
+         }
+
+      if (poll(&polled[0], polled.size(), -1) < 0)
+      {
+         if (errno != EINTR)
+            cout << "ERROR: poll: " << strerror(errno) << endl;
+         continue;
+      }
+
+      // connections back from the workers, maybe with the next request
+      // already buffered
+      if (polled[1].revents & POLLIN)
+      {
+         char drain[256];
+         read(wakePipe[0], drain, sizeof(drain));
+         deque< pair<int,bool> > back;
+         {
+            lock_guard<mutex> guard(doneLock);
+            back.swap(done);
+         }
+         for (int i = 0; i < back.size(); i++)
+         {
+            int fd = back[i].first;
+            clients[fd].busy = false;
+            if (!back[i].second || !dispatch(fd, clients[fd]))
+            {
+               close(fd);
+               clients.erase(fd);
+            }
+         }
+      }
+
+      for (int i = 2; i < polled.size(); i++)
+      {
+         int fd = polled[i].fd;
+         if (polled[i].revents && !receive(fd, clients[fd]))
+         {
+            close(fd);
+            clients.erase(fd);
+         }
+      }
+
+      if (polled[0].revents & POLLIN)
+      {
+         int fd = accept(listener, 0, 0);
+         if (fd >= 0)
+            clients[fd] = Connection();
+         else if (errno != EINTR)
+            cout << "ERROR: accept: " << strerror(errno) << endl;
+      }
+   }
+}
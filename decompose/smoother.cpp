@@ -0,0 +1,126 @@
+
+#include "smoother.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+
+Smoother::Smoother()
+{
+}
+
+Smoother::~Smoother()
+{
+}
+
+void Smoother::setObstacles(const Obstacles& _obstacles)
+{
+   if (_obstacles == obstacles && obsL.size() == obstacles.size())
+      return;
+   obstacles = _obstacles;
+   seams.find(obstacles);
+
+   int n = obstacles.size();
+   obsL.resize(n);
+   obsR.resize(n);
+   obsT.resize(n);
+   obsB.resize(n);
+   for (int i = 0; i < n; i++)
+   {
+      obsL[i] = obstacles[i].L;
+      obsR[i] = obstacles[i].R;
+      obsT[i] = obstacles[i].T;
+      obsB[i] = obstacles[i].B;
+   }
+}
+
+// Slab test: the segment (x0,y0) + t (dx,dy), t in [0,1], is inside the
+// open box for t in (max(tL, tT), min(tR, tB)) and hits it if that
+// interval overlaps [0,1].  An axis the segment does not move along keeps
+// the whole range or nothing, depending on which side of the slab it is.
+// Which axes move is a template parameter so the loop stays branch free.
+template <bool MovesX, bool MovesY>
+static int countHits(const double* L, const double* R, const double* T, const double* B,
+                     int n, double x0, double y0, double ix, double iy)
+{
+   const double inf = numeric_limits<double>::infinity();
+
+   double hits = 0; // a double sum keeps the loop in one vector width
+   for (int i = 0; i < n; i++)
+   {
+      double tx1 = (L[i] - x0) * ix;
+      double tx2 = (R[i] - x0) * ix;
+      double ty1 = (T[i] - y0) * iy;
+      double ty2 = (B[i] - y0) * iy;
+      bool   inX = (L[i] < x0) & (x0 < R[i]);
+      bool   inY = (T[i] < y0) & (y0 < B[i]);
+
+      double xlo = MovesX ? min(tx1, tx2) : (inX ? -inf :  inf);
+      double xhi = MovesX ? max(tx1, tx2) : (inX ?  inf : -inf);
+      double ylo = MovesY ? min(ty1, ty2) : (inY ? -inf :  inf);
+      double yhi = MovesY ? max(ty1, ty2) : (inY ?  inf : -inf);
+
+      double lo = max(max(xlo, ylo), 0.0);
+      double hi = min(min(xhi, yhi), 1.0);
+      hits += lo < hi ? 1.0 : 0.0;
+   }
+   return (int) hits;
+}
+
+bool Smoother::segmentFree(const Position& a, const Position& b) const
+{
+   const double x0 = a.X, y0 = a.Y;
+   const double dx = (double) b.X - a.X;
+   const double dy = (double) b.Y - a.Y;
+   const double ix = dx != 0 ? 1.0 / dx : 0;
+   const double iy = dy != 0 ? 1.0 / dy : 0;
+   const int    n  = obsL.size();
+   if (n == 0)
+      return true;
+
+   // a point: free unless all four squares around it are covered, which
+   // also catches a point on a seam
+   if (dx == 0 && dy == 0)
+      return !( Seams::covered(obstacles, a, -1, -1) && Seams::covered(obstacles, a, 1, -1) &&
+                Seams::covered(obstacles, a, -1,  1) && Seams::covered(obstacles, a, 1,  1) );
+
+   int hits;
+   if (dx != 0 && dy != 0)
+      hits = countHits<true,  true >(&obsL[0], &obsR[0], &obsT[0], &obsB[0], n, x0, y0, ix, iy);
+   else if (dx != 0)
+      hits = countHits<true,  false>(&obsL[0], &obsR[0], &obsT[0], &obsB[0], n, x0, y0, ix, iy);
+   else
+      hits = countHits<false, true >(&obsL[0], &obsR[0], &obsT[0], &obsB[0], n, x0, y0, ix, iy);
+   return hits == 0 && seams.segmentFree(a, b);
+}
+
+// From each kept waypoint, keep the furthest later one the straight
+// segment reaches, even past waypoints it cannot
+void Smoother::smooth(const Waypoints& in, Waypoints& out) const
+{
+   out.clear();
+   if (in.empty())
+      return;
+
+   int i = 0;
+   out.push_back(in[0]);
+   while (i < (int) in.size() - 1)
+   {
+      int j = in.size() - 1;
+      while (j > i + 1 && !segmentFree(in[i], in[j]))
+         j--;
+      out.push_back(in[j]);
+      i = j;
+   }
+}
+
+double Smoother::length(const Waypoints& path)
+{
+   double total = 0;
+   for (int i = 1; i < path.size(); i++)
+      total += hypot((double) path[i].X - path[i-1].X, (double) path[i].Y - path[i-1].Y);
+   return total;
+}
@@ -0,0 +1,51 @@
+
+#ifndef SMOOTHER_H_
+#define SMOOTHER_H_
+
+#include "consts.h"
+#include "cspace.h"
+
+#include <vector>
+
+typedef std::vector<Position> Waypoints;
+
+/*
+ * Greedy path shortcutting in configuration space.
+ *
+ * Starting from the robot, the smoother jumps to the furthest following
+ * waypoint it can reach in a straight line without entering an obstacle,
+ * and repeats from there.  Obstacles are the inflated c-space rectangles,
+ * so a collision free segment keeps the whole robot clear of the boxes.
+ *
+ * The segment test is a slab test against every obstacle at once: the
+ * bounds are kept as separate L / R / T / B arrays and the loop has no
+ * branches, so the compiler turns it into SIMD code.  The rectangles are
+ * open, so the seams and pinches where they touch are checked on top
+ * (see Seams).
+ */
+class Smoother
+{
+public:
+   Smoother();
+   ~Smoother();
+
+   void  setObstacles(const Obstacles& obstacles);
+
+   // true if the segment misses the interior of the obstacle union
+   // (running along its outer sides is allowed)
+   bool  segmentFree(const Position& a, const Position& b) const;
+
+   void  smooth(const Waypoints& in, Waypoints& out) const;
+
+   static double length(const Waypoints& path);
+
+private:
+   std::vector<double> obsL;
+   std::vector<double> obsR;
+   std::vector<double> obsT;
+   std::vector<double> obsB;
+   Obstacles         obstacles;
+   Seams             seams;
+};
+
+#endif
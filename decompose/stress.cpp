@@ -0,0 +1,412 @@
+
+/*
+   Differential stress test of the planner back-ends (no Qt, no GL)
+
+   Every back-end (decomposition x search, plus shortcutting) answers the
+   same start / goal queries on the same random scenes.  Costs must match
+   wherever the back-ends promise the same optimum, every path must be
+   valid, and the timings are tabulated per back-end.
+ */
+
+#include "consts.h"
+#include "manager.h"
+#include "scene.h"
+#include "smoother.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+
+static double now()
+{
+   return chrono::duration<double>(
+          chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Backend {
+   const char*             name;
+   Manager::Decomposition  decomp;
+   Manager::Search         search;
+   bool                    smooth;
+   int                     sameCostAs;  // back-end with the same optimum, -1 if none
+   bool                    shortest;    // truly shortest, complete like the exact grid
+};
+
+// the first back-end is the exact reference for reachability
+static const Backend BACKENDS[] = {
+   {"grid/dijkstra",      Manager::DECOMP_GRID,       Manager::SEARCH_DIJKSTRA,       false, -1, false},
+   {"grid/delta-step",    Manager::DECOMP_GRID,       Manager::SEARCH_DELTA_STEPPING, false,  0, false},
+   {"grid/smoothed",      Manager::DECOMP_GRID,       Manager::SEARCH_DIJKSTRA,       true,   0, false},
+   {"quadtree/dijkstra",  Manager::DECOMP_QUADTREE,   Manager::SEARCH_DIJKSTRA,       false, -1, false},
+   {"quadtree/delta-step",Manager::DECOMP_QUADTREE,   Manager::SEARCH_DELTA_STEPPING, false,  3, false},
+   {"quadtree/smoothed",  Manager::DECOMP_QUADTREE,   Manager::SEARCH_DIJKSTRA,       true,   3, false},
+   {"roadmap",            Manager::DECOMP_PRM,        Manager::SEARCH_DIJKSTRA,       false, -1, false},
+   {"visibility",         Manager::DECOMP_VISIBILITY, Manager::SEARCH_DIJKSTRA,       false, -1, true},
+};
+static const int NUM_BACKENDS = sizeof(BACKENDS) / sizeof(BACKENDS[0]);
+
+static bool hasCells(const Backend& backend)
+{
+   return backend.decomp == Manager::DECOMP_GRID || backend.decomp == Manager::DECOMP_QUADTREE;
+}
+
+// One query's answer
+struct Answer {
+   bool      found;
+   Cost      cost;
+   double    length;   // of the returned polyline
+   int       points;
+};
+
+struct Timings {
+   vector<double> build;   // decomposition + first query, per scene
+   vector<double> query;   // replan on warm cells, per query
+   double    lengthRatio;  // sum of path length / reference path length
+   int       compared;
+   int       found;
+   Timings() : lengthRatio(0), compared(0), found(0) {};
+};
+
+void printUsage()
+{
+   cout << "Usage: decompose_stress (-w world_size) (-b boxes) (-n scenes) (-q queries) (-s seed) (-t threads)" << endl;
+   cout << "   Where" << endl;
+   cout << "         -w    World width and height (default 100000)" << endl;
+   cout << "         -b    Boxes per scene (default 100)" << endl;
+   cout << "         -n    Number of random scenes (default 20)" << endl;
+   cout << "         -q    Start / goal queries per scene (default 20)" << endl;
+   cout << "         -s    Random seed (default 1)" << endl;
+   cout << "         -t    Delta-stepping threads (default 0 = one per core)" << endl;
+}
+
+// Cell paths: consecutive cells valid, collision free and sharing part of
+// a side, the cost the sum of the edge weights
+static string checkCells(Manager* manager)
+{
+   const Path& path = manager->getPath();
+   Cost sum = 0;
+   for (int i = 0; i < path.size(); i++)
+   {
+      if (!path[i].isValid || manager->isCollision(path[i].pos) != -1)
+         return "cell in collision";
+      if (i == 0)
+         continue;
+
+      const Cell& a = path[i-1];
+      const Cell& b = path[i];
+      bool sideBySide = (a.R == b.L || b.R == a.L) && min(a.B, b.B) > max(a.T, b.T);
+      bool stacked    = (a.B == b.T || b.B == a.T) && min(a.R, b.R) > max(a.L, b.L);
+      if (!sideBySide && !stacked)
+         return "cells not adjacent";
+      sum += Manager::distance(a.pos, b.pos);
+   }
+   if (sum != manager->getPathCost())
+      return "cost is not the sum of the edges";
+   return "";
+}
+
+// Inside the union of the inflated obstacles: the four points just
+// around (x, y) are covered, so a seam between two of them counts while an
+// outer side does not
+static bool inObstacles(const Obstacles& obstacles, double x, double y)
+{
+   const double e = 1.0 / 1024;
+   for (int q = 0; q < 4; q++)
+   {
+      double qx = q & 1 ? x + e : x - e;
+      double qy = q & 2 ? y + e : y - e;
+      bool covered = false;
+      for (int j = 0; j < obstacles.size() && !covered; j++)
+         covered = obstacles[j].L <= qx && qx <= obstacles[j].R &&
+                   obstacles[j].T <= qy && qy <= obstacles[j].B;
+      if (!covered)
+         return false;
+   }
+   return true;
+}
+
+// Polylines: from robot to dest, no waypoint inside a box, and points
+// sampled along each segment outside the inflated obstacles' union
+static string checkPolyline(Manager* manager, const Waypoints& points)
+{
+   Position robot = manager->getRobot();
+   Position dest  = manager->getDest();
+   if (points.size() < 2 ||
+       points.front().X != robot.X || points.front().Y != robot.Y ||
+       points.back().X  != dest.X  || points.back().Y  != dest.Y)
+      return "does not join robot and dest";
+
+   const Obstacles& obstacles = manager->getObstacles();
+   for (int i = 0; i < points.size(); i++)
+   {
+      if (manager->isCollision(points[i]) != -1)
+         return "waypoint in collision";
+      if (i == 0)
+         continue;
+      for (int s = 0; s <= 64; s++)
+      {
+         double x = points[i-1].X + (points[i].X - points[i-1].X) * s / 64.0;
+         double y = points[i-1].Y + (points[i].Y - points[i-1].Y) * s / 64.0;
+         if (inObstacles(obstacles, x, y))
+            return "segment in collision";
+      }
+   }
+   return "";
+}
+
+static Answer answer(Manager* manager, const Backend& backend, string& error)
+{
+   Answer result;
+   result.cost   = manager->getPathCost();
+   result.found  = result.cost != COST_INF;
+   result.length = 0;
+   result.points = 0;
+   error = "";
+   if (!result.found)
+      return result;
+
+   Waypoints points = backend.smooth ? manager->getSmoothedPath()
+                                     : manager->getWaypoints();
+   result.length = Smoother::length(points);
+   result.points = points.size();
+   if (hasCells(backend))
+      error = checkCells(manager);
+   if (error.empty())
+      error = checkPolyline(manager, points);
+   return result;
+}
+
+// Two boxes whose c-space rectangles share a side at x = 175: a segment
+// along it runs through the obstacle union, and no planner may take it
+static int checkSeams()
+{
+   Position start(175, 100), goal(175, 400);
+   int failures = 0;
+   Cost shortest = COST_INF;
+   for (int b = NUM_BACKENDS - 1; b >= 0; b--)
+   {
+      Manager manager(1000, 1000);
+      manager.addBox(Box(Position(200, 200), 50));
+      manager.addBox(Box(Position(230, 260), 50));
+      manager.setRobotRadius(5);
+      manager.setDecomposition(BACKENDS[b].decomp);
+      manager.setSearch(BACKENDS[b].search);
+      manager.setRobot(start);
+      manager.setDest(goal);
+
+      if (b == NUM_BACKENDS - 1)
+      {
+         Smoother checker;
+         checker.setObstacles(manager.getObstacles());
+         if (checker.segmentFree(start, goal))
+         {
+            cout << "   FAIL seam: segment along the seam is free" << endl;
+            failures++;
+         }
+      }
+
+      // the visibility graph (last) is truly shortest, the rest may only
+      // be longer
+      manager.generatePath();
+      Cost cost = manager.getPathCost();
+      if (BACKENDS[b].shortest)
+         shortest = cost;
+      if (cost == COST_INF || cost < shortest)
+      {
+         cout << "   FAIL seam: " << BACKENDS[b].name << " cost " << cost
+              << ", the shortest is " << shortest << endl;
+         failures++;
+      }
+   }
+   return failures;
+}
+
+static double percentile(vector<double> values, double p)
+{
+   if (values.empty())
+      return 0;
+   sort(values.begin(), values.end());
+   return values[min((int) values.size() - 1, (int) (p * values.size()))];
+}
+
+int main(int argc, char* argv[])
+{
+   int world   = 100000;
+   int boxes   = 100;
+   int scenes  = 20;
+   int queries = 20;
+   unsigned int seed = 1;
+   int threads = 0;
+
+   int c = 0;
+   while((c = getopt (argc, argv, "w:b:n:q:s:t:")) != -1)
+   switch(c)
+   {
+      case 'w':
+         world = atoi(optarg);
+         break;
+      case 'b':
+         boxes = atoi(optarg);
+         break;
+      case 'n':
+         scenes = atoi(optarg);
+         break;
+      case 'q':
+         queries = max(1, atoi(optarg));
+         break;
+      case 's':
+         seed = atoi(optarg);
+         break;
+      case 't':
+         threads = atoi(optarg);
+         break;
+      default:
+         printUsage();
+         exit(1);
+   }
+
+   // one Manager per back-end, so each keeps its cells between queries
+   vector<Manager*> managers(NUM_BACKENDS);
+   vector<Timings>  timings(NUM_BACKENDS);
+   for (int b = 0; b < NUM_BACKENDS; b++)
+   {
+      managers[b] = new Manager(world, world);
+      managers[b]->setThreads(threads);
+      managers[b]->setDecomposition(BACKENDS[b].decomp);
+      managers[b]->setSearch(BACKENDS[b].search);
+      managers[b]->setSmoothing(BACKENDS[b].smooth);
+   }
+
+   cout << "Comparing " << NUM_BACKENDS << " back-ends on " << scenes << " scenes x "
+        << queries << " queries, " << boxes << " boxes, " << world << "x" << world << endl;
+
+   int failures = checkSeams();
+   int checked  = 0;
+   for (int s = 0; s < scenes; s++)
+   {
+      Scene scene = generateScene(world, world, boxes, seed + s);
+      vector<Position> starts, goals;
+      generateRobots(scene, queries, seed * 31 + s, starts, goals);
+      vector<vector<Answer> > answers(NUM_BACKENDS, vector<Answer>(queries));
+
+      for (int b = 0; b < NUM_BACKENDS; b++)
+      {
+         Manager* manager = managers[b];
+         loadScene(manager, scene);
+         manager->setRobot(starts[0]);
+         manager->setDest(goals[0]);
+         manager->clearCells();   // do not time freeing the last scene's cells
+
+         for (int q = 0; q < queries; q++)
+         {
+            double start = now();
+            if (q == 0)
+               manager->generatePath();
+            else
+            {
+               manager->setRobot(starts[q]);
+               manager->setDest(goals[q]);
+               manager->replan();
+            }
+            double elapsed = now() - start;
+            if (q == 0)
+               timings[b].build.push_back(elapsed);
+            else
+               timings[b].query.push_back(elapsed);
+
+            string error;
+            answers[b][q] = answer(manager, BACKENDS[b], error);
+            checked++;
+            if (!error.empty())
+            {
+               cout << "   FAIL " << BACKENDS[b].name << " scene " << s
+                    << " query " << q << ": " << error << endl;
+               failures++;
+            }
+         }
+      }
+
+      // compare every back-end with the others on each query
+      for (int q = 0; q < queries; q++)
+      {
+         const Answer& exact = answers[0][q];
+         for (int b = 0; b < NUM_BACKENDS; b++)
+         {
+            const Answer& got = answers[b][q];
+            const Backend& backend = BACKENDS[b];
+            ostringstream error;
+
+            // the other decompositions only lose free space, never add it
+            if (got.found && !exact.found)
+               error << "path where the exact grid has none";
+
+            // no cell path is shorter than the visibility graph's path, up
+            // to the edge weights' rounding to 1 / COST_SCALE
+            double slack = (double) got.points / COST_SCALE;
+            if (backend.shortest && got.found != exact.found)
+               error << (got.found ? "path" : "no path") << " but the exact grid "
+                     << (exact.found ? "has one" : "has none");
+            for (int other = 0; backend.shortest && got.found && other < NUM_BACKENDS; other++)
+               if (hasCells(BACKENDS[other]) && !BACKENDS[other].smooth &&
+                   answers[other][q].found &&
+                   answers[other][q].length < got.length - slack)
+               {
+                  error << BACKENDS[other].name << " is shorter";
+                  break;
+               }
+
+            if (backend.sameCostAs >= 0)
+            {
+               const Answer& same = answers[backend.sameCostAs][q];
+               if (got.found != same.found || got.cost != same.cost)
+                  error << "cost " << got.cost << " but "
+                        << BACKENDS[backend.sameCostAs].name << " has " << same.cost;
+               // shortcutting never makes the polyline longer
+               if (backend.smooth && got.found && got.length > same.length + 1e-6)
+                  error << "smoothed path longer than the unsmoothed one";
+            }
+
+            if (!error.str().empty())
+            {
+               cout << "   FAIL " << backend.name << " scene " << s
+                    << " query " << q << ": " << error.str() << endl;
+               failures++;
+            }
+            if (got.found)
+               timings[b].found++;
+            if (got.found && exact.found && exact.length > 0)
+            {
+               timings[b].lengthRatio += got.length / exact.length;
+               timings[b].compared++;
+            }
+         }
+      }
+   }
+
+   cout << "   " << checked << " answers checked, " << failures << " failures" << endl;
+
+   cout << endl << "Times in ms, path length relative to the exact grid's cell path" << endl;
+   printf("%-20s %10s %10s %10s %10s %10s %8s %8s\n", "back-end", "build p50",
+          "query p50", "query p90", "query p99", "query max", "found", "length");
+   for (int b = 0; b < NUM_BACKENDS; b++)
+   {
+      const Timings& t = timings[b];
+      printf("%-20s %10.3f %10.3f %10.3f %10.3f %10.3f %8d %8.3f\n", BACKENDS[b].name,
+             percentile(t.build, 0.5) * 1000, percentile(t.query, 0.5) * 1000,
+             percentile(t.query, 0.9) * 1000, percentile(t.query, 0.99) * 1000,
+             percentile(t.query, 1.0) * 1000, t.found,
+             t.compared ? t.lengthRatio / t.compared : 0.0);
+   }
+
+   for (int b = 0; b < NUM_BACKENDS; b++)
+      delete managers[b];
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,106 @@
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+ThreadPool::ThreadPool(int threads)
+: numThreads(threads),
+job(NULL),
+generation(0),
+running(0),
+stopping(false)
+{
+   if (numThreads <= 0)
+      numThreads = max(1u, thread::hardware_concurrency());
+
+   // the caller is worker 0
+   for (int i = 1; i < numThreads; i++)
+      workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      unique_lock<mutex> guard(lock);
+      stopping = true;
+   }
+   wake.notify_all();
+   for (int i = 0; i < workers.size(); i++)
+      workers[i].join();
+}
+
+void ThreadPool::workerLoop(int worker)
+{
+   unsigned long seen = 0;
+   while (true)
+   {
+      const function<void(int)>* current;
+      {
+         unique_lock<mutex> guard(lock);
+         while (!stopping && generation == seen)
+            wake.wait(guard);
+         if (stopping)
+            return;
+         seen    = generation;
+         current = job;
+      }
+
+      (*current)(worker);
+
+      {
+         unique_lock<mutex> guard(lock);
+         if (--running == 0)
+            finished.notify_one();
+      }
+   }
+}
+
+void ThreadPool::run(const function<void(int)>& _job)
+{
+   if (numThreads == 1)
+   {
+      _job(0);
+      return;
+   }
+
+   {
+      unique_lock<mutex> guard(lock);
+      job     = &_job;
+      running = numThreads - 1;
+      generation++;
+   }
+   wake.notify_all();
+
+   _job(0);
+
+   unique_lock<mutex> guard(lock);
+   while (running > 0)
+      finished.wait(guard);
+}
+
+void ThreadPool::parallelFor(int n, int grain,
+                             const function<void(int, int, int)>& body)
+{
+   grain = max(1, grain);
+   if (n <= grain || numThreads == 1)
+   {
+      if (n > 0)
+         body(0, n, 0);
+      return;
+   }
+
+   atomic<int> next(0);
+   function<void(int)> job = [&](int worker) {
+      while (true)
+      {
+         int begin = next.fetch_add(grain);
+         if (begin >= n)
+            break;
+         body(begin, min(n, begin + grain), worker);
+      }
+   };
+   run(job);
+}
@@ -0,0 +1,50 @@
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads for fork-join loops.
+ *
+ * run() hands the same job to every thread (the caller takes part as
+ * worker 0) and returns once all of them are done, so the threads are
+ * created once and reused by every phase of a search.
+ */
+class ThreadPool
+{
+public:
+   // threads <= 0 uses one per hardware thread
+   ThreadPool(int threads = 0);
+   ~ThreadPool();
+
+   int   size() const {return numThreads;}
+
+   void  run(const std::function<void(int)>& job);
+
+   // body(begin, end, worker) over [0, n) in chunks of about grain items,
+   // handed out dynamically so uneven chunks balance out
+   void  parallelFor(int n, int grain,
+                     const std::function<void(int, int, int)>& body);
+
+private:
+   int                        numThreads;
+   std::vector<std::thread>   workers;
+
+   std::mutex                 lock;
+   std::condition_variable    wake;
+   std::condition_variable    finished;
+   const std::function<void(int)>* job;
+   unsigned long              generation; // bumped for every run()
+   int                        running;    // workers still busy with a job
+   bool                       stopping;
+
+   void  workerLoop(int worker);
+};
+
+#endif
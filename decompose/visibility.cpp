@@ -0,0 +1,406 @@
+
+#include "visibility.h"
+#include "manager.h"
+#include "search.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <set>
+
+using namespace std;
+
+
+// corners swept per parallel chunk
+const int VISIBILITY_GRAIN = 16;
+
+// a non-negative fraction, compared exactly
+struct Fraction {
+   long long num;
+   long long den;   // > 0
+   Fraction(long long _num = 0, long long _den = 1) : num(_num), den(_den) {};
+   bool operator<(const Fraction& other) const {return num * other.den < other.num * den;}
+};
+
+// narrow (lo, hi) to the part of p + t*d, t in (lo, hi), strictly between
+// min and max; false if the line never is
+static bool clip(long long p, long long d, long long min, long long max,
+                 Fraction& lo, Fraction& hi)
+{
+   if (d == 0)
+      return min < p && p < max;
+   Fraction enter = d > 0 ? Fraction(min - p, d) : Fraction(p - max, -d);
+   Fraction leave = d > 0 ? Fraction(max - p, d) : Fraction(p - min, -d);
+   if (lo < enter)
+      lo = enter;
+   if (leave < hi)
+      hi = leave;
+   return true;
+}
+
+// true if the open segment ab enters the open rectangle
+static bool crossesInterior(const Obstacle& o, const Position& a, const Position& b)
+{
+   Fraction lo(0, 1), hi(1, 1);
+   if ( !clip(a.X, (long long) b.X - a.X, o.L, o.R, lo, hi) ||
+        !clip(a.Y, (long long) b.Y - a.Y, o.T, o.B, lo, hi) )
+      return false;
+   return lo < hi;
+}
+
+// angular order of directions, starting at +x
+static int half(long long x, long long y)
+{
+   return (y > 0 || (y == 0 && x > 0)) ? 0 : 1;
+}
+
+static bool angleLess(long long ax, long long ay, long long bx, long long by)
+{
+   int ha = half(ax, ay);
+   int hb = half(bx, by);
+   if (ha != hb)
+      return ha < hb;
+   return ax * by - ay * bx > 0;
+}
+
+enum SweepEventType {
+   SWEEP_REMOVE = 0,   // the ray leaves an obstacle
+   SWEEP_QUERY,        // the ray reaches a target
+   SWEEP_INSERT        // the ray enters an obstacle
+};
+
+struct SweepEvent {
+   long long x, y;     // direction from the sweep center
+   int       type;
+   int       id;       // obstacle or target
+   long long dist;     // squared, targets only
+
+   bool operator<(const SweepEvent& other) const
+   {
+      if (angleLess(x, y, other.x, other.y))
+         return true;
+      if (angleLess(other.x, other.y, x, y))
+         return false;
+      if (type != other.type)
+         return type < other.type;
+      return dist < other.dist;
+   }
+};
+
+/*
+ * Orders the obstacles on the sweep ray by distance.  Disjoint rectangles
+ * have a separating line, and every ray meeting both crosses it from the
+ * center's side, so the one on that side is nearer for the whole time
+ * both are on the ray.  (If the center is on the line no ray meets both.)
+ */
+struct NearerObstacle {
+   const Obstacles* obstacles;
+   Position         from;
+
+   NearerObstacle(const Obstacles* _obstacles, const Position& _from)
+   : obstacles(_obstacles), from(_from) {};
+
+   bool operator()(int a, int b) const
+   {
+      const Obstacle& A = (*obstacles)[a];
+      const Obstacle& B = (*obstacles)[b];
+      if (A.R <= B.L)
+         return from.X <= A.R;
+      if (B.R <= A.L)
+         return from.X > B.R;
+      if (A.B <= B.T)
+         return from.Y <= A.B;
+      if (B.B <= A.T)
+         return from.Y > B.B;
+      return a < b;  // overlapping, the merged c-space has none
+   }
+};
+
+VisibilityGraph::VisibilityGraph()
+: width(-1),
+height(-1),
+built(false)
+{
+}
+
+VisibilityGraph::~VisibilityGraph()
+{
+   clear();
+}
+
+void VisibilityGraph::clear()
+{
+   for (int i = 0; i < nodes.size(); i++)
+      delete nodes[i];
+   nodes.clear();
+   corners.clear();
+   seams.clear();
+   built = false;
+}
+
+int VisibilityGraph::numEdges() const
+{
+   int edges = 0;
+   for (int i = 0; i < nodes.size(); i++)
+      edges += nodes[i]->edges.size();
+   return edges / 2;
+}
+
+void VisibilityGraph::update(const Obstacles& _obstacles, int _width, int _height, ThreadPool* pool)
+{
+   if (built && _width == width && _height == height && _obstacles == obstacles)
+      return;
+   build(_obstacles, _width, _height, pool);
+}
+
+void VisibilityGraph::build(const Obstacles& _obstacles, int _width, int _height, ThreadPool* pool)
+{
+   clear();
+   obstacles = _obstacles;
+   width  = _width;
+   height = _height;
+   built  = true;
+
+   findCorners();
+   seams.find(obstacles);
+
+   for (int i = 0; i < corners.size(); i++)
+   {
+      Node* node = new Node();
+      node->cell.pos = corners[i];
+      node->cell.L = node->cell.R = corners[i].X;
+      node->cell.T = node->cell.B = corners[i].Y;
+      node->cell.TL = corners[i];
+      node->cell.TR = corners[i];
+      node->cell.BL = corners[i];
+      node->cell.BR = corners[i];
+      node->cell.isValid = true;
+      node->visited = false;
+      node->spset = false;
+      node->dist = COST_INF;
+      node->index = nodes.size();
+      nodes.push_back(node);
+   }
+
+   // one sweep per corner, in parallel.  Each pair is kept by its lower
+   // index and linked both ways after.
+   int n = nodes.size();
+   vector< vector<int> > linked(n);
+   pool->parallelFor(n, VISIBILITY_GRAIN, [&](int begin, int end, int worker) {
+      vector<int> visible;
+      for (int i = begin; i < end; i++)
+      {
+         visibleFrom(corners[i], corners, visible);
+         for (int j = 0; j < visible.size(); j++)
+            if (visible[j] > i)
+               linked[i].push_back(visible[j]);
+      }
+   });
+
+   for (int i = 0; i < n; i++)
+      for (int j = 0; j < linked[i].size(); j++)
+         link(nodes[i], nodes[linked[i][j]]);
+}
+
+// Rectangle corners with exactly one covered quadrant are the convex
+// corners of the obstacles
+void VisibilityGraph::findCorners()
+{
+   vector<Position> all;
+   for (int i = 0; i < obstacles.size(); i++)
+   {
+      all.push_back(Position(obstacles[i].L, obstacles[i].T));
+      all.push_back(Position(obstacles[i].R, obstacles[i].T));
+      all.push_back(Position(obstacles[i].L, obstacles[i].B));
+      all.push_back(Position(obstacles[i].R, obstacles[i].B));
+   }
+   sort(all.begin(), all.end(), [](const Position& a, const Position& b) {
+      return a.X < b.X || (a.X == b.X && a.Y < b.Y);
+   });
+
+   for (int i = 0; i < all.size(); i++)
+   {
+      const Position& p = all[i];
+      if (i > 0 && p.X == all[i-1].X && p.Y == all[i-1].Y)
+         continue;
+      if (p.X < 0 || p.X > width || p.Y < 0 || p.Y > height)
+         continue;
+
+      int quadrants = Seams::covered(obstacles, p, -1, -1) + Seams::covered(obstacles, p, 1, -1) +
+                      Seams::covered(obstacles, p, -1,  1) + Seams::covered(obstacles, p, 1,  1);
+      if (quadrants == 1)
+         corners.push_back(p);
+   }
+}
+
+bool VisibilityGraph::isFree(const Position& pos) const
+{
+   if (pos.X < 0 || pos.X > width || pos.Y < 0 || pos.Y > height)
+      return false;
+   for (int i = 0; i < obstacles.size(); i++)
+      if ( obstacles[i].L < pos.X && pos.X < obstacles[i].R &&
+           obstacles[i].T < pos.Y && pos.Y < obstacles[i].B )
+         return false;
+   return true;
+}
+
+// Rotational sweep around from: obstacles enter the status when the ray
+// starts crossing their interior and leave when it stops, a target is
+// visible if the nearest obstacle on the ray does not cut it off
+void VisibilityGraph::visibleFrom(const Position& from, const vector<Position>& targets,
+                                  vector<int>& visible) const
+{
+   visible.clear();
+   vector<SweepEvent> events;
+   events.reserve(2 * obstacles.size() + targets.size());
+
+   NearerObstacle nearer(&obstacles, from);
+   set<int, NearerObstacle> status(nearer);
+   vector< set<int, NearerObstacle>::iterator > where(obstacles.size());
+   vector<char> active(obstacles.size(), 0);
+
+   for (int i = 0; i < obstacles.size(); i++)
+   {
+      const Obstacle& o = obstacles[i];
+      long long xs[4] = {o.L, o.R, o.R, o.L};
+      long long ys[4] = {o.T, o.T, o.B, o.B};
+
+      // the silhouette: the first and last corner counter-clockwise, the
+      // interior is crossed strictly between them
+      int first = -1, last = -1;
+      for (int c = 0; c < 4; c++)
+      {
+         long long x = xs[c] - from.X, y = ys[c] - from.Y;
+         if (x == 0 && y == 0)
+            continue;
+         bool isFirst = true, isLast = true;
+         for (int k = 0; k < 4; k++)
+         {
+            long long kx = xs[k] - from.X, ky = ys[k] - from.Y;
+            long long cross = x * ky - y * kx;
+            if (cross < 0)
+               isFirst = false;
+            if (cross > 0)
+               isLast = false;
+         }
+         if (isFirst && first < 0)
+            first = c;
+         if (isLast && last < 0)
+            last = c;
+      }
+      if (first < 0 || last < 0)
+         continue;   // from is inside, cannot happen for free points
+
+      SweepEvent enter = {xs[first] - from.X, ys[first] - from.Y, SWEEP_INSERT, i, 0};
+      SweepEvent leave = {xs[last]  - from.X, ys[last]  - from.Y, SWEEP_REMOVE, i, 0};
+      events.push_back(enter);
+      events.push_back(leave);
+
+      // already crossed by the starting ray (+x)
+      if (o.T < from.Y && from.Y < o.B && o.R > from.X)
+      {
+         where[i] = status.insert(i).first;
+         active[i] = 1;
+      }
+   }
+
+   for (int j = 0; j < targets.size(); j++)
+   {
+      long long x = (long long) targets[j].X - from.X;
+      long long y = (long long) targets[j].Y - from.Y;
+      if (x == 0 && y == 0)
+         continue;
+      SweepEvent target = {x, y, SWEEP_QUERY, j, x*x + y*y};
+      events.push_back(target);
+   }
+   sort(events.begin(), events.end());
+
+   for (int e = 0; e < events.size(); e++)
+   {
+      const SweepEvent& event = events[e];
+      if (event.type == SWEEP_REMOVE)
+      {
+         if (active[event.id])
+            status.erase(where[event.id]);
+         active[event.id] = 0;
+      }
+      else if (event.type == SWEEP_INSERT)
+      {
+         if (!active[event.id])
+            where[event.id] = status.insert(event.id).first;
+         active[event.id] = 1;
+      }
+      else
+      {
+         const Position& target = targets[event.id];
+         if (!status.empty() && crossesInterior(obstacles[*status.begin()], from, target))
+            continue;
+         if (seams.segmentFree(from, target))
+            visible.push_back(event.id);
+      }
+   }
+}
+
+void VisibilityGraph::link(Node* a, Node* b)
+{
+   Cost w = Manager::distance(a->cell.pos, b->cell.pos);
+   if (w == 0)   // coincident, see Roadmap::build()
+      return;
+   a->edges.push_back(Edge(a, b, w));
+   b->edges.push_back(Edge(b, a, w));
+}
+
+bool VisibilityGraph::query(const Position& start, const Position& goal, Path& path, Cost& cost)
+{
+   path.clear();
+   cost = COST_INF;
+   if (!built || !isFree(start) || !isFree(goal))
+      return false;
+   if (start.X == goal.X && start.Y == goal.Y)
+   {
+      cost = 0;
+      return true;
+   }
+
+   // link start and goal in as two extra nodes
+   int   n = nodes.size();
+   Node  src, dst;
+   Node* ends[2] = { &src, &dst };
+   Position at[2] = { start, goal };
+   for (int e = 0; e < 2; e++)
+   {
+      Node* node = ends[e];
+      node->cell.pos = at[e];
+      node->cell.L = node->cell.R = at[e].X;
+      node->cell.T = node->cell.B = at[e].Y;
+      node->cell.isValid = true;
+      node->index = n + e;
+   }
+
+   vector<Position> targets = corners;
+   targets.push_back(goal);
+   vector<int> visible;
+   visibleFrom(start, targets, visible);
+   for (int j = 0; j < visible.size(); j++)
+      link(&src, visible[j] == n ? &dst : nodes[visible[j]]);
+   visibleFrom(goal, corners, visible);
+   for (int j = 0; j < visible.size(); j++)
+      link(&dst, nodes[visible[j]]);
+   nodes.push_back(&src);
+   nodes.push_back(&dst);
+
+   dijkstraSearch(nodes, &src, &dst);
+   Path found;
+   bool ok = traceShortestPath(&src, &dst, found);
+   if (ok)
+   {
+      cost = dst.dist;
+      path.assign(found.begin() + 1, found.end() - 1);
+   }
+
+   // unlink them again, their edges were added last
+   nodes.resize(n);
+   for (int i = 0; i < n; i++)
+      while (!nodes[i]->edges.empty() && nodes[i]->edges.back().dest->index >= n)
+         nodes[i]->edges.pop_back();
+   return ok;
+}
@@ -0,0 +1,71 @@
+
+#ifndef VISIBILITY_H_
+#define VISIBILITY_H_
+
+#include "consts.h"
+#include "cspace.h"
+
+#include <vector>
+
+class ThreadPool;
+
+/*
+ * Visibility graph over the c-space obstacles, for sparse scenes of a few
+ * large boxes: the shortest path bends only at convex obstacle corners, so
+ * those corners are the only nodes and the paths are truly shortest.
+ *
+ * The edges of each corner come from a rotational plane sweep (Lee's
+ * algorithm): the other corners are visited in angular order while the
+ * obstacles crossed by the sweep ray are kept ordered by distance, so a
+ * corner is visible if it is closer than the nearest of them.  That is
+ * O(n log n) per corner and O(n^2 log n) in all, the corners are swept in
+ * parallel.
+ *
+ * Obstacles are open rectangles, paths may run along their sides.  The
+ * merged c-space rectangles of one blob share sides though, and a path
+ * must not run along such a seam or squeeze through a corner where two
+ * rectangles only touch diagonally; both are checked separately.
+ *
+ * The graph is kept until the obstacles change.  A query sweeps around the
+ * start and goal only, links them in and unlinks them again afterwards.
+ */
+class VisibilityGraph
+{
+public:
+   VisibilityGraph();
+   ~VisibilityGraph();
+
+   // rebuild if the obstacles or world changed since last time
+   void  update(const Obstacles& obstacles, int width, int height, ThreadPool* pool);
+   void  build(const Obstacles& obstacles, int width, int height, ThreadPool* pool);
+   void  clear();
+
+   // path of corners (as cells) from start to goal, the ends not included;
+   // returns false if either end is blocked or they are not connected
+   bool  query(const Position& start, const Position& goal, Path& path, Cost& cost);
+
+   // the targets visible from a point, in no particular order
+   void  visibleFrom(const Position& from, const std::vector<Position>& targets,
+                     std::vector<int>& visible) const;
+   bool  isFree(const Position& pos) const;
+
+   int   numNodes()     const {return nodes.size();}
+   int   numEdges()     const;
+   const Nodes& getNodes() const {return nodes;}
+
+private:
+   Obstacles         obstacles;
+   int               width;
+   int               height;
+   bool              built;
+
+   std::vector<Position> corners;   // position of nodes[i]
+   Nodes             nodes;
+
+   Seams             seams;
+
+   void  findCorners();
+   void  link(Node* a, Node* b);
+};
+
+#endif
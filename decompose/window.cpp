@@ -39,6 +39,8 @@ selection(0)
 
 Window::~Window()
 {
+   // the widget releases its GL buffers through the canvas
+   delete canvasWidget;
    delete canvas;
 }
 
@@ -119,6 +121,51 @@ void Window::keyPressEvent(QKeyEvent* event)
       selection = 4;
       titleSuffix += "Box 2";
    }
+   if (event->key() == Qt::Key_0)
+   {
+      // zoom back out to the whole map
+      canvasWidget->resetView();
+   }
+   if (event->key() == Qt::Key_L)
+   {
+      // auto -> never -> always aggregate cells
+      canvasWidget->cycleLODMode();
+   }
+   if (event->key() == Qt::Key_Q)
+   {
+      // exact grid -> adaptive quadtree -> sampled roadmap -> visibility graph
+      if (manager->getDecomposition() == Manager::DECOMP_GRID)
+      {
+         manager->setDecomposition(Manager::DECOMP_QUADTREE);
+         titleSuffix += "Quadtree";
+      }
+      else if (manager->getDecomposition() == Manager::DECOMP_QUADTREE)
+      {
+         manager->setDecomposition(Manager::DECOMP_PRM);
+         titleSuffix += "Roadmap";
+      }
+      else if (manager->getDecomposition() == Manager::DECOMP_PRM)
+      {
+         manager->setDecomposition(Manager::DECOMP_VISIBILITY);
+         titleSuffix += "Visibility";
+      }
+      else
+      {
+         manager->setDecomposition(Manager::DECOMP_GRID);
+         titleSuffix += "Grid";
+      }
+   }
+   if (event->key() == Qt::Key_S)
+   {
+      // shortcut the path through the cell centers, or go back to it
+      manager->setSmoothing(!manager->getSmoothing());
+      titleSuffix += manager->getSmoothing() ? "Smoothing On" : "Smoothing Off";
+   }
+   if (event->key() == Qt::Key_F)
+   {
+      // drive the robot along the last path again
+      manager->startFollowing();
+   }
    if (event->key() == Qt::Key_R)
    {
       // select robot marker for repositioning
@@ -156,31 +203,32 @@ void Window::mouseReleaseEvent(QMouseEvent* e)
 	manager->clearCells();
    manager->decompose();
    manager->connectCells();
+	Position pos = canvasWidget->toWorld(canvasWidget->mapFrom(this, e->pos()));
 	switch (selection)
 	{
 		case 0:		//Robot
 		{
-			manager->setRobot(Position(e->x(),e->y()));
+			manager->setRobot(pos);
 			break;
 		}
 		case 1:		//Destination
 		{
-			manager->setDest(Position(e->x(),e->y()));
+			manager->setDest(pos);
 			break;
 		}
 		case 2:		//Box 0
 		{
-			manager->setBox(0, Position(e->x(),e->y()));
+			manager->setBox(0, pos);
 			break;
 		}
 		case 3:		//Box 1
 		{
-			manager->setBox(1, Position(e->x(),e->y()));
+			manager->setBox(1, pos);
 			break;
 		}
 		case 4:		//Box 2
 		{
-			manager->setBox(2, Position(e->x(),e->y()));
+			manager->setBox(2, pos);
 			break;
 		}
 	}
@@ -0,0 +1,283 @@
+
+/*
+   Headless scaling benchmark of the vehicles step (no Qt, no GL)
+
+   Steps the same random swarm with 1, 2, 4 ... threads for each swarm
+   size, and checks every thread count ends in exactly the state of the
+   single threaded run.  Then compares light field resolutions and light
+   tree opening angles with the exact sum over the lights.
+ */
+
+#include "consts.h"
+#include "lightfield.h"
+#include "lighttree.h"
+#include "swarm.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+
+static double now()
+{
+   return chrono::duration<double>(
+          chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// splitmix64, the same cars for a seed on every platform
+static unsigned long long nextRandom(unsigned long long& state)
+{
+   unsigned long long z = (state += 0x9E3779B97F4A7C15ULL);
+   z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+   z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+   return z ^ (z >> 31);
+}
+
+static void makeSwarm(int cars, int lights, unsigned long long seed,
+                      Swarm& swarm, Lights& lightList)
+{
+   unsigned long long state = seed;
+   swarm.clear();
+   swarm.reserve(cars);
+   for (int i = 0; i < cars; i++)
+   {
+      Car car(Position(nextRandom(state) % WIDTH, nextRandom(state) % HEIGHT),
+              nextRandom(state) % 2);
+      car.setR(nextRandom(state) % 360);
+      swarm.addCar(car);
+   }
+   lightList.clear();
+   for (int j = 0; j < lights; j++)
+      lightList.push_back(Light(BUFFER + nextRandom(state) % (WIDTH - 2 * BUFFER),
+                                BUFFER + nextRandom(state) % (HEIGHT - 2 * BUFFER)));
+}
+
+// FNV-1a over the positions and headings
+static unsigned long long checksum(const Swarm& swarm)
+{
+   unsigned long long hash = 14695981039346656037ULL;
+   const float* arrays[] = {swarm.getX(), swarm.getY(), swarm.getHeading()};
+   for (int a = 0; a < 3; a++)
+   {
+      const unsigned char* bytes = (const unsigned char*) arrays[a];
+      for (size_t i = 0; i < swarm.size() * sizeof(float); i++)
+         hash = (hash ^ bytes[i]) * 1099511628211ULL;
+   }
+   return hash;
+}
+
+void printUsage()
+{
+   cout << "Usage: vehicles_bench (-c max_cars) (-l lights) (-t max_threads) (-k kernel) (-f cell_size) (-s seed)" << endl;
+   cout << "   Where" << endl;
+   cout << "         -c    Largest swarm, from 10^4 in steps of 10x (default 10000000)" << endl;
+   cout << "         -l    Number of lights (default 16)" << endl;
+   cout << "         -t    Most threads to time (default one per core)" << endl;
+   cout << "         -k    Step kernel: scalar, sse2, avx2 or auto (default auto)" << endl;
+   cout << "         -f    Light field cell size for the scaling runs (default 0 = exact)" << endl;
+   cout << "         -s    Random seed (default 1)" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+   int maxCars    = 10000000;
+   int lights     = 16;
+   int maxThreads = max(1u, thread::hardware_concurrency());
+   unsigned long long seed = 1;
+   Swarm::Kernel kernel = Swarm::KERNEL_AUTO;
+   float cellSize = 0;
+
+   int c = 0;
+   while((c = getopt (argc, argv, "c:l:t:k:f:s:")) != -1)
+   switch(c)
+   {
+      case 'c':
+         maxCars = atoi(optarg);
+         break;
+      case 'l':
+         lights = max(0, atoi(optarg));
+         break;
+      case 't':
+         maxThreads = max(1, atoi(optarg));
+         break;
+      case 'k':
+         if (string(optarg) == "scalar")
+            kernel = Swarm::KERNEL_SCALAR;
+         else if (string(optarg) == "sse2")
+            kernel = Swarm::KERNEL_SSE2;
+         else if (string(optarg) == "avx2")
+            kernel = Swarm::KERNEL_AVX2;
+         break;
+      case 'f':
+         cellSize = atof(optarg);
+         break;
+      case 's':
+         seed = atoll(optarg);
+         break;
+      default:
+         printUsage();
+         exit(1);
+   }
+
+   vector<int> threadCounts;
+   for (int t = 1; t < maxThreads; t *= 2)
+      threadCounts.push_back(t);
+   threadCounts.push_back(maxThreads);
+
+   Swarm start;
+   start.setKernel(kernel);
+   cout << "Vehicles step, " << lights << " lights, " << Swarm::kernelName(start.getKernel())
+        << " kernel, " << thread::hardware_concurrency() << " hardware threads";
+   if (cellSize > 0)
+      cout << ", light field of " << cellSize << " px cells";
+   cout << endl;
+   printf("%10s %8s %8s %12s %14s %8s %10s %6s\n", "cars", "threads", "steps",
+          "step (ms)", "car-steps/s", "speedup", "steals", "same");
+
+   int failures = 0;
+   for (long long cars = 10000; cars <= maxCars; cars *= 10)
+   {
+      Lights lightList;
+      makeSwarm(cars, lights, seed, start, lightList);
+      // about 10^8 car-light pairs per timing, at least 3 steps
+      int steps = max(3LL, 100000000LL / (cars * max(1, lights)));
+
+      double single = 0;
+      unsigned long long expected = 0;
+      for (int i = 0; i < threadCounts.size(); i++)
+      {
+         ThreadPool pool(threadCounts[i]);
+         LightField field;
+         if (cellSize > 0)
+            field.build(lightList, cellSize, &pool);
+         Swarm swarm = start;
+         swarm.step(lightList, &pool, &field);   // warm up the threads and caches
+
+         double begin = now();
+         for (int s = 1; s < steps; s++)
+            swarm.step(lightList, &pool, &field);
+         double elapsed = (now() - begin) / (steps - 1);
+
+         unsigned long long hash = checksum(swarm);
+         if (i == 0)
+         {
+            single   = elapsed;
+            expected = hash;
+         }
+         bool same = hash == expected;
+         if (!same)
+            failures++;
+         printf("%10lld %8d %8d %12.3f %14.0f %8.2f %10lld %6s\n", cars, threadCounts[i],
+                steps, elapsed * 1000, cars / elapsed, single / elapsed,
+                pool.numSteals(), same ? "yes" : "NO");
+      }
+   }
+
+   // Light field resolutions: build once, then every step is a lookup
+   // per sensor whatever the number of lights
+   {
+      int cars = min(maxCars, 1000000);
+      Lights lightList;
+      makeSwarm(cars, lights, seed, start, lightList);
+      ThreadPool pool(maxThreads);
+      int steps = 5;
+
+      Swarm swarm = start;
+      double begin = now();
+      for (int s = 0; s < steps; s++)
+         swarm.step(lightList, &pool);
+      double exactStep = (now() - begin) / steps;
+
+      cout << endl << "Light field against the exact sum, " << cars << " cars, "
+           << lights << " lights, exact step " << exactStep * 1000 << " ms" << endl;
+      printf("%8s %10s %12s %12s %8s %10s %10s %10s %10s\n", "cell", "nodes",
+             "build (ms)", "step (ms)", "speedup", "sum mean", "sum max",
+             "turn mean", "turn max");
+      const float cells[] = {0.5f, 1, 2, 4, 8, 16};
+      for (int i = 0; i < sizeof(cells) / sizeof(cells[0]); i++)
+      {
+         LightField field;
+         begin = now();
+         field.build(lightList, cells[i], &pool);
+         double build = now() - begin;
+
+         swarm = start;
+         begin = now();
+         for (int s = 0; s < steps; s++)
+            swarm.step(lightList, &pool, &field);
+         double step = (now() - begin) / steps;
+
+         // turn error in degrees, 4 per unit of intensity difference
+         double meanSum, maxSum, meanTurn, maxTurn;
+         field.error(lightList, 100000, meanSum, maxSum, meanTurn, maxTurn);
+         printf("%8.1f %10d %12.2f %12.3f %8.2f %10.4f %10.3f %10.4f %10.3f\n", cells[i],
+                field.getCols() * field.getRows(), build * 1000, step * 1000,
+                exactStep / step, meanSum, maxSum, meanTurn * 4, maxTurn * 4);
+      }
+      cout << "   errors over 100000 random cars: intensity sum at a sensor, and the" << endl
+           << "   turn it makes in degrees" << endl;
+   }
+
+   // Light tree: thousands of moving lights, so the tree is rebuilt every
+   // step and its build is part of the step time
+   {
+      int cars = min(maxCars, 100000);
+      cout << endl << "Light tree against the exact sum, " << cars
+           << " cars, rebuilt every step" << endl;
+      printf("%8s %8s %8s %12s %12s %8s %10s %10s %10s %10s\n", "lights", "theta",
+             "nodes", "build (ms)", "step (ms)", "speedup", "sum mean", "sum max",
+             "turn mean", "turn max");
+      ThreadPool pool(maxThreads);
+      for (int numLights = 1000; numLights <= 16000; numLights *= 4)
+      {
+         Lights lightList;
+         makeSwarm(cars, numLights, seed, start, lightList);
+
+         Swarm swarm = start;
+         double begin = now();
+         swarm.step(lightList, &pool);
+         double exactStep = now() - begin;
+         printf("%8d %8s %8s %12s %12.3f %8s\n", numLights, "exact", "-", "-",
+                exactStep * 1000, "1.00");
+
+         const float thetas[] = {0.25f, 0.5f, 0.75f, 1.0f};
+         for (int i = 0; i < sizeof(thetas) / sizeof(thetas[0]); i++)
+         {
+            LightTree tree;
+            tree.setTheta(thetas[i]);
+            swarm = start;
+            int steps = 3;
+            double build = 0;
+            begin = now();
+            for (int s = 0; s < steps; s++)
+            {
+               double buildStart = now();
+               tree.build(lightList);
+               build += now() - buildStart;
+               swarm.step(lightList, &pool, NULL, &tree);
+            }
+            double step = (now() - begin) / steps;
+
+            double meanSum, maxSum, meanTurn, maxTurn;
+            tree.error(lightList, 2000, meanSum, maxSum, meanTurn, maxTurn);
+            printf("%8d %8.2f %8d %12.3f %12.3f %8.2f %10.4f %10.3f %10.4f %10.3f\n",
+                   numLights, thetas[i], tree.numNodes(), build / steps * 1000,
+                   step * 1000, exactStep / step, meanSum, maxSum, meanTurn * 4, maxTurn * 4);
+         }
+      }
+      cout << "   errors over 2000 random cars, as for the light field" << endl;
+   }
+
+   if (failures)
+      cout << "ERROR: " << failures << " thread counts changed the result" << endl;
+   return failures ? 1 : 0;
+}
@@ -1,17 +1,8 @@
-
 #include "canvas.h"
 #include "consts.h"
+#include "swarmkernel.h"
 
-#ifdef __APPLE__
-#include <GLUT/glut.h>
-#include <OpenGL/gl.h>
-#elif __linux__
-#include <GL/glut.h>
-#include <GL/gl.h>
-#else
-#include <gl/glut.h>
-#include <gl/gl.h>
-#endif
+#include <QOpenGLShaderProgram>
 
 #include <math.h>
 #include <stdio.h>
@@ -22,135 +13,308 @@
 
 using namespace std;
 
-   Canvas::Canvas(Manager* _man) 
-:manager(_man)
+
+static const char* SCENE_VERT_SRC =
+   "#version 330 core\n"
+   "layout(location = 0) in vec2 vertPos;\n"
+   "layout(location = 1) in vec3 vertColor;\n"
+   "uniform mat4 mvp;\n"
+   "out vec3 fragColor;\n"
+   "void main() {\n"
+   "   gl_Position = mvp * vec4(vertPos, 0.0, 1.0);\n"
+   "   fragColor   = vertColor;\n"
+   "}\n";
+
+// the mesh is in the car's frame, the instance places and turns it, and
+// colors the body red for direct mapping and blue for inverse
+static const char* CAR_VERT_SRC =
+   "#version 330 core\n"
+   "layout(location = 0) in vec2  meshPos;\n"
+   "layout(location = 1) in float meshPart;\n"
+   "layout(location = 2) in float instX;\n"
+   "layout(location = 3) in float instY;\n"
+   "layout(location = 4) in float instHeading;\n"
+   "layout(location = 5) in float instSign;\n"
+   "uniform mat4 mvp;\n"
+   "out vec3 fragColor;\n"
+   "void main() {\n"
+   "   float c = cos(instHeading);\n"
+   "   float s = sin(instHeading);\n"
+   "   vec2 pos = vec2(instX + c * meshPos.x - s * meshPos.y,\n"
+   "                   instY + s * meshPos.x + c * meshPos.y);\n"
+   "   gl_Position = mvp * vec4(pos, 0.0, 1.0);\n"
+   "   if (meshPart > 0.5)\n"
+   "      fragColor = vec3(0.0, 0.0, 0.0);\n"
+   "   else if (instSign > 0.0)\n"
+   "      fragColor = vec3(1.0, 0.0, 0.0);\n"
+   "   else\n"
+   "      fragColor = vec3(0.0, 0.0, 1.0);\n"
+   "}\n";
+
+static const char* COLOR_FRAG_SRC =
+   "#version 330 core\n"
+   "in vec3 fragColor;\n"
+   "out vec4 outColor;\n"
+   "void main() {\n"
+   "   outColor = vec4(fragColor, 1.0);\n"
+   "}\n";
+
+// one round point sprite per light
+static const char* LIGHT_VERT_SRC =
+   "#version 330 core\n"
+   "layout(location = 0) in vec2 instPos;\n"
+   "uniform mat4  mvp;\n"
+   "uniform float pointSize;\n"
+   "void main() {\n"
+   "   gl_Position  = mvp * vec4(instPos, 0.0, 1.0);\n"
+   "   gl_PointSize = pointSize;\n"
+   "}\n";
+
+static const char* LIGHT_FRAG_SRC =
+   "#version 330 core\n"
+   "out vec4 outColor;\n"
+   "void main() {\n"
+   "   vec2 c = gl_PointCoord * 2.0 - 1.0;\n"
+   "   if (dot(c, c) > 1.0)\n"
+   "      discard;\n"
+   "   outColor = vec4(1.0, 1.0, 0.0, 1.0);\n"
+   "}\n";
+
+// per-instance attributes, each a float array in the instance buffer
+const int CAR_ATTRIBS = 4;   // x, y, heading, sign
+
+
+   Canvas::Canvas(Simulation* _simulation)
+:simulation(_simulation),
+gl(NULL),
+sceneProgram(NULL),
+carProgram(NULL),
+lightProgram(NULL),
+pixelScale(1.0f),
+sceneVAO(0),
+sceneVBO(0),
+sceneVertices(0),
+carVAO(0),
+carMeshVBO(0),
+carInstanceVBO(0),
+carVertices(0),
+carCapacity(0),
+lightVAO(0),
+lightVBO(0)
 {
 }
 
 Canvas::~Canvas()
 {
+   delete sceneProgram;
+   delete carProgram;
+   delete lightProgram;
 }
 
-void Canvas::init ( void )
+static QOpenGLShaderProgram* makeProgram(const char* vert, const char* frag, const char* name)
 {
-   glMatrixMode(GL_PROJECTION);
-   glLoadIdentity();
-   glOrtho(0.0, WIDTH-1, HEIGHT-1, 0, -1.0, 1.0);
-   glMatrixMode(GL_MODELVIEW);
+   QOpenGLShaderProgram* program = new QOpenGLShaderProgram();
+   program->addShaderFromSourceCode(QOpenGLShader::Vertex,   vert);
+   program->addShaderFromSourceCode(QOpenGLShader::Fragment, frag);
+   if (!program->link())
+      cout << "ERROR: " << name << " shader: " << program->log().toStdString() << endl;
+   return program;
 }
 
-//TODO: Possible: change wheels and sensors to scale with car size
-//TODO: update wheel positions
-void Canvas::drawCars()
+// two triangles
+static void addQuad(vector<CarVertex>& mesh, float x0, float y0, float x1, float y1, float part)
 {
-	for (int i=0; i<manager->getCars().size(); i++)
-	{
-		Car car = manager->getCar(i);
-		//Car car = Car(Position(100,100),true);
-		int X = car.getX();
-		int Y = car.getY();
-		double R = car.getR_rad();
-		Position s1 = car.getSensorPos(1);
-		Position s2 = car.getSensorPos(2);
-		
-		// Change color based on if car is inverted
-		if (car.getDirect())
-		{
-			glColor3f(1,0,0);		// Red
-		}
-		else
-		{
-			glColor3f(0,0,1);		// Blue
-		}
-		
-		// Draw car body
-		glBegin(GL_QUADS);
-			glVertex2f(X + (-CAR_LENGTH*cos(R) - -CAR_WIDTH*sin(R)), Y + (-CAR_LENGTH*sin(R) + -CAR_WIDTH*cos(R)) );
-			glVertex2f(X + (-CAR_LENGTH*cos(R) -  CAR_WIDTH*sin(R)), Y + (-CAR_LENGTH*sin(R) +  CAR_WIDTH*cos(R)) );
-			glVertex2f(X + ( CAR_LENGTH*cos(R) -  CAR_WIDTH*sin(R)), Y + ( CAR_LENGTH*sin(R) +  CAR_WIDTH*cos(R)) );
-			glVertex2f(X + ( CAR_LENGTH*cos(R) - -CAR_WIDTH*sin(R)), Y + ( CAR_LENGTH*sin(R) + -CAR_WIDTH*cos(R)) );
-		glEnd();
-		
-		/*// Draw wheels	
-		glColor3f(0,0,0);
-		glBegin(GL_QUADS);
-			// Left Tire
-			glVertex2f((X-CAR_WIDTH) + (-4*cos(R) - -2*sin(R)), (Y+(CAR_LENGTH/2)+2) + (-4*sin(R) + -2*cos(R)) );
-			glVertex2f((X-CAR_WIDTH) + (-4*cos(R) -  2*sin(R)), (Y+(CAR_LENGTH/2)+2) + (-4*sin(R) +  2*cos(R)) );
-			glVertex2f((X-CAR_WIDTH) + ( 4*cos(R) -  2*sin(R)), (Y+(CAR_LENGTH/2)+2) + ( 4*sin(R) +  2*cos(R)) );
-			glVertex2f((X-CAR_WIDTH) + ( 4*cos(R) - -2*sin(R)), (Y+(CAR_LENGTH/2)+2) + ( 4*sin(R) + -2*cos(R)) );
-			// Right Tire
-			glVertex2f((X+CAR_WIDTH) + (-4*cos(R) - -2*sin(R)), (Y+(CAR_LENGTH/2)+2) + (-4*sin(R) + -2*cos(R)) );
-			glVertex2f((X+CAR_WIDTH) + (-4*cos(R) -  2*sin(R)), (Y+(CAR_LENGTH/2)+2) + (-4*sin(R) +  2*cos(R)) );
-			glVertex2f((X+CAR_WIDTH) + ( 4*cos(R) -  2*sin(R)), (Y+(CAR_LENGTH/2)+2) + ( 4*sin(R) +  2*cos(R)) );
-			glVertex2f((X+CAR_WIDTH) + ( 4*cos(R) - -2*sin(R)), (Y+(CAR_LENGTH/2)+2) + ( 4*sin(R) + -2*cos(R)) );
-		glEnd();
-		//*/
-		// Draw sensors
-		glColor3f(0,0,0);
-		glBegin(GL_QUADS);
-			// Left Sensor
-			glVertex2f(s1.X + (-2*cos(R) - -2*sin(R)), s1.Y + (-2*sin(R) + -2*cos(R)) );
-			glVertex2f(s1.X + (-2*cos(R) -  2*sin(R)), s1.Y + (-2*sin(R) +  2*cos(R)) );
-			glVertex2f(s1.X + ( 2*cos(R) -  2*sin(R)), s1.Y + ( 2*sin(R) +  2*cos(R)) );
-			glVertex2f(s1.X + ( 2*cos(R) - -2*sin(R)), s1.Y + ( 2*sin(R) + -2*cos(R)) );
-			// Right Sensor
-			glVertex2f(s2.X + (-2*cos(R) - -2*sin(R)), s2.Y + (-2*sin(R) + -2*cos(R)) );
-			glVertex2f(s2.X + (-2*cos(R) -  2*sin(R)), s2.Y + (-2*sin(R) +  2*cos(R)) );
-			glVertex2f(s2.X + ( 2*cos(R) -  2*sin(R)), s2.Y + ( 2*sin(R) +  2*cos(R)) );
-			glVertex2f(s2.X + ( 2*cos(R) - -2*sin(R)), s2.Y + ( 2*sin(R) + -2*cos(R)) );
-		glEnd();
-	}
-	glFlush();
+   mesh.push_back(CarVertex(x0, y0, part));
+   mesh.push_back(CarVertex(x1, y0, part));
+   mesh.push_back(CarVertex(x1, y1, part));
+   mesh.push_back(CarVertex(x0, y0, part));
+   mesh.push_back(CarVertex(x1, y1, part));
+   mesh.push_back(CarVertex(x0, y1, part));
 }
 
-void Canvas::drawLights()
+static void addQuad(vector<CanvasVertex>& scene, float x0, float y0, float x1, float y1,
+                    float r, float g, float b)
 {
-	for (int i=0; i<manager->getLights().size(); i++)
-	{
-		Light light = manager->getLight(i);
-		//Light light = Light(50,50);
-		int X = light.X;
-		int Y = light.Y;
-		
-		glColor3f(1,1,0);
-		glBegin(GL_TRIANGLE_FAN);
-			glVertex2f(X,Y);
-			// create points around the mouse point
-			for(int j=0; j<=360; j++)
-			{
-				// using the unit circle
-				glVertex2f(X + sin(j)*LIGHT_RADIUS, Y + cos(j)*LIGHT_RADIUS);
-			}
-		glEnd();
-	}
-	glFlush();
+   scene.push_back(CanvasVertex(x0, y0, r, g, b));
+   scene.push_back(CanvasVertex(x1, y0, r, g, b));
+   scene.push_back(CanvasVertex(x1, y1, r, g, b));
+   scene.push_back(CanvasVertex(x0, y0, r, g, b));
+   scene.push_back(CanvasVertex(x1, y1, r, g, b));
+   scene.push_back(CanvasVertex(x0, y1, r, g, b));
 }
 
-void Canvas::display ( void )
+void Canvas::init(QOpenGLFunctions_3_3_Core* _gl)
+{
+   gl = _gl;
+   sceneProgram = makeProgram(SCENE_VERT_SRC, COLOR_FRAG_SRC, "scene");
+   carProgram   = makeProgram(CAR_VERT_SRC,   COLOR_FRAG_SRC, "car");
+   lightProgram = makeProgram(LIGHT_VERT_SRC, LIGHT_FRAG_SRC, "light");
+
+   // greyish canvas inside an orange border 3 pixels wide
+   vector<CanvasVertex> scene;
+   addQuad(scene, 10, 10, WIDTH-10, HEIGHT-10, .7, .7, .7);
+   addQuad(scene, 8.5, 8.5, WIDTH-8.5, 11.5, 1.0, 0.25, 0.0);
+   addQuad(scene, 8.5, HEIGHT-11.5, WIDTH-8.5, HEIGHT-8.5, 1.0, 0.25, 0.0);
+   addQuad(scene, 8.5, 8.5, 11.5, HEIGHT-8.5, 1.0, 0.25, 0.0);
+   addQuad(scene, WIDTH-11.5, 8.5, WIDTH-8.5, HEIGHT-8.5, 1.0, 0.25, 0.0);
+   sceneVertices = scene.size();
+
+   gl->glGenVertexArrays(1, &sceneVAO);
+   gl->glGenBuffers(1, &sceneVBO);
+   gl->glBindVertexArray(sceneVAO);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, sceneVBO);
+   gl->glBufferData(GL_ARRAY_BUFFER, scene.size() * sizeof(CanvasVertex), scene.data(), GL_STATIC_DRAW);
+   gl->glEnableVertexAttribArray(0);
+   gl->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(CanvasVertex), (void*) 0);
+   gl->glEnableVertexAttribArray(1);
+   gl->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(CanvasVertex), (void*) (2*sizeof(GLfloat)));
+
+   // body, then the sensors on top, where the Swarm puts them: behind the
+   // heading (the cars drive that way) and to either side
+   vector<CarVertex> mesh;
+   addQuad(mesh, -CAR_LENGTH, -CAR_WIDTH, CAR_LENGTH, CAR_WIDTH, 0);
+   float sensorX = -SWARM_SENSOR_DIST * SWARM_SENSOR_COS;
+   float sensorY =  SWARM_SENSOR_DIST * SWARM_SENSOR_SIN;
+   addQuad(mesh, sensorX - 2, -sensorY - 2, sensorX + 2, -sensorY + 2, 1);
+   addQuad(mesh, sensorX - 2,  sensorY - 2, sensorX + 2,  sensorY + 2, 1);
+   carVertices = mesh.size();
+
+   gl->glGenVertexArrays(1, &carVAO);
+   gl->glGenBuffers(1, &carMeshVBO);
+   gl->glGenBuffers(1, &carInstanceVBO);
+   gl->glBindVertexArray(carVAO);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, carMeshVBO);
+   gl->glBufferData(GL_ARRAY_BUFFER, mesh.size() * sizeof(CarVertex), mesh.data(), GL_STATIC_DRAW);
+   gl->glEnableVertexAttribArray(0);
+   gl->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(CarVertex), (void*) 0);
+   gl->glEnableVertexAttribArray(1);
+   gl->glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(CarVertex), (void*) (2*sizeof(GLfloat)));
+   // the instance attributes are pointed at once the buffer has a size
+   for (int a = 0; a < CAR_ATTRIBS; a++)
+   {
+      gl->glEnableVertexAttribArray(2 + a);
+      gl->glVertexAttribDivisor(2 + a, 1);
+   }
+   carCapacity = 0;
+
+   gl->glGenVertexArrays(1, &lightVAO);
+   gl->glGenBuffers(1, &lightVBO);
+   gl->glBindVertexArray(lightVAO);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
+   gl->glEnableVertexAttribArray(0);
+   gl->glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*) 0);
+   gl->glVertexAttribDivisor(0, 1);
+
+   gl->glBindVertexArray(0);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+   gl->glEnable(GL_PROGRAM_POINT_SIZE);
+   gl->glClearColor(0, 0, 0, 1);
+
+   projection.setToIdentity();
+   projection.ortho(0, WIDTH, HEIGHT, 0, -1.0, 1.0);
+}
+
+void Canvas::cleanup()
 {
-   glClear ( GL_COLOR_BUFFER_BIT );
-
-   // set greyish canvas
-   glColor3f (.7,.7,.7);
-   glBegin (GL_POLYGON);
-   glVertex2f (10, 10);
-   glVertex2f (10, HEIGHT-10);
-   glVertex2f (WIDTH-10, HEIGHT-10);
-   glVertex2f (WIDTH-10, 10);
-   glEnd();
-   glColor3f(1.0,0.25,0.0);
-
-   glLineWidth(3.0);
-   glBegin (GL_LINE_LOOP);
-   glVertex2f (10, 10);
-   glVertex2f (10, HEIGHT-10);
-   glVertex2f (WIDTH-10, HEIGHT-10);
-   glVertex2f (WIDTH-10, 10);
-   glEnd();
-
-   drawCars();
-	drawLights();
+   if (!gl)
+      return;
 
+   gl->glDeleteVertexArrays(1, &sceneVAO);
+   gl->glDeleteBuffers(1, &sceneVBO);
+   gl->glDeleteVertexArrays(1, &carVAO);
+   gl->glDeleteBuffers(1, &carMeshVBO);
+   gl->glDeleteBuffers(1, &carInstanceVBO);
+   gl->glDeleteVertexArrays(1, &lightVAO);
+   gl->glDeleteBuffers(1, &lightVBO);
+   delete sceneProgram;
+   delete carProgram;
+   delete lightProgram;
+   sceneProgram = carProgram = lightProgram = NULL;
+   carCapacity = 0;
+   gl = NULL;
 }
 
+void Canvas::resize(int width, int height)
+{
+   if (height == 0)
+      height = 1;
+
+   gl->glViewport(0, 0, width, height);
+   pixelScale = (float) width / WIDTH;
+}
+
+// The snapshot's arrays go into consecutive ranges of the instance
+// buffer, no interleaving on the CPU
+void Canvas::drawCars(const Snapshot& snapshot)
+{
+   size_t n = snapshot.numCars();
+   if (n == 0)
+      return;
+
+   gl->glBindVertexArray(carVAO);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, carInstanceVBO);
+   GLsizeiptr range = carCapacity * sizeof(GLfloat);
+   if (n > carCapacity)
+   {
+      carCapacity = n + n / 2;
+      range = carCapacity * sizeof(GLfloat);
+      for (int a = 0; a < CAR_ATTRIBS; a++)
+         gl->glVertexAttribPointer(2 + a, 1, GL_FLOAT, GL_FALSE, sizeof(GLfloat),
+                                   (void*) (a * range));
+   }
+   // orphan last frame's storage rather than wait for the GPU to be done
+   // with it
+   gl->glBufferData(GL_ARRAY_BUFFER, CAR_ATTRIBS * range, NULL, GL_STREAM_DRAW);
+   const float* arrays[CAR_ATTRIBS] = {snapshot.x.data(), snapshot.y.data(),
+                                       snapshot.heading.data(), snapshot.sign.data()};
+   for (int a = 0; a < CAR_ATTRIBS; a++)
+      gl->glBufferSubData(GL_ARRAY_BUFFER, a * range, n * sizeof(GLfloat), arrays[a]);
+
+   carProgram->bind();
+   carProgram->setUniformValue("mvp", projection);
+   gl->glDrawArraysInstanced(GL_TRIANGLES, 0, carVertices, n);
+   carProgram->release();
+}
+
+void Canvas::drawLights(const Snapshot& snapshot)
+{
+   int n = snapshot.lights.size();
+   if (n == 0)
+      return;
+
+   lightData.resize(2 * n);
+   for (int i = 0; i < n; i++)
+   {
+      lightData[2*i]   = snapshot.lights[i].X;
+      lightData[2*i+1] = snapshot.lights[i].Y;
+   }
+   gl->glBindVertexArray(lightVAO);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
+   gl->glBufferData(GL_ARRAY_BUFFER, lightData.size() * sizeof(GLfloat), lightData.data(), GL_STREAM_DRAW);
+
+   lightProgram->bind();
+   lightProgram->setUniformValue("mvp", projection);
+   lightProgram->setUniformValue("pointSize", 2 * LIGHT_RADIUS * pixelScale);
+   gl->glDrawArraysInstanced(GL_POINTS, 0, 1, n);
+   lightProgram->release();
+}
+
+void Canvas::display ( void )
+{
+   gl->glClear(GL_COLOR_BUFFER_BIT);
+
+   sceneProgram->bind();
+   sceneProgram->setUniformValue("mvp", projection);
+   gl->glBindVertexArray(sceneVAO);
+   gl->glDrawArrays(GL_TRIANGLES, 0, sceneVertices);
+   sceneProgram->release();
+
+   // one snapshot for the whole frame
+   const Snapshot& snapshot = simulation->latest();
+   drawCars(snapshot);
+	drawLights(snapshot);
+
+   gl->glBindVertexArray(0);
+   gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
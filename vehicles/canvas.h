@@ -2,47 +2,82 @@
 #ifndef CANVAS_H_
 #define CANVAS_H_
 
-#include "manager.h"
+#include "simulation.h"
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QMatrix4x4>
 #include <vector>
 
-class RobotArm;
+class QOpenGLShaderProgram;
 
-/*
-struct PaintSpot
-{
-   int X;
-   int Y;
-   int size; // radius
-
-   PaintSpot(int _x, int _y, int _s) : X(_x), Y(_y), size(_s) {}
-   bool operator==(const PaintSpot& other)
-   {
-      if( X == other.X &&
-          Y == other.Y )
-         return true; 
-      return false; 
-   }
+// A colored vertex of the static background
+struct CanvasVertex {
+   GLfloat x, y;
+   GLfloat r, g, b;
+   CanvasVertex(GLfloat _x = 0, GLfloat _y = 0,
+                GLfloat _r = 0, GLfloat _g = 0, GLfloat _b = 0)
+   : x(_x), y(_y), r(_r), g(_g), b(_b) {};
 };
-//*/
 
+// A vertex of the car mesh, in the car's frame (x forward of the heading)
+struct CarVertex {
+   GLfloat x, y;
+   GLfloat part;     // 0 body, 1 sensor
+   CarVertex(GLfloat _x = 0, GLfloat _y = 0, GLfloat _part = 0)
+   : x(_x), y(_y), part(_part) {};
+};
+
+/*
+ * Instanced renderer for the vehicles.
+ *
+ * The car mesh (body and both sensors) is one small static buffer and
+ * every car is an instance of it: each frame the snapshot's x, y, heading
+ * and sign arrays go as they are into consecutive ranges of a single
+ * per-instance buffer, and the vertex shader turns and places the mesh
+ * and picks the color.  Lights are instanced round point sprites.  So a
+ * frame is one upload and three draw calls whatever the number of cars.
+ *
+ * Needs a 3.3 core context, which Mesa's llvmpipe provides on machines
+ * without a GPU.
+ */
 class Canvas
 {
 public:
-
-   Canvas(Manager* _man);
+   Canvas(Simulation* _simulation);
    ~Canvas();
 
-   void init();
+   // GL must be current for all of these
+   void init(QOpenGLFunctions_3_3_Core* _gl);
+   void cleanup();
 	void display();
-	void drawCars();
-	void drawLights();
+   void resize(int width, int height);
 
 private:
-   Manager* manager;
-   //bool painting;
-   //int brushSize;
-   //std::vector<PaintSpot> paintspots;
+   Simulation* simulation;   // draws its latest snapshot, never waits for it
+   QOpenGLFunctions_3_3_Core* gl;
+
+   QOpenGLShaderProgram* sceneProgram;
+   QOpenGLShaderProgram* carProgram;
+   QOpenGLShaderProgram* lightProgram;
+   QMatrix4x4           projection;
+   float                pixelScale; // device pixels per world unit
+
+   GLuint   sceneVAO;
+   GLuint   sceneVBO;
+   int      sceneVertices;
+
+   GLuint   carVAO;
+   GLuint   carMeshVBO;
+   GLuint   carInstanceVBO;
+   int      carVertices;
+   size_t   carCapacity;   // cars the instance buffer has room for
+
+   GLuint   lightVAO;
+   GLuint   lightVBO;
+   std::vector<GLfloat> lightData;   // x, y per light, kept between frames
+
+	void drawCars(const Snapshot& snapshot);
+	void drawLights(const Snapshot& snapshot);
 };
 
 #endif
-
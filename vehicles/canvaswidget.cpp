@@ -3,6 +3,9 @@
 #include "consts.h"
 #include "canvas.h"
 
+#include <QSurfaceFormat>
+#include <QOpenGLContext>
+
 #include <iostream>
 #include <cmath>
 
@@ -10,15 +13,24 @@ using namespace std;
 
 
 CanvasWidget::CanvasWidget(Canvas* _canvas, QWidget* _parent)
-: QGLWidget(QGLFormat(QGL::SampleBuffers), _parent),
+: QOpenGLWidget(_parent),
 canvas(_canvas)
 {
+   // instancing needs a 3.3 core context (Mesa's llvmpipe provides one
+   // when there is no GPU)
+   QSurfaceFormat format;
+   format.setVersion(3, 3);
+   format.setProfile(QSurfaceFormat::CoreProfile);
+   format.setSamples(4);
+   setFormat(format);
+
    setFixedSize(WIDTH, HEIGHT);
    setAutoFillBackground(false);
 }
 
 CanvasWidget::~CanvasWidget()
 {
+   cleanup();
 }
 
 QSize CanvasWidget::sizeHint() const
@@ -84,33 +96,33 @@ void CanvasWidget::updateLightPos(int lightID, int newX, int newY)
 
 void CanvasWidget::animate()
 {
-   repaint();
+   update();
 }
 
-void CanvasWidget::paintEvent(QPaintEvent *event)
+// release the GL resources while the context is still alive
+void CanvasWidget::cleanup()
 {
-   QPainter painter;
-   painter.begin(this);
-   painter.setRenderHint(QPainter::Antialiasing);
-   canvas->display();
-   painter.end();
+   makeCurrent();
+   canvas->cleanup();
+   doneCurrent();
 }
 
 void CanvasWidget::initializeGL()
 {
-   glEnable(GL_DEPTH_TEST);
-   glEnable(GL_CULL_FACE);
+   initializeOpenGLFunctions();
+   connect(context(), SIGNAL(aboutToBeDestroyed()), this, SLOT(cleanup()));
 
-   qglClearColor(QColor(Qt::black));
+   canvas->init(this);
+}
 
-   canvas->init();
+void CanvasWidget::paintGL()
+{
+   canvas->display();
 }
 
 void CanvasWidget::resizeGL(int width, int height)
 {
-   if (height == 0)
-      height = 1;
-
-   glViewport(0, 0, width, height);
+   int ratio = devicePixelRatio();
+   canvas->resize(width * ratio, height * ratio);
 }
 
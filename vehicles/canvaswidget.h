@@ -4,15 +4,13 @@
 
 #include "consts.h"
 #include "car.h"
-#include <QGLWidget>
-#include <QMatrix>
-#include <QVector>
-#include <QGLShaderProgram>
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_3_3_Core>
 
 
 class Canvas;
 
-class CanvasWidget : public QGLWidget
+class CanvasWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
 {
    Q_OBJECT
 
@@ -40,6 +38,7 @@ signals:
 
 public slots:
    void animate();
+   void cleanup();
    
 	//TODO: Delete. cause moved to manager
 	/*
@@ -52,8 +51,8 @@ public slots:
 	//*/
 
 protected:
-   void paintEvent(QPaintEvent *event);
    void initializeGL();
+   void paintGL();
    void resizeGL(int width, int height);
 
 private:
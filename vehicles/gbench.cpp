@@ -0,0 +1,198 @@
+
+/*
+   Google Benchmark suite of the vehicles core (no Qt, no GL)
+
+   Per-operation costs to track from commit to commit: the time step
+   against cars and lights, the sensor positions, and spawning and
+   deleting in bulk.  For machine-readable results run with
+   --benchmark_format=json, or --benchmark_out=file.json to keep the
+   console table too.
+ */
+
+#include "consts.h"
+#include "car.h"
+#include "manager.h"
+#include "swarm.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+
+// cars placed as the GUI places them, the same for a seed
+static Cars makeCars(int numCars, unsigned int seed = 1)
+{
+   srand(seed);
+   Cars cars;
+   cars.reserve(numCars);
+   for (int i = 0; i < numCars; i++)
+   {
+      int x = rand() % (WIDTH-BUFFER*2) + BUFFER;
+      int y = rand() % (HEIGHT-BUFFER*2) + BUFFER;
+      Car car(Position(x, y), (bool) (rand() % 2));
+      car.setR(rand() % 360);
+      cars.push_back(car);
+   }
+   return cars;
+}
+
+// and lights
+static void populate(Manager& manager, int numCars, int numLights, unsigned int seed = 1)
+{
+   manager.addCars(makeCars(numCars, seed));
+   for (int i = 0; i < numLights; i++)
+   {
+      int x = rand() % (WIDTH-BUFFER*2) + BUFFER;
+      int y = rand() % (HEIGHT-BUFFER*2) + BUFFER;
+      manager.addNewLight(Light(x, y));
+   }
+}
+
+// Manager::timeStep() against the number of cars, 8 lights, one thread
+static void BM_TimeStepCars(benchmark::State& state)
+{
+   Manager manager;
+   manager.setThreads(1);
+   populate(manager, state.range(0), 8);
+   for (auto _ : state)
+      manager.timeStep();
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TimeStepCars)->RangeMultiplier(10)->Range(100, 1000000)
+   ->Unit(benchmark::kMicrosecond);
+
+// Manager::timeStep() against the number of lights, 10000 cars, one thread
+static void BM_TimeStepLights(benchmark::State& state)
+{
+   Manager manager;
+   manager.setThreads(1);
+   populate(manager, 10000, state.range(0));
+   for (auto _ : state)
+      manager.timeStep();
+   state.SetItemsProcessed(state.iterations() * 10000 * state.range(0));
+   state.SetLabel("items = car-light pairs");
+}
+BENCHMARK(BM_TimeStepLights)->RangeMultiplier(4)->Range(1, 1024)
+   ->Unit(benchmark::kMicrosecond);
+
+// Manager::timeStep() on every core, 100000 cars and 8 lights
+static void BM_TimeStepThreads(benchmark::State& state)
+{
+   Manager manager;
+   manager.setThreads(state.range(0));
+   populate(manager, 100000, 8);
+   for (auto _ : state)
+      manager.timeStep();
+   state.SetItemsProcessed(state.iterations() * 100000);
+}
+BENCHMARK(BM_TimeStepThreads)->Arg(1)->Arg(2)->Arg(4)->Arg(0)
+   ->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+// Car::calcSensorPos() over a batch of cars, the Car model's own version
+static void BM_CarCalcSensorPos(benchmark::State& state)
+{
+   vector<Car> cars;
+   srand(1);
+   for (int i = 0; i < state.range(0); i++)
+   {
+      Car car(Position(rand() % WIDTH, rand() % HEIGHT));
+      car.setR(rand() % 360);
+      cars.push_back(car);
+   }
+   for (auto _ : state)
+   {
+      for (int i = 0; i < cars.size(); i++)
+         cars[i].calcSensorPos();
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CarCalcSensorPos)->Arg(1000)->Arg(100000);
+
+// the same through Swarm::setCarPos(), which recomputes the car's sensors
+static void BM_SwarmCalcSensorPos(benchmark::State& state)
+{
+   Manager manager;
+   populate(manager, state.range(0), 0);
+   Swarm swarm = manager.getSwarm();
+   for (auto _ : state)
+   {
+      for (int i = 0; i < swarm.size(); i++)
+         swarm.setCarPos(i, swarm.getX()[i], swarm.getY()[i]);
+      benchmark::ClobberMemory();
+   }
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SwarmCalcSensorPos)->Arg(1000)->Arg(100000);
+
+// Manager::addNewCar() of n cars into an empty manager
+static void BM_SpawnCars(benchmark::State& state)
+{
+   Cars cars = makeCars(state.range(0));
+   for (auto _ : state)
+   {
+      Manager manager;
+      for (int i = 0; i < cars.size(); i++)
+         manager.addNewCar(cars[i]);
+      benchmark::DoNotOptimize(manager.numCars());
+   }
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SpawnCars)->RangeMultiplier(10)->Range(1000, 1000000)
+   ->Unit(benchmark::kMicrosecond);
+
+// Manager::addCars() of the same n cars in one call
+static void BM_SpawnCarsBulk(benchmark::State& state)
+{
+   Cars cars = makeCars(state.range(0));
+   for (auto _ : state)
+   {
+      Manager manager;
+      manager.addCars(cars);
+      benchmark::DoNotOptimize(manager.numCars());
+   }
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SpawnCarsBulk)->RangeMultiplier(10)->Range(1000, 1000000)
+   ->Unit(benchmark::kMicrosecond);
+
+// Manager::deleteCar() of every car, from the front (each delete shifts
+// the rest) or from the back
+static void BM_DeleteCars(benchmark::State& state)
+{
+   bool front = state.range(1);
+   for (auto _ : state)
+   {
+      state.PauseTiming();
+      Manager manager;
+      populate(manager, state.range(0), 0);
+      state.ResumeTiming();
+      // ids are 1 based, as the GUI numbers them
+      while (manager.numCars() > 0)
+         manager.deleteCar(front ? 1 : manager.numCars());
+   }
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+   state.SetLabel(front ? "front" : "back");
+}
+BENCHMARK(BM_DeleteCars)->ArgsProduct({{1000, 10000}, {0, 1}})
+   ->Unit(benchmark::kMicrosecond);
+
+// Manager::addNewLight() then deleteLight() of every light
+static void BM_SpawnDeleteLights(benchmark::State& state)
+{
+   for (auto _ : state)
+   {
+      Manager manager;
+      populate(manager, 0, state.range(0));
+      while (manager.numLights() > 0)
+         manager.deleteLight(manager.numLights());
+   }
+   state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SpawnDeleteLights)->Arg(100)->Arg(10000)
+   ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
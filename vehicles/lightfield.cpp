@@ -0,0 +1,134 @@
+#include "lightfield.h"
+#include "swarmkernel.h"
+#include "threadpool.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// rows of the grid per chunk of a parallel build
+const int LIGHTFIELD_GRAIN = 8;
+
+namespace {
+typedef SwarmKernel<ScalarOps> Scalar;
+}
+
+
+LightField::LightField()
+: cellSize(0),
+origin(0),
+cols(0),
+rows(0)
+{
+}
+
+LightField::~LightField()
+{
+}
+
+void LightField::clear()
+{
+   values.clear();
+   cols = rows = 0;
+}
+
+void LightField::build(const Lights& lights, float _cellSize, ThreadPool* pool)
+{
+   cellSize = max(_cellSize, 0.01f);
+   // sensors reach SWARM_SENSOR_DIST past the car, which may sit on the border
+   origin = -(SWARM_SENSOR_DIST + cellSize);
+   cols = (int) ceil((WIDTH  - 2 * origin) / cellSize) + 1;
+   rows = (int) ceil((HEIGHT - 2 * origin) / cellSize) + 1;
+   values.assign((size_t) cols * rows, 0.0f);
+
+   vector<float> lightX(lights.size()), lightY(lights.size());
+   for (int j = 0; j < lights.size(); j++)
+   {
+      lightX[j] = lights[j].X;
+      lightY[j] = lights[j].Y;
+   }
+
+   auto fill = [&](int begin, int end, int worker) {
+      for (int r = begin; r < end; r++)
+      {
+         float y = origin + r * cellSize;
+         float* row = &values[(size_t) r * cols];
+         for (int j = 0; j < lightX.size(); j++)
+            for (int c = 0; c < cols; c++)
+               row[c] += Scalar::intensity(origin + c * cellSize, y, lightX[j], lightY[j]);
+      }
+   };
+   if (pool)
+      pool->parallelFor(rows, LIGHTFIELD_GRAIN, fill);
+   else
+      fill(0, rows, 0);
+}
+
+float LightField::sample(float x, float y) const
+{
+   if (!isBuilt())
+      return 0;
+   SwarmField field;
+   field.values = values.data();
+   field.origin = origin;
+   field.scale  = 1 / cellSize;
+   field.cols   = cols;
+   field.rows   = rows;
+   return Scalar::lookup(field, x, y);
+}
+
+float LightField::exact(const Lights& lights, float x, float y)
+{
+   float sum = 0;
+   for (int j = 0; j < lights.size(); j++)
+      sum += Scalar::intensity(x, y, lights[j].X, lights[j].Y);
+   return sum;
+}
+
+void LightField::error(const Lights& lights, int samples, double& meanSum, double& maxSum,
+                       double& meanTurn, double& maxTurn) const
+{
+   sensorError(lights, [this](float x, float y) {return sample(x, y);},
+               [this](float x1, float y1, float x2, float y2) {
+                  return sample(x2, y2) - sample(x1, y1);
+               },
+               samples, meanSum, maxSum, meanTurn, maxTurn);
+}
+
+void sensorError(const Lights& lights, const function<float(float, float)>& approx,
+                 const function<float(float, float, float, float)>& difference,
+                 int samples, double& meanSum, double& maxSum,
+                 double& meanTurn, double& maxTurn)
+{
+   meanSum = maxSum = meanTurn = maxTurn = 0;
+   unsigned int state = 12345;
+   for (int i = 0; i < samples; i++)
+   {
+      // a car somewhere in the window, its sensors on either side
+      state = state * 1664525u + 1013904223u;
+      float x = (state >> 8) % (WIDTH * 16) / 16.0f;
+      state = state * 1664525u + 1013904223u;
+      float y = (state >> 8) % (HEIGHT * 16) / 16.0f;
+      state = state * 1664525u + 1013904223u;
+      float heading = (state >> 8) / 16777216.0f * (float) (2 * PI) - (float) PI;
+
+      float s, c, s1x, s1y, s2x, s2y;
+      Scalar::sinCos(heading, s, c);
+      Scalar::sensors(x, y, s, c, s1x, s1y, s2x, s2y);
+
+      float exact1  = LightField::exact(lights, s1x, s1y);
+      float exact2  = LightField::exact(lights, s2x, s2y);
+      double sumError  = fabs(approx(s1x, s1y) - exact1);
+      double turnError = fabs(difference(s1x, s1y, s2x, s2y) - (exact2 - exact1));
+      meanSum  += sumError;
+      maxSum    = max(maxSum, sumError);
+      meanTurn += turnError;
+      maxTurn   = max(maxTurn, turnError);
+   }
+   if (samples > 0)
+   {
+      meanSum  /= samples;
+      meanTurn /= samples;
+   }
+}
@@ -0,0 +1,68 @@
+
+#ifndef LIGHTFIELD_H_
+#define LIGHTFIELD_H_
+
+#include "consts.h"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+class ThreadPool;
+
+/*
+ * The summed light intensity sampled on a grid, for many cars and lights
+ * that rarely move.
+ *
+ * A car steers by the difference of the intensity sums at its sensors, so
+ * the sum of all lights is all it needs: one grid of clamped 100 / distance
+ * sums, built when the lights change, turns each sensor read into a
+ * bilinear lookup whatever the number of lights.  The grid reaches a bit
+ * past the window, where sensors go while their car wraps around.
+ *
+ * Finer cells cost memory and build time and follow the peak at each
+ * light more closely; error() measures what a cell size gives.
+ */
+class LightField
+{
+public:
+   LightField();
+   ~LightField();
+
+   void  build(const Lights& lights, float cellSize, ThreadPool* pool = NULL);
+   void  clear();
+   bool  isBuilt() const {return !values.empty();}
+
+   // bilinear, clamped to the grid
+   float sample(float x, float y) const;
+   // the exact sum the grid samples
+   static float exact(const Lights& lights, float x, float y);
+
+   // sensorError() of sample()
+   void  error(const Lights& lights, int samples, double& meanSum, double& maxSum,
+               double& meanTurn, double& maxTurn) const;
+
+   float getCellSize() const {return cellSize;}
+   int   getCols()     const {return cols;}
+   int   getRows()     const {return rows;}
+   float getOrigin()   const {return origin;}
+   const float* getValues() const {return values.data();}
+
+private:
+   float    cellSize;
+   float    origin;    // x and y of the first node, just outside the window
+   int      cols;
+   int      rows;
+   std::vector<float> values;   // rows x cols, row major
+};
+
+// |approx - exact| at the sensors of samples random cars in the window,
+// mean and max, for the intensity sums and for the differences between a
+// car's two sensors that it steers by (difference(s1, s2) = sum at s2 -
+// sum at s1)
+void sensorError(const Lights& lights, const std::function<float(float, float)>& approx,
+                 const std::function<float(float, float, float, float)>& difference,
+                 int samples, double& meanSum, double& maxSum,
+                 double& meanTurn, double& maxTurn);
+
+#endif
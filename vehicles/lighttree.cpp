@@ -0,0 +1,204 @@
+#include "lighttree.h"
+#include "lightfield.h"
+#include "swarmkernel.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// lights a leaf holds before it splits, and how deep splitting goes (for
+// lights piled on one spot)
+const int LIGHTTREE_LEAF  = 8;
+const int LIGHTTREE_DEPTH = 24;
+
+namespace {
+typedef SwarmKernel<ScalarOps> Scalar;
+}
+
+
+LightTree::LightTree()
+: theta(0.5f)
+{
+}
+
+LightTree::~LightTree()
+{
+}
+
+void LightTree::clear()
+{
+   nodes.clear();
+   lightX.clear();
+   lightY.clear();
+}
+
+void LightTree::build(const Lights& lights)
+{
+   clear();
+   if (lights.empty())
+      return;
+
+   // the bounding square of the lights
+   float minX = lights[0].X, maxX = lights[0].X;
+   float minY = lights[0].Y, maxY = lights[0].Y;
+   for (int i = 1; i < lights.size(); i++)
+   {
+      minX = min(minX, (float) lights[i].X);
+      maxX = max(maxX, (float) lights[i].X);
+      minY = min(minY, (float) lights[i].Y);
+      maxY = max(maxY, (float) lights[i].Y);
+   }
+   float size = max(max(maxX - minX, maxY - minY), 1.0f);
+
+   vector<int> order(lights.size());
+   for (int i = 0; i < order.size(); i++)
+      order[i] = i;
+
+   Node root;
+   root.begin = 0;
+   root.end   = lights.size();
+   nodes.push_back(root);
+   split(0, order, lights, minX, minY, size, 0);
+
+   lightX.resize(order.size());
+   lightY.resize(order.size());
+   for (int i = 0; i < order.size(); i++)
+   {
+      lightX[i] = lights[order[i]].X;
+      lightY[i] = lights[order[i]].Y;
+   }
+}
+
+// Fill in the node for order[begin, end) and split it into quadrants,
+// y then x, until the leaves are small
+void LightTree::split(int node, vector<int>& order, const Lights& lights,
+                      float x0, float y0, float size, int depth)
+{
+   int begin = nodes[node].begin;
+   int end   = nodes[node].end;
+   double sumX = 0, sumY = 0;
+   for (int i = begin; i < end; i++)
+   {
+      sumX += lights[order[i]].X;
+      sumY += lights[order[i]].Y;
+   }
+   nodes[node].mass  = end - begin;
+   nodes[node].x     = end > begin ? sumX / (end - begin) : 0;
+   nodes[node].y     = end > begin ? sumY / (end - begin) : 0;
+   nodes[node].size  = size;
+   nodes[node].child = -1;
+   if (end - begin <= LIGHTTREE_LEAF || depth >= LIGHTTREE_DEPTH)
+      return;
+
+   float half = size / 2;
+   float midX = x0 + half;
+   float midY = y0 + half;
+   vector<int>::iterator first = order.begin();
+   int top  = partition(first + begin, first + end,
+                        [&](int i) {return lights[i].Y < midY;}) - first;
+   int topL = partition(first + begin, first + top,
+                        [&](int i) {return lights[i].X < midX;}) - first;
+   int botL = partition(first + top, first + end,
+                        [&](int i) {return lights[i].X < midX;}) - first;
+   const int bounds[5] = {begin, topL, top, botL, end};
+
+   int child = nodes.size();
+   nodes[node].child = child;
+   for (int q = 0; q < 4; q++)
+   {
+      Node quadrant;
+      quadrant.begin = bounds[q];
+      quadrant.end   = bounds[q + 1];
+      nodes.push_back(quadrant);
+   }
+   for (int q = 0; q < 4; q++)
+      split(child + q, order, lights, x0 + (q % 2) * half, y0 + (q / 2) * half,
+            half, depth + 1);
+}
+
+float LightTree::sample(float x, float y) const
+{
+   if (nodes.empty())
+      return 0;
+
+   const float theta2 = theta * theta;
+   int stack[3 * LIGHTTREE_DEPTH + 4];
+   int top = 0;
+   stack[top++] = 0;
+   float sum = 0;
+   while (top > 0)
+   {
+      const Node& n = nodes[stack[--top]];
+      if (n.mass == 0)
+         continue;
+      if (n.child < 0)
+      {
+         for (int i = n.begin; i < n.end; i++)
+            sum += Scalar::intensity(x, y, lightX[i], lightY[i]);
+         continue;
+      }
+
+      float dx = x - n.x;
+      float dy = y - n.y;
+      float dist2 = dx * dx + dy * dy;
+      if (n.size * n.size < theta2 * dist2)
+      {
+         // all of them at the centroid, clamped as one light on the spot
+         float mass = n.mass * SWARM_MAX_INTENSE;
+         sum += min(mass / sqrt(dist2), mass);
+      }
+      else
+         for (int q = 0; q < 4; q++)
+            stack[top++] = n.child + q;
+   }
+   return sum;
+}
+
+float LightTree::difference(float x1, float y1, float x2, float y2) const
+{
+   if (nodes.empty())
+      return 0;
+
+   const float theta2 = theta * theta;
+   int stack[3 * LIGHTTREE_DEPTH + 4];
+   int top = 0;
+   stack[top++] = 0;
+   float sum = 0;
+   while (top > 0)
+   {
+      const Node& n = nodes[stack[--top]];
+      if (n.mass == 0)
+         continue;
+      if (n.child < 0)
+      {
+         for (int i = n.begin; i < n.end; i++)
+            sum += Scalar::intensity(x2, y2, lightX[i], lightY[i]) -
+                   Scalar::intensity(x1, y1, lightX[i], lightY[i]);
+         continue;
+      }
+
+      // small enough from the nearer sensor
+      float dist1 = (x1 - n.x) * (x1 - n.x) + (y1 - n.y) * (y1 - n.y);
+      float dist2 = (x2 - n.x) * (x2 - n.x) + (y2 - n.y) * (y2 - n.y);
+      if (n.size * n.size < theta2 * min(dist1, dist2))
+      {
+         float mass = n.mass * SWARM_MAX_INTENSE;
+         sum += min(mass / sqrt(dist2), mass) - min(mass / sqrt(dist1), mass);
+      }
+      else
+         for (int q = 0; q < 4; q++)
+            stack[top++] = n.child + q;
+   }
+   return sum;
+}
+
+void LightTree::error(const Lights& lights, int samples, double& meanSum, double& maxSum,
+                      double& meanTurn, double& maxTurn) const
+{
+   sensorError(lights, [this](float x, float y) {return sample(x, y);},
+               [this](float x1, float y1, float x2, float y2) {
+                  return difference(x1, y1, x2, y2);
+               },
+               samples, meanSum, maxSum, meanTurn, maxTurn);
+}
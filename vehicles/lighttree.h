@@ -0,0 +1,72 @@
+
+#ifndef LIGHTTREE_H_
+#define LIGHTTREE_H_
+
+#include "consts.h"
+
+#include <vector>
+
+/*
+ * Barnes-Hut quadtree over the lights, for thousands of lights that move.
+ *
+ * Each node keeps the number of lights under it and their centroid.  A
+ * sensor reading the intensity walks down from the root and takes a node
+ * as a single source of that many lights at the centroid when the node is
+ * small as seen from the sensor (side < theta * distance), and opens it
+ * otherwise; leaves are summed light by light.  So a read costs about
+ * log(lights) / theta^2 instead of one per light, and theta trades
+ * accuracy for speed: 0 opens everything and is exact.
+ *
+ * A car steers by the small difference between its two sensors, which
+ * separate walks would bury under their own errors.  difference() walks
+ * once for both sensors, so both see the same sources and most of the
+ * error cancels out.
+ *
+ * Rebuilt from scratch every tick in O(L log L), the lights may move
+ * freely in between.
+ */
+class LightTree
+{
+public:
+   LightTree();
+   ~LightTree();
+
+   void  build(const Lights& lights);
+   void  clear();
+   bool  isBuilt() const {return !nodes.empty();}
+
+   void  setTheta(float _theta) {theta = _theta;}
+   float getTheta() const {return theta;}
+
+   // the summed intensity at (x, y), approximated as above
+   float sample(float x, float y) const;
+   // sample(x2, y2) - sample(x1, y1), from one walk
+   float difference(float x1, float y1, float x2, float y2) const;
+
+   // as LightField::error
+   void  error(const Lights& lights, int samples, double& meanSum, double& maxSum,
+               double& meanTurn, double& maxTurn) const;
+
+   int   numNodes() const {return nodes.size();}
+
+private:
+   struct Node {
+      float x;       // centroid of the lights below
+      float y;
+      float mass;    // number of lights below
+      float size;    // side of the node's square
+      int   child;   // first of 4 consecutive children, -1 for a leaf
+      int   begin;   // the lights below, in lightX / lightY
+      int   end;
+   };
+
+   std::vector<Node>  nodes;
+   std::vector<float> lightX;   // in tree order
+   std::vector<float> lightY;
+   float theta;
+
+   void  split(int node, std::vector<int>& order, const Lights& lights,
+               float x0, float y0, float size, int depth);
+};
+
+#endif
@@ -12,16 +12,22 @@
 
 #include <cmath>
 #include <iostream>
+#include <string>
 #include <unistd.h>
 
 using namespace std;
 
 void printUsage()
 {
-   cout << "Usage: vehicles (-c num_cars) (-l num_lights)" << endl;
+   cout << "Usage: vehicles (-c num_cars) (-l num_lights) (-f cell_size) (-a theta) (-r file) (-p file) (-x speed)" << endl;
    cout << "   Where" << endl; 
    cout << "         -c    Number of cars to create initially" << endl;
    cout << "         -l    Number of lights to create initially" << endl;
+   cout << "         -f    Sensors read a light field of this cell size (default 0 = exact)" << endl;
+   cout << "         -a    Sensors read a light tree with this opening angle (default 0 = exact)" << endl;
+   cout << "         -r    Record every tick to this trajectory file" << endl;
+   cout << "         -p    Play this trajectory file back instead of simulating" << endl;
+   cout << "         -x    Replay speed in recorded ticks per tick (default 1)" << endl;
 }
 
 int main(int argc, char* argv[])
@@ -31,10 +37,15 @@ int main(int argc, char* argv[])
    // parse args
    int numCars = 0;
    int numLights = 0;
+   float fieldCellSize = 0;
+   float lightTheta = 0;
+   string recordPath;
+   string replayPath;
+   float replaySpeed = 1;
    int c = 0;
 
    // get command line args
-   while((c = getopt (argc, argv, "c:l:d")) != -1)
+   while((c = getopt (argc, argv, "c:l:f:a:r:p:x:d")) != -1)
    switch(c)
    {
       case 'c': // number of cars
@@ -45,6 +56,26 @@ int main(int argc, char* argv[])
          numLights = atoi(optarg);
          break; 
 
+      case 'f': // light field cell size
+         fieldCellSize = atof(optarg);
+         break;
+
+      case 'a': // light tree opening angle
+         lightTheta = atof(optarg);
+         break;
+
+      case 'r': // record to a trajectory file
+         recordPath = optarg;
+         break;
+
+      case 'p': // play a trajectory file back
+         replayPath = optarg;
+         break;
+
+      case 'x': // replay speed
+         replaySpeed = atof(optarg);
+         break;
+
       default:
          printUsage();
          exit(1);
@@ -52,26 +83,36 @@ int main(int argc, char* argv[])
 
    // create the manager to hold the new cars
    Manager* manager = new Manager();
+   manager->setFieldCellSize(fieldCellSize);
+   manager->setLightTheta(lightTheta);
 
    // create randomly placed cars
+   Cars cars;
+   cars.reserve(numCars);
    for (int i = 0; i < numCars; i++)
    {
       int x = rand() % (WIDTH-BUFFER*2) + BUFFER;
       int y = rand() % (HEIGHT-BUFFER*2) + BUFFER;
       Position pos(x, y);
       int dir = rand() % 2;
-      Car car(pos, (bool) dir);
-      manager->addNewCar(car);
+      cars.push_back(Car(pos, (bool) dir));
    }
+   manager->addCars(cars);
 
    // create randomly placed lights
+   Lights lights;
    for (int i = 0; i < numLights; i++)
    {
       int x = rand() % (WIDTH-BUFFER*2) + BUFFER;
       int y = rand() % (HEIGHT-BUFFER*2) + BUFFER;
-      Light pos(x, y);
-      manager->addNewLight(pos);
+      lights.push_back(Light(x, y));
    }
+   manager->addLights(lights);
+
+   if (!replayPath.empty() && !manager->startReplay(replayPath, replaySpeed))
+      exit(1);
+   if (!recordPath.empty() && !manager->startRecording(recordPath))
+      exit(1);
 
    Window w(manager);
    w.show();
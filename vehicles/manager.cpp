@@ -1,6 +1,8 @@
 
 #include "manager.h"
+#include "threadpool.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 
@@ -8,96 +10,169 @@ using namespace std;
 
 
 Manager::Manager()
+: threads(0),
+pool(NULL),
+fieldCellSize(0),
+fieldCurrent(false),
+lightTheta(0),
+recorder(NULL),
+replay(NULL),
+replayPosition(0),
+replaySpeed(1)
 {
-	cars = Cars();
 	lights = Lights();
 }
 
 Manager::~Manager()
 {
+	delete recorder;
+	delete replay;
+	delete pool;
 }
 
 //TODO: Add fringe case for same intense at certain dist
-// Update positions of each car in list
+// Update positions of each car in list, see Swarm for the rules
 void Manager::timeStep()
 {
 #ifdef DEBUG
 	printCarLocs();
 	printLightLocs();
 #endif
-	
-	int anglenum = 4;
-	// This is where the math happens!
-	for (int i=0; i<cars.size(); i++)
+	if (replay)
 	{
-		Car car = cars[i];
-		Position s1 = car.getSensorPos(1);
-		Position s2 = car.getSensorPos(2);
+		// stay on the first or last frame when the replay runs out
+		long long first = replay->firstFrame();
+		long long end = replay->endFrame();
+		if (end > first)
+		{
+			replayPosition = min(max(replayPosition + replaySpeed, (double) first), (double) (end - 1));
+			showFrame((long long) replayPosition);
+		}
+		return;
+	}
+	if (!pool)
+		pool = new ThreadPool(threads);
+	if (fieldCellSize > 0 && !fieldCurrent)
+	{
+		field.build(lights, fieldCellSize, pool);
+		fieldCurrent = true;
+	}
+	if (fieldCellSize > 0)
+		swarm.step(lights, pool, &field);
+	else if (lightTheta > 0)
+	{
+		// the lights may have moved since the last tick
+		tree.setTheta(lightTheta);
+		tree.build(lights);
+		swarm.step(lights, pool, NULL, &tree);
+	}
+	else
+		swarm.step(lights, pool);
 
-#ifdef DEBUG
-		cout << "Current Car: " << i;
-      cout << " (x=" << cars[i].getX();
-      cout << ", y=" << cars[i].getY() << ", rot=";
-      cout << cars[i].getR() << " degs)" <<endl;
-#endif
+	if (recorder)
+		recorder->record(swarm, lights);
+}
 
-		int total = 0;
-		for (int j=0; j<lights.size(); j++)
-		{
-			Light light = lights[j];
-			int intense1 = 100/sqrt(pow(s1.X-light.X,2) + pow(s1.Y-light.Y,2));
-			int intense2 = 100/sqrt(pow(s2.X-light.X,2) + pow(s2.Y-light.Y,2));
-			if (intense1 > 100)
-				intense1 = 100;
-			if (intense2 > 100)
-				intense2 = 100;
+bool Manager::startRecording(const string& path, int frames, int maxCars, int maxLights, bool wait)
+{
+	stopRecording();
+	if (maxCars <= 0)
+		maxCars = max(1024, swarm.size());
+	if (maxLights <= 0)
+		maxLights = max(64, (int) lights.size());
+	recorder = new TrajectoryRecorder();
+	if (!recorder->open(path, maxCars, maxLights, frames))
+	{
+		stopRecording();
+		return false;
+	}
+	recorder->setWait(wait);
+	return true;
+}
 
-			int diff = intense2 - intense1;
-			total+=diff;
+void Manager::stopRecording()
+{
+	delete recorder;
+	recorder = NULL;
+}
 
-#ifdef DEBUG
-			cout << "   Current Light: " << j << " - ";
-			cout << intense1 << "::" << intense2 << endl;
-#endif
-		}
-		if (cars[i].getDirect())
-		{
-			cars[i].setR(car.getR() + (total*anglenum));
-		}
-		else
-		{
-			cars[i].setR(car.getR() - (total*anglenum));
-		}
-		
-		cars[i].setX(ceil(cars[i].getX() - 3*(double)cos(cars[i].getR_rad())));
-		cars[i].setY(ceil(cars[i].getY() - 3*sin(cars[i].getR_rad())));
-		if (cars[i].getX() > WIDTH)
-		{
-			cars[i].setX(0);
-		}
-		else if (cars[i].getX() <= 0)
-		{
-			cars[i].setX(WIDTH);
-		}
-		if (cars[i].getY() > HEIGHT)
-		{
-			cars[i].setY(0);
-		}
-		else if (cars[i].getY() <= 0)
-		{
-			cars[i].setY(HEIGHT);
-		}
-		cars[i].calcSensorPos();
+bool Manager::startReplay(const string& path, float speed)
+{
+	stopReplay();
+	replay = new TrajectoryReader();
+	if (!replay->open(path))
+	{
+		stopReplay();
+		return false;
 	}
+	replaySpeed = speed;
+	replayPosition = replay->firstFrame();
+	showFrame(replayPosition);
+	return true;
+}
+
+void Manager::stopReplay()
+{
+	delete replay;
+	replay = NULL;
+}
+
+// The cars and lights as recorded; a frame the recorder has overwritten
+// meanwhile leaves the last one on show
+void Manager::showFrame(long long frame)
+{
+	if (!replay->read(frame, replayState))
+		return;
+	swarm.clear();
+	swarm.reserve(replayState.x.size());
+	for (int i=0; i<replayState.x.size(); i++)
+		swarm.addCar(replayState.x[i], replayState.y[i], replayState.heading[i], replayState.direct[i]);
+	lights = replayState.lights;
+	fieldCurrent = false;
+}
+
+void Manager::setLightTheta(float theta)
+{
+	lightTheta = max(theta, 0.0f);
+	if (lightTheta == 0)
+		tree.clear();
+}
+
+void Manager::setFieldCellSize(float size)
+{
+	fieldCellSize = max(size, 0.0f);
+	fieldCurrent = false;
+	if (fieldCellSize == 0)
+		field.clear();
+}
+
+// The pool is rebuilt with the new size on the next step
+void Manager::setThreads(int _threads)
+{
+	if (_threads == threads)
+		return;
+	threads = _threads;
+	delete pool;
+	pool = NULL;
+}
+
+Cars Manager::getCars() const
+{
+	Cars cars;
+	cars.reserve(swarm.size());
+	for (int i=0; i<swarm.size(); i++)
+		cars.push_back(swarm.getCar(i));
+	return cars;
 }
 
 void Manager::printCarLocs() const
 {
 	cout << "Cars:\n";
-	for (int i=0; i<cars.size(); i++)
+	for (int i=0; i<swarm.size(); i++)
 	{
-		cout << "\t" << i << ": (" << cars[i].getX() << ", " << cars[i].getY() << ") " << cars[i].getR() << " degs ";
-		if (cars[i].getDirect())
+		Car car = swarm.getCar(i);
+		cout << "\t" << i << ": (" << car.getX() << ", " << car.getY() << ") " << car.getR() << " degs ";
+		if (car.getDirect())
 			cout << "[Direct]" << endl;
 		else
 			cout << "[Inverse]" << endl;
@@ -113,37 +188,48 @@ void Manager::printLightLocs() const
 	}
 }
 
-void Manager::addNewCar(Car car)
+void Manager::addNewCar(const Car& car)
 {
-   cars.push_back(car);
+   swarm.addCar(car);
 }
 
-void Manager::addNewLight(Light light)
+void Manager::addNewLight(const Light& light)
 {
    lights.push_back(light);
+   fieldCurrent = false;
+}
+
+void Manager::addCars(const Cars& cars)
+{
+   swarm.addCars(cars);
+}
+
+void Manager::addLights(const Lights& newLights)
+{
+   lights.insert(lights.end(), newLights.begin(), newLights.end());
+   fieldCurrent = false;
 }
 
 void Manager::deleteCar(int car)
 {
-   cars.erase(cars.begin() + car - 1);
+   swarm.deleteCar(car - 1);
 }
 
 void Manager::deleteLight(int light)
 {
    lights.erase(lights.begin() + light - 1);
+   fieldCurrent = false;
 }
 
 void Manager::updateCarPos(int carID, int newX, int newY, bool directMapping)
 {
-   Car car = cars[carID];
-   car.setX(newX);
-   car.setY(newY);
-   car.setDirect(directMapping);
+   swarm.setCarPos(carID, newX, newY);
+   swarm.setDirect(carID, directMapping);
 }
 
 void Manager::updateLightPos(int lightID, int newX, int newY)
 {
-   Light light = lights[lightID];
-   light.X = newX;
-   light.Y = newY;
+   lights[lightID].X = newX;
+   lights[lightID].Y = newY;
+   fieldCurrent = false;
 }
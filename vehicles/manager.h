@@ -4,6 +4,14 @@
 
 #include "consts.h"
 #include "car.h"
+#include "lightfield.h"
+#include "lighttree.h"
+#include "swarm.h"
+#include "trajectory.h"
+
+#include <string>
+
+class ThreadPool;
 
 class Manager
 {
@@ -17,25 +25,79 @@ public:
    void printCarLocs() const;
    void printLightLocs() const;
 
-   Cars     getCars() const {return cars;}
-   Lights   getLights() const {return lights;}
+   // builds a Car per car, for tools; per frame code reads getSwarm()'s
+   // arrays or a Simulation snapshot instead
+   Cars     getCars() const;
+   const Lights& getLights() const {return lights;}
 
-   Car      getCar(int i) const {if (i >= cars.size()) return Car(); else return cars[i];}
+   Car      getCar(int i) const {if (i >= swarm.size()) return Car(); else return swarm.getCar(i);}
    Light    getLight(int i) const {if (i >= lights.size()) return Light(); else return lights[i];}
 
-   int  numCars() const {return cars.size();}
+   int  numCars() const {return swarm.size();}
    int  numLights() const {return lights.size();}
 	
-	void addNewCar(Car car);
-   void addNewLight(Light light);
+	void addNewCar(const Car& car);
+   void addNewLight(const Light& light);
+   // in bulk, growing the arrays once
+   void addCars(const Cars& cars);
+   void addLights(const Lights& newLights);
    void deleteCar(int car);
    void deleteLight(int light);
    void updateCarPos(int car, int newX, int newY, bool directMapping);
    void updateLightPos(int light, int newX, int newY);
+
+   // the step kernel, the widest the CPU runs by default
+   void setKernel(Swarm::Kernel kernel) {swarm.setKernel(kernel);}
+   // threads for the step (0 = one per core), the same result for any
+   void setThreads(int threads);
+   int  getThreads() const {return threads;}
+   // sensors read a grid of the summed light intensity, rebuilt when the
+   // lights change, instead of summing every light (0 = exact, the default)
+   void setFieldCellSize(float size);
+   float getFieldCellSize() const {return fieldCellSize;}
+   const LightField& getLightField() const {return field;}
+   // without a field, sensors read a Barnes-Hut tree of the lights rebuilt
+   // every tick, opening nodes under this angle (0 = exact, the default)
+   void setLightTheta(float theta);
+   float getLightTheta() const {return lightTheta;}
+   const Swarm& getSwarm() const {return swarm;}
+
+   // record every tick from now on into a ring of the last frames ticks,
+   // see trajectory.h (0 cars or lights = room for as many as now, at
+   // least 1024 cars and 64 lights).  With wait a tick waits for the
+   // writer instead of being dropped, for headless runs.
+   bool startRecording(const std::string& path, int frames = 4096,
+                       int maxCars = 0, int maxLights = 0, bool wait = false);
+   void stopRecording();
+   const TrajectoryRecorder* getRecorder() const {return recorder;}
+   // play a recording back instead of simulating, speed frames per tick
+   // (fractions slow it down, negative plays it backwards)
+   bool startReplay(const std::string& path, float speed = 1);
+   void stopReplay();
+   void setReplaySpeed(float speed) {replaySpeed = speed;}
+   bool isReplaying() const {return replay != NULL;}
 	
 private:
-   Cars     cars;    // list of cars
+   Swarm    swarm;   // the cars, one array per field
    Lights   lights;  // list of lights
+
+   int         threads;
+   ThreadPool* pool;    // made on the first step
+
+   float       fieldCellSize;
+   LightField  field;
+   bool        fieldCurrent;  // built for the current lights
+
+   float       lightTheta;
+   LightTree   tree;
+
+   TrajectoryRecorder* recorder;
+   TrajectoryReader*   replay;
+   TrajectoryFrame     replayState;
+   double      replayPosition;   // frame number, fractional at low speeds
+   float       replaySpeed;
+
+   void  showFrame(long long frame);
 };
 
 #endif
@@ -0,0 +1,176 @@
+
+/*
+   Headless vehicles simulation (no Qt, no GL)
+
+   Places random cars and lights as the GUI does, then runs
+   Manager::timeStep() back to back instead of on the 30 ms timer, and
+   reports how fast it went.  The final state can be written out to
+   compare runs or feed other tools, and every tick can be recorded as a
+   trajectory (trajectory.h).
+ */
+
+#include "consts.h"
+#include "car.h"
+#include "manager.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+using namespace std;
+
+
+static double now()
+{
+   return chrono::duration<double>(
+          chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// one line per car (x y heading direct) then one per light (x y)
+static bool dumpState(const Manager& manager, const string& path)
+{
+   FILE* out = path == "-" ? stdout : fopen(path.c_str(), "w");
+   if (!out)
+   {
+      cout << "ERROR: could not open " << path << endl;
+      return false;
+   }
+
+   const Swarm& swarm = manager.getSwarm();
+   fprintf(out, "# cars %d\n", swarm.size());
+   for (int i = 0; i < swarm.size(); i++)
+      fprintf(out, "%.9g %.9g %.9g %d\n", swarm.getX()[i], swarm.getY()[i],
+              swarm.getHeading()[i], swarm.getSign()[i] > 0 ? 1 : 0);
+   fprintf(out, "# lights %d\n", manager.numLights());
+   for (int j = 0; j < manager.numLights(); j++)
+      fprintf(out, "%d %d\n", manager.getLight(j).X, manager.getLight(j).Y);
+
+   if (out != stdout)
+      fclose(out);
+   return true;
+}
+
+void printUsage()
+{
+   cout << "Usage: vehicles_run (-c num_cars) (-l num_lights) (-n steps) (-t threads) (-f cell_size) (-a theta) (-s seed) (-o file) (-r file)" << endl;
+   cout << "   Where" << endl;
+   cout << "         -c    Number of cars to create (default 1000)" << endl;
+   cout << "         -l    Number of lights to create (default 8)" << endl;
+   cout << "         -n    Number of time steps to run (default 1000)" << endl;
+   cout << "         -t    Threads for the step (default 0 = one per core)" << endl;
+   cout << "         -f    Sensors read a light field of this cell size (default 0 = exact)" << endl;
+   cout << "         -a    Sensors read a light tree with this opening angle (default 0 = exact)" << endl;
+   cout << "         -s    Random seed for the placement (default 1)" << endl;
+   cout << "         -o    Write the final cars and lights to this file, - for stdout" << endl;
+   cout << "         -r    Record every tick to this trajectory file (the last 4096 are kept)" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+   int numCars = 1000;
+   int numLights = 8;
+   int steps = 1000;
+   int threads = 0;
+   float fieldCellSize = 0;
+   float lightTheta = 0;
+   unsigned int seed = 1;
+   string dumpPath;
+   string recordPath;
+
+   int c = 0;
+   while((c = getopt (argc, argv, "c:l:n:t:f:a:s:o:r:")) != -1)
+   switch(c)
+   {
+      case 'c':
+         numCars = max(0, atoi(optarg));
+         break;
+      case 'l':
+         numLights = max(0, atoi(optarg));
+         break;
+      case 'n':
+         steps = max(0, atoi(optarg));
+         break;
+      case 't':
+         threads = max(0, atoi(optarg));
+         break;
+      case 'f':
+         fieldCellSize = atof(optarg);
+         break;
+      case 'a':
+         lightTheta = atof(optarg);
+         break;
+      case 's':
+         seed = atoi(optarg);
+         break;
+      case 'o':
+         dumpPath = optarg;
+         break;
+      case 'r':
+         recordPath = optarg;
+         break;
+      default:
+         printUsage();
+         exit(1);
+   }
+
+   Manager manager;
+   manager.setThreads(threads);
+   manager.setFieldCellSize(fieldCellSize);
+   manager.setLightTheta(lightTheta);
+
+   // placed as the GUI places them
+   srand(seed);
+   Cars cars;
+   cars.reserve(numCars);
+   for (int i = 0; i < numCars; i++)
+   {
+      int x = rand() % (WIDTH-BUFFER*2) + BUFFER;
+      int y = rand() % (HEIGHT-BUFFER*2) + BUFFER;
+      cars.push_back(Car(Position(x, y), (bool) (rand() % 2)));
+   }
+   manager.addCars(cars);
+   Lights lights;
+   for (int i = 0; i < numLights; i++)
+   {
+      int x = rand() % (WIDTH-BUFFER*2) + BUFFER;
+      int y = rand() % (HEIGHT-BUFFER*2) + BUFFER;
+      lights.push_back(Light(x, y));
+   }
+   manager.addLights(lights);
+
+   // nothing is on screen, so a tick may wait for the recorder rather
+   // than be dropped
+   if (!recordPath.empty() && !manager.startRecording(recordPath, 4096, 0, 0, true))
+      return 1;
+
+   double begin = now();
+   for (int s = 0; s < steps; s++)
+      manager.timeStep();
+   double elapsed = now() - begin;
+
+   // the report goes to stderr when the state goes to stdout
+   FILE* report = dumpPath == "-" ? stderr : stdout;
+   fprintf(report, "%d cars, %d lights, %s kernel\n", numCars, numLights,
+           Swarm::kernelName(manager.getSwarm().getKernel()));
+   fprintf(report, "%12s %12s %14s %16s\n", "steps", "seconds", "steps/s", "car-updates/s");
+   fprintf(report, "%12d %12.3f %14.1f %16.0f\n", steps, elapsed,
+           elapsed > 0 ? steps / elapsed : 0.0,
+           elapsed > 0 ? (double) steps * numCars / elapsed : 0.0);
+
+   if (manager.getRecorder())
+   {
+      // stopping waits for the writer to catch up
+      long long dropped = manager.getRecorder()->numDropped();
+      manager.stopRecording();
+      fprintf(report, "recorded %lld ticks to %s, %lld dropped\n",
+              (long long) steps - dropped, recordPath.c_str(), dropped);
+   }
+
+   if (!dumpPath.empty() && !dumpState(manager, dumpPath))
+      return 1;
+   return 0;
+}
@@ -0,0 +1,121 @@
+#include "simulation.h"
+#include "manager.h"
+
+#include <chrono>
+
+using namespace std;
+
+
+SnapshotBuffer::SnapshotBuffer()
+: middle(1),
+backIndex(0),
+frontIndex(2)
+{
+   for (int i = 0; i < 3; i++)
+      buffers[i].tick = -1;
+}
+
+void SnapshotBuffer::publish()
+{
+   backIndex = middle.exchange(backIndex | FRESH, memory_order_acq_rel) & 3;
+}
+
+const Snapshot& SnapshotBuffer::latest()
+{
+   // only the writer sets FRESH, so it is still set at the exchange
+   if (middle.load(memory_order_relaxed) & FRESH)
+      frontIndex = middle.exchange(frontIndex, memory_order_acq_rel) & 3;
+   return buffers[frontIndex];
+}
+
+
+Simulation::Simulation(Manager* _manager)
+: manager(_manager),
+running(false),
+stopping(false),
+interval(30),
+ticks(0)
+{
+   lock_guard<mutex> guard(lock);
+   publish();
+}
+
+Simulation::~Simulation()
+{
+   stop();
+}
+
+void Simulation::start()
+{
+   if (running)
+      return;
+   stopping = false;
+   running  = true;
+   worker = std::thread(&Simulation::loop, this);
+}
+
+void Simulation::stop()
+{
+   if (!running)
+      return;
+   {
+      lock_guard<mutex> guard(lock);
+      stopping = true;
+   }
+   wake.notify_all();
+   worker.join();
+   running = false;
+}
+
+void Simulation::edit(const function<void(Manager&)>& change)
+{
+   lock_guard<mutex> guard(lock);
+   change(*manager);
+   publish();
+}
+
+// The lock is only held for the tick itself, edits get in between
+void Simulation::loop()
+{
+   chrono::steady_clock::time_point next = chrono::steady_clock::now();
+   unique_lock<mutex> guard(lock);
+   while (!stopping)
+   {
+      manager->timeStep();
+      ticks++;
+      publish();
+
+      int ms = interval;
+      if (ms > 0)
+      {
+         // a slow tick is not made up for by rushing the next ones
+         next = max(next + chrono::milliseconds(ms), chrono::steady_clock::now());
+         wake.wait_until(guard, next, [this] {return stopping;});
+      }
+      else
+      {
+         guard.unlock();
+         this_thread::yield();
+         guard.lock();
+      }
+   }
+}
+
+// with the lock held
+void Simulation::publish()
+{
+   const Swarm& swarm = manager->getSwarm();
+   int n = swarm.size();
+   Snapshot& snapshot = snapshots.back();
+   snapshot.tick = ticks;
+   snapshot.x.assign(swarm.getX(), swarm.getX() + n);
+   snapshot.y.assign(swarm.getY(), swarm.getY() + n);
+   snapshot.heading.assign(swarm.getHeading(), swarm.getHeading() + n);
+   snapshot.sign.assign(swarm.getSign(), swarm.getSign() + n);
+   snapshot.s1x.assign(swarm.getS1X(), swarm.getS1X() + n);
+   snapshot.s1y.assign(swarm.getS1Y(), swarm.getS1Y() + n);
+   snapshot.s2x.assign(swarm.getS2X(), swarm.getS2X() + n);
+   snapshot.s2y.assign(swarm.getS2Y(), swarm.getS2Y() + n);
+   snapshot.lights = manager->getLights();
+   snapshots.publish();
+}
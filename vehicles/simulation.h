@@ -0,0 +1,107 @@
+
+#ifndef SIMULATION_H_
+#define SIMULATION_H_
+
+#include "consts.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Manager;
+
+// The cars and lights of one tick, as the renderer sees them
+struct Snapshot {
+   long long tick;
+   std::vector<float> x;
+   std::vector<float> y;
+   std::vector<float> heading;   // radians
+   std::vector<float> sign;      // +1 direct, -1 inverse
+   std::vector<float> s1x;       // sensors
+   std::vector<float> s1y;
+   std::vector<float> s2x;
+   std::vector<float> s2y;
+   Lights   lights;
+
+   int   numCars() const {return x.size();}
+};
+
+/*
+ * Triple buffer of snapshots between one writer and one reader.
+ *
+ * The writer fills its own back buffer and publishes it by swapping it
+ * with the middle one; the reader swaps the middle one for its front
+ * buffer when it holds something newer.  Each swap is a single atomic
+ * exchange, so neither side ever waits for the other, the reader always
+ * gets the latest complete tick, and a buffer is never written while it
+ * is being read.
+ */
+class SnapshotBuffer
+{
+public:
+   SnapshotBuffer();
+
+   // writer side: fill this, then publish() it
+   Snapshot& back() {return buffers[backIndex];}
+   void  publish();
+
+   // reader side: the newest published snapshot, until the next latest()
+   const Snapshot& latest();
+
+private:
+   static const int FRESH = 4;   // the middle buffer was published since the last read
+
+   Snapshot          buffers[3];
+   std::atomic<int>  middle;     // index, | FRESH
+   int               backIndex;  // the writer's
+   int               frontIndex; // the reader's
+};
+
+/*
+ * Runs the manager's time step on its own thread, every interval ms (0 =
+ * as fast as it goes), and publishes a snapshot after each tick.
+ *
+ * The renderer draws latest() without locks at its own rate.  Anything
+ * else that reads or changes the manager goes through edit(), which runs
+ * between two ticks.
+ */
+class Simulation
+{
+public:
+   Simulation(Manager* manager);
+   ~Simulation();
+
+   void  start();
+   void  stop();
+   bool  isRunning() const {return running;}
+
+   void  setInterval(int ms) {interval = ms;}
+   int   getInterval() const {return interval;}
+
+   // from the render thread only
+   const Snapshot& latest() {return snapshots.latest();}
+
+   // runs change on the manager between ticks, then publishes the result
+   void  edit(const std::function<void(Manager&)>& change);
+
+   long long numTicks() const {return ticks.load();}
+
+private:
+   Manager*          manager;
+   SnapshotBuffer    snapshots;
+   std::thread       worker;
+   std::mutex        lock;       // held for a tick or an edit
+   std::condition_variable wake;
+   bool              running;
+   bool              stopping;
+   std::atomic<int>  interval;
+   std::atomic<long long> ticks;
+
+   void  loop();
+   void  publish();
+};
+
+#endif
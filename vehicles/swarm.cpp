@@ -0,0 +1,282 @@
+#include "swarm.h"
+#include "lightfield.h"
+#include "lighttree.h"
+#include "swarmkernel.h"
+#include "threadpool.h"
+
+#include <cmath>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+// cars per chunk of a parallel step, a multiple of every vector width
+const int SWARM_GRAIN = 4096;
+
+#ifdef SWARM_AVX2
+int swarmStepAVX2(const SwarmArrays& arrays, int begin, int end);
+#endif
+
+namespace {
+
+#ifdef __SSE2__
+// 4 cars at a time, every x86-64 CPU has it
+struct SSE2Ops
+{
+   typedef __m128 V;
+   typedef __m128 M;
+   static const int WIDTH = 4;
+
+   static inline V load(const float* p)      {return _mm_loadu_ps(p);}
+   static inline void store(float* p, V v)   {_mm_storeu_ps(p, v);}
+   static inline V set(float f)              {return _mm_set1_ps(f);}
+   static inline V add(V a, V b)             {return _mm_add_ps(a, b);}
+   static inline V sub(V a, V b)             {return _mm_sub_ps(a, b);}
+   static inline V mul(V a, V b)             {return _mm_mul_ps(a, b);}
+   static inline V div(V a, V b)             {return _mm_div_ps(a, b);}
+   static inline V sqrt(V a)                 {return _mm_sqrt_ps(a);}
+   static inline V min(V a, V b)             {return _mm_min_ps(a, b);}
+   static inline V max(V a, V b)             {return _mm_max_ps(a, b);}
+   static inline V trunc(V a)                {return _mm_cvtepi32_ps(_mm_cvttps_epi32(a));}
+   static inline M cmpgt(V a, V b)           {return _mm_cmpgt_ps(a, b);}
+   static inline M cmpge(V a, V b)           {return _mm_cmpge_ps(a, b);}
+   static inline M cmpeq(V a, V b)           {return _mm_cmpeq_ps(a, b);}
+   static inline V select(M m, V a, V b)     {return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));}
+   // no gather before AVX2
+   static inline V gather(const float* p, V i)
+   {
+      float index[4];
+      _mm_storeu_ps(index, i);
+      return _mm_setr_ps(p[(int) index[0]], p[(int) index[1]],
+                         p[(int) index[2]], p[(int) index[3]]);
+   }
+};
+#endif
+
+typedef SwarmKernel<ScalarOps> Scalar;
+
+}
+
+
+Swarm::Swarm()
+{
+   setKernel(KERNEL_AUTO);
+}
+
+Swarm::~Swarm()
+{
+}
+
+void Swarm::addCar(const Car& car)
+{
+   addCar(car.getX(), car.getY(), (float) car.getR_rad(), car.getDirect());
+}
+
+void Swarm::addCar(float _x, float _y, float _heading, bool direct)
+{
+   x.push_back(_x);
+   y.push_back(_y);
+   heading.push_back(Scalar::wrapAngle(_heading));
+   sign.push_back(direct ? 1.0f : -1.0f);
+   s1x.push_back(0);
+   s1y.push_back(0);
+   s2x.push_back(0);
+   s2y.push_back(0);
+   calcSensorPos(x.size() - 1);
+}
+
+void Swarm::addCars(const Cars& cars)
+{
+   reserve(size() + cars.size());
+   for (int i = 0; i < cars.size(); i++)
+      addCar(cars[i]);
+}
+
+void Swarm::deleteCar(int i)
+{
+   x.erase(x.begin() + i);
+   y.erase(y.begin() + i);
+   heading.erase(heading.begin() + i);
+   sign.erase(sign.begin() + i);
+   s1x.erase(s1x.begin() + i);
+   s1y.erase(s1y.begin() + i);
+   s2x.erase(s2x.begin() + i);
+   s2y.erase(s2y.begin() + i);
+}
+
+void Swarm::clear()
+{
+   x.clear();
+   y.clear();
+   heading.clear();
+   sign.clear();
+   s1x.clear();
+   s1y.clear();
+   s2x.clear();
+   s2y.clear();
+}
+
+void Swarm::reserve(int n)
+{
+   x.reserve(n);
+   y.reserve(n);
+   heading.reserve(n);
+   sign.reserve(n);
+   s1x.reserve(n);
+   s1y.reserve(n);
+   s2x.reserve(n);
+   s2y.reserve(n);
+}
+
+Car Swarm::getCar(int i) const
+{
+   Car car(Position(lround(x[i]), lround(y[i])), sign[i] > 0);
+   car.setR(lround(heading[i] * (180.0 / PI)));
+   car.calcSensorPos();
+   return car;
+}
+
+void Swarm::setCarPos(int i, float _x, float _y)
+{
+   x[i] = _x;
+   y[i] = _y;
+   calcSensorPos(i);
+}
+
+void Swarm::setDirect(int i, bool direct)
+{
+   sign[i] = direct ? 1.0f : -1.0f;
+}
+
+// the same arithmetic as the step, so a car placed by hand and one that
+// drove there see the same
+void Swarm::calcSensorPos(int i)
+{
+   float s, c;
+   Scalar::sinCos(heading[i], s, c);
+   Scalar::sensors(x[i], y[i], s, c, s1x[i], s1y[i], s2x[i], s2y[i]);
+}
+
+void Swarm::step(const Lights& lights, ThreadPool* pool, const LightField* field,
+                 const LightTree* tree)
+{
+   lightX.resize(lights.size());
+   lightY.resize(lights.size());
+   for (int j = 0; j < lights.size(); j++)
+   {
+      lightX[j] = lights[j].X;
+      lightY[j] = lights[j].Y;
+   }
+
+   SwarmArrays arrays;
+   arrays.x         = x.data();
+   arrays.y         = y.data();
+   arrays.heading   = heading.data();
+   arrays.s1x       = s1x.data();
+   arrays.s1y       = s1y.data();
+   arrays.s2x       = s2x.data();
+   arrays.s2y       = s2y.data();
+   arrays.sign      = sign.data();
+   arrays.lightX    = lightX.data();
+   arrays.lightY    = lightY.data();
+   arrays.numLights = lights.size();
+   arrays.field.values = NULL;
+   arrays.total = NULL;
+   if (field && field->isBuilt())
+   {
+      arrays.field.values = field->getValues();
+      arrays.field.origin = field->getOrigin();
+      arrays.field.scale  = 1 / field->getCellSize();
+      arrays.field.cols   = field->getCols();
+      arrays.field.rows   = field->getRows();
+   }
+   else if (tree && tree->isBuilt())
+   {
+      steer.resize(size());
+      arrays.total = steer.data();
+   }
+
+   // the tree walk is scalar, so it fills in the steering of a chunk
+   // before the kernel steps it
+   auto chunk = [&](int begin, int end, int worker) {
+      if (arrays.total)
+         for (int i = begin; i < end; i++)
+            steer[i] = tree->difference(s1x[i], s1y[i], s2x[i], s2y[i]);
+      stepRange(arrays, begin, end);
+   };
+   if (pool)
+      pool->parallelFor(size(), SWARM_GRAIN, chunk);
+   else
+      chunk(0, size(), 0);
+}
+
+void Swarm::stepRange(const SwarmArrays& arrays, int begin, int end) const
+{
+   int done = begin;
+   switch (kernel)
+   {
+#ifdef SWARM_AVX2
+      case KERNEL_AVX2:
+         done = swarmStepAVX2(arrays, begin, end);
+         break;
+#endif
+#ifdef __SSE2__
+      case KERNEL_SSE2:
+         done = begin + (end - begin) / SSE2Ops::WIDTH * SSE2Ops::WIDTH;
+         SwarmKernel<SSE2Ops>::step(arrays, begin, done);
+         break;
+#endif
+      default:
+         break;
+   }
+   Scalar::step(arrays, done, end);
+}
+
+void Swarm::setKernel(Kernel k)
+{
+   if (k == KERNEL_AUTO || !hasKernel(k))
+   {
+      k = KERNEL_SCALAR;
+      if (hasKernel(KERNEL_SSE2))
+         k = KERNEL_SSE2;
+      if (hasKernel(KERNEL_AVX2))
+         k = KERNEL_AVX2;
+   }
+   kernel = k;
+}
+
+bool Swarm::hasKernel(Kernel k)
+{
+   switch (k)
+   {
+      case KERNEL_SCALAR:
+         return true;
+#ifdef __SSE2__
+      case KERNEL_SSE2:
+         return true;
+#endif
+#ifdef SWARM_AVX2
+      case KERNEL_AVX2:
+         return __builtin_cpu_supports("avx2");
+#endif
+      default:
+         return false;
+   }
+}
+
+const char* Swarm::kernelName(Kernel k)
+{
+   switch (k)
+   {
+      case KERNEL_SCALAR:
+         return "scalar";
+      case KERNEL_SSE2:
+         return "sse2";
+      case KERNEL_AVX2:
+         return "avx2";
+      default:
+         return "auto";
+   }
+}
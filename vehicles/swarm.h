@@ -0,0 +1,100 @@
+
+#ifndef SWARM_H_
+#define SWARM_H_
+
+#include "consts.h"
+#include "car.h"
+
+#include <cstddef>
+#include <vector>
+
+class LightField;
+class LightTree;
+class ThreadPool;
+struct SwarmArrays;
+
+/*
+ * The vehicles as a structure of arrays, for the simulation step.
+ *
+ * Position, heading, both sensor positions and the mapping sign are each a
+ * contiguous float array, so the step kernel works on 8 cars at once with
+ * AVX2 (4 with SSE2) and every car costs one pass over the lights.  The
+ * rules are the Car model's without its integer rounding: intensity is
+ * 100 / distance clamped to 100, the heading turns by 4 degrees per unit of
+ * intensity difference and the car moves 3 pixels a tick, wrapping at the
+ * window border.
+ *
+ * All kernels use the same operations in the same order, sine and cosine
+ * included, so they give bit for bit the same result.  A car's step reads
+ * only its own state and the lights, so splitting the cars across threads
+ * does not change it either: the result is the same for any thread count.
+ */
+class Swarm
+{
+public:
+   enum Kernel {
+      KERNEL_AUTO,      // the widest one the CPU runs
+      KERNEL_SCALAR,
+      KERNEL_SSE2,
+      KERNEL_AVX2
+   };
+
+   Swarm();
+   ~Swarm();
+
+   void  addCar(const Car& car);
+   // heading in radians
+   void  addCar(float x, float y, float heading, bool direct);
+   void  addCars(const Cars& cars);
+   void  deleteCar(int i);
+   void  clear();
+   void  reserve(int n);
+
+   // the car's state rounded to the Car model (int pixels and degrees)
+   Car   getCar(int i) const;
+   void  setCarPos(int i, float x, float y);
+   void  setDirect(int i, bool direct);
+
+   int   size() const {return x.size();}
+
+   // one tick for every car, split across the pool if there is one; the
+   // sensors read a built field, else a built tree, else sum the lights
+   void  step(const Lights& lights, ThreadPool* pool = NULL,
+              const LightField* field = NULL, const LightTree* tree = NULL);
+
+   // KERNEL_AUTO, or one the CPU cannot run, picks the widest available
+   void  setKernel(Kernel k);
+   Kernel getKernel() const {return kernel;}
+   static bool hasKernel(Kernel k);
+   static const char* kernelName(Kernel k);
+
+   const float* getX()       const {return x.data();}
+   const float* getY()       const {return y.data();}
+   const float* getHeading() const {return heading.data();}  // radians in [-pi, pi)
+   const float* getSign()    const {return sign.data();}     // +1 direct, -1 inverse
+   const float* getS1X()     const {return s1x.data();}
+   const float* getS1Y()     const {return s1y.data();}
+   const float* getS2X()     const {return s2x.data();}
+   const float* getS2Y()     const {return s2y.data();}
+
+private:
+   std::vector<float> x;
+   std::vector<float> y;
+   std::vector<float> heading;
+   std::vector<float> s1x;
+   std::vector<float> s1y;
+   std::vector<float> s2x;
+   std::vector<float> s2y;
+   std::vector<float> sign;      // +1 direct, -1 inverse mapping
+
+   std::vector<float> lightX;    // the lights of the current step
+   std::vector<float> lightY;
+   std::vector<float> steer;     // per car sensor difference from the tree
+
+   Kernel   kernel;
+
+   void  calcSensorPos(int i);
+   void  stepRange(const SwarmArrays& arrays, int begin, int end) const;
+};
+
+#endif
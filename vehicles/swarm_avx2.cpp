@@ -0,0 +1,43 @@
+
+// The Swarm step for AVX2, 8 cars at a time.  Only this file is built with
+// -mavx2, Swarm calls it after checking the CPU.
+
+#include "swarmkernel.h"
+
+#include <immintrin.h>
+
+namespace {
+
+struct AVX2Ops
+{
+   typedef __m256 V;
+   typedef __m256 M;
+   static const int WIDTH = 8;
+
+   static inline V load(const float* p)      {return _mm256_loadu_ps(p);}
+   static inline void store(float* p, V v)   {_mm256_storeu_ps(p, v);}
+   static inline V set(float f)              {return _mm256_set1_ps(f);}
+   static inline V add(V a, V b)             {return _mm256_add_ps(a, b);}
+   static inline V sub(V a, V b)             {return _mm256_sub_ps(a, b);}
+   static inline V mul(V a, V b)             {return _mm256_mul_ps(a, b);}
+   static inline V div(V a, V b)             {return _mm256_div_ps(a, b);}
+   static inline V sqrt(V a)                 {return _mm256_sqrt_ps(a);}
+   static inline V min(V a, V b)             {return _mm256_min_ps(a, b);}
+   static inline V max(V a, V b)             {return _mm256_max_ps(a, b);}
+   static inline V trunc(V a)                {return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(a));}
+   static inline M cmpgt(V a, V b)           {return _mm256_cmp_ps(a, b, _CMP_GT_OQ);}
+   static inline M cmpge(V a, V b)           {return _mm256_cmp_ps(a, b, _CMP_GE_OQ);}
+   static inline M cmpeq(V a, V b)           {return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);}
+   static inline V select(M m, V a, V b)     {return _mm256_blendv_ps(b, a, m);}
+   static inline V gather(const float* p, V i) {return _mm256_i32gather_ps(p, _mm256_cvttps_epi32(i), 4);}
+};
+
+}
+
+// cars [begin, end), the vector part only; returns where it stopped
+int swarmStepAVX2(const SwarmArrays& arrays, int begin, int end)
+{
+   int stop = begin + (end - begin) / AVX2Ops::WIDTH * AVX2Ops::WIDTH;
+   SwarmKernel<AVX2Ops>::step(arrays, begin, stop);
+   return stop;
+}
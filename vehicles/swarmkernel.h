@@ -0,0 +1,240 @@
+
+#ifndef SWARMKERNEL_H_
+#define SWARMKERNEL_H_
+
+/*
+ * The Swarm step, written once against a small set of vector operations
+ * and instantiated per instruction set.  Include it only from the Swarm
+ * sources: each of them compiles it for its own instruction set, so the
+ * code lives in an anonymous namespace where the linker cannot merge one
+ * copy into another.
+ *
+ * Ops provides the vector type V and mask type M, WIDTH, and load, store,
+ * set, add, sub, mul, div, sqrt, min, max, trunc, cmpgt, cmpge, cmpeq,
+ * select and gather (by float indexes).  The scalar Ops (WIDTH 1) also
+ * handles the tail of the arrays.
+ */
+
+#include "consts.h"
+
+// A LightField's grid, see lightfield.h
+struct SwarmField {
+   const float*   values;   // NULL: no field, sum the lights
+   float          origin;
+   float          scale;    // 1 / cell size
+   int            cols;
+   int            rows;
+};
+
+// The arrays of the cars being stepped and the lights they see
+struct SwarmArrays {
+   float*         x;
+   float*         y;
+   float*         heading;
+   float*         s1x;
+   float*         s1y;
+   float*         s2x;
+   float*         s2y;
+   const float*   sign;
+   const float*   lightX;
+   const float*   lightY;
+   int            numLights;
+   SwarmField     field;
+   const float*   total;    // per car intensity difference read already, or NULL
+};
+
+// Car rules, see swarm.h
+const float SWARM_MAX_INTENSE  = 100.0f;
+const float SWARM_STEER        = (float) (4 * PI / 180); // per unit of intensity
+const float SWARM_SPEED        = 3.0f;
+// the Car's sensors: 11 pixels ahead, 3 to the side
+const float SWARM_SENSOR_DIST  = 11.0f;
+const float SWARM_SENSOR_COS   = 0.96476382f;             // cos(atan(3 / 11))
+const float SWARM_SENSOR_SIN   = 0.26311741f;             // sin(atan(3 / 11))
+
+namespace {
+
+template <class Ops>
+struct SwarmKernel
+{
+   typedef typename Ops::V V;
+   typedef typename Ops::M M;
+
+   // round down, exact for |v| < 2^31
+   static inline V floor(V v)
+   {
+      V t = Ops::trunc(v);
+      return Ops::select(Ops::cmpgt(t, v), Ops::sub(t, Ops::set(1.0f)), t);
+   }
+
+   // into [-pi, pi)
+   static inline V wrapAngle(V a)
+   {
+      const V twoPi = Ops::set((float) (2 * PI));
+      V turns = floor(Ops::mul(Ops::add(a, Ops::set((float) PI)), Ops::set((float) (0.5 / PI))));
+      return Ops::sub(a, Ops::mul(turns, twoPi));
+   }
+
+   // Cephes-style sine and cosine: a = q pi/2 + r with |r| <= pi/4, a
+   // polynomial for each on r, then swapped and negated by quadrant
+   static inline void sinCos(V a, V& s, V& c)
+   {
+      V q = floor(Ops::add(Ops::mul(a, Ops::set((float) (2 / PI))), Ops::set(0.5f)));
+      V r = Ops::sub(a, Ops::mul(q, Ops::set(1.5703125f)));
+      r = Ops::sub(r, Ops::mul(q, Ops::set(4.837512969970703125e-4f)));
+      r = Ops::sub(r, Ops::mul(q, Ops::set(7.54978995489188216e-8f)));
+      V r2 = Ops::mul(r, r);
+
+      V ps = Ops::set(-1.9515295891e-4f);
+      ps = Ops::add(Ops::mul(ps, r2), Ops::set(8.3321608736e-3f));
+      ps = Ops::add(Ops::mul(ps, r2), Ops::set(-1.6666654611e-1f));
+      ps = Ops::add(Ops::mul(Ops::mul(ps, r2), r), r);
+
+      V pc = Ops::set(2.443315711809948e-5f);
+      pc = Ops::add(Ops::mul(pc, r2), Ops::set(-1.388731625493765e-3f));
+      pc = Ops::add(Ops::mul(pc, r2), Ops::set(4.166664568298827e-2f));
+      pc = Ops::mul(Ops::mul(pc, r2), r2);
+      pc = Ops::add(Ops::sub(pc, Ops::mul(r2, Ops::set(0.5f))), Ops::set(1.0f));
+
+      // quadrant 0..3
+      q = Ops::sub(q, Ops::mul(floor(Ops::mul(q, Ops::set(0.25f))), Ops::set(4.0f)));
+      V half = Ops::mul(floor(Ops::mul(q, Ops::set(0.5f))), Ops::set(2.0f));
+      M odd  = Ops::cmpeq(Ops::sub(q, half), Ops::set(1.0f));
+      V zero = Ops::set(0.0f);
+
+      s = Ops::select(odd, pc, ps);
+      c = Ops::select(odd, ps, pc);
+      s = Ops::select(Ops::cmpge(q, Ops::set(2.0f)), Ops::sub(zero, s), s);
+      V q1 = Ops::add(q, Ops::set(1.0f));
+      q1 = Ops::select(Ops::cmpeq(q1, Ops::set(4.0f)), zero, q1);
+      c = Ops::select(Ops::cmpge(q1, Ops::set(2.0f)), Ops::sub(zero, c), c);
+   }
+
+   // sensors ahead of the car, THETA to either side of its heading
+   static inline void sensors(V px, V py, V s, V c, V& s1x, V& s1y, V& s2x, V& s2y)
+   {
+      const V ct = Ops::set(SWARM_SENSOR_COS);
+      const V st = Ops::set(SWARM_SENSOR_SIN);
+      const V d  = Ops::set(SWARM_SENSOR_DIST);
+      V cosPlus  = Ops::sub(Ops::mul(c, ct), Ops::mul(s, st));
+      V sinPlus  = Ops::add(Ops::mul(s, ct), Ops::mul(c, st));
+      V cosMinus = Ops::add(Ops::mul(c, ct), Ops::mul(s, st));
+      V sinMinus = Ops::sub(Ops::mul(s, ct), Ops::mul(c, st));
+      s1x = Ops::sub(px, Ops::mul(d, cosPlus));
+      s1y = Ops::sub(py, Ops::mul(d, sinPlus));
+      s2x = Ops::sub(px, Ops::mul(d, cosMinus));
+      s2y = Ops::sub(py, Ops::mul(d, sinMinus));
+   }
+
+   static inline V intensity(V sx, V sy, V lx, V ly)
+   {
+      V dx = Ops::sub(sx, lx);
+      V dy = Ops::sub(sy, ly);
+      V dist = Ops::sqrt(Ops::add(Ops::mul(dx, dx), Ops::mul(dy, dy)));
+      return Ops::min(Ops::div(Ops::set(SWARM_MAX_INTENSE), dist), Ops::set(SWARM_MAX_INTENSE));
+   }
+
+   // the field's bilinear interpolation at (px, py), clamped to its grid
+   static inline V lookup(const SwarmField& f, V px, V py)
+   {
+      const V zero = Ops::set(0.0f);
+      V gx = Ops::mul(Ops::sub(px, Ops::set(f.origin)), Ops::set(f.scale));
+      V gy = Ops::mul(Ops::sub(py, Ops::set(f.origin)), Ops::set(f.scale));
+      gx = Ops::min(Ops::max(gx, zero), Ops::set((float) (f.cols - 1)));
+      gy = Ops::min(Ops::max(gy, zero), Ops::set((float) (f.rows - 1)));
+      V ix = Ops::min(floor(gx), Ops::set((float) (f.cols - 2)));
+      V iy = Ops::min(floor(gy), Ops::set((float) (f.rows - 2)));
+      V fx = Ops::sub(gx, ix);
+      V fy = Ops::sub(gy, iy);
+
+      V index = Ops::add(Ops::mul(iy, Ops::set((float) f.cols)), ix);
+      V v00 = Ops::gather(f.values, index);
+      V v10 = Ops::gather(f.values + 1, index);
+      V v01 = Ops::gather(f.values + f.cols, index);
+      V v11 = Ops::gather(f.values + f.cols + 1, index);
+      V top    = Ops::add(v00, Ops::mul(fx, Ops::sub(v10, v00)));
+      V bottom = Ops::add(v01, Ops::mul(fx, Ops::sub(v11, v01)));
+      return Ops::add(top, Ops::mul(fy, Ops::sub(bottom, top)));
+   }
+
+   // cars [begin, end), end - begin a multiple of WIDTH
+   static void step(const SwarmArrays& a, int begin, int end)
+   {
+      const V width  = Ops::set((float) WIDTH);
+      const V height = Ops::set((float) HEIGHT);
+      const V zero   = Ops::set(0.0f);
+
+      for (int i = begin; i < end; i += Ops::WIDTH)
+      {
+         V s1x = Ops::load(a.s1x + i);
+         V s1y = Ops::load(a.s1y + i);
+         V s2x = Ops::load(a.s2x + i);
+         V s2y = Ops::load(a.s2y + i);
+
+         V total = zero;
+         if (a.total)
+            total = Ops::load(a.total + i);
+         else if (a.field.values)
+            total = Ops::sub(lookup(a.field, s2x, s2y), lookup(a.field, s1x, s1y));
+         else for (int j = 0; j < a.numLights; j++)
+         {
+            V lx = Ops::set(a.lightX[j]);
+            V ly = Ops::set(a.lightY[j]);
+            total = Ops::add(total, Ops::sub(intensity(s2x, s2y, lx, ly),
+                                             intensity(s1x, s1y, lx, ly)));
+         }
+
+         V h = Ops::load(a.heading + i);
+         h = Ops::add(h, Ops::mul(Ops::load(a.sign + i), Ops::mul(total, Ops::set(SWARM_STEER))));
+         h = wrapAngle(h);
+         V s, c;
+         sinCos(h, s, c);
+
+         // drive, then wrap around like the Car model
+         V px = Ops::sub(Ops::load(a.x + i), Ops::mul(Ops::set(SWARM_SPEED), c));
+         V py = Ops::sub(Ops::load(a.y + i), Ops::mul(Ops::set(SWARM_SPEED), s));
+         px = Ops::select(Ops::cmpgt(px, width), zero,
+              Ops::select(Ops::cmpge(zero, px), width, px));
+         py = Ops::select(Ops::cmpgt(py, height), zero,
+              Ops::select(Ops::cmpge(zero, py), height, py));
+
+         sensors(px, py, s, c, s1x, s1y, s2x, s2y);
+         Ops::store(a.x + i, px);
+         Ops::store(a.y + i, py);
+         Ops::store(a.heading + i, h);
+         Ops::store(a.s1x + i, s1x);
+         Ops::store(a.s1y + i, s1y);
+         Ops::store(a.s2x + i, s2x);
+         Ops::store(a.s2y + i, s2y);
+      }
+   }
+};
+
+// One float at a time: the fallback and the tail of the vector kernels
+struct ScalarOps
+{
+   typedef float V;
+   typedef bool  M;
+   static const int WIDTH = 1;
+
+   static inline V load(const float* p)      {return *p;}
+   static inline void store(float* p, V v)   {*p = v;}
+   static inline V set(float f)              {return f;}
+   static inline V add(V a, V b)             {return a + b;}
+   static inline V sub(V a, V b)             {return a - b;}
+   static inline V mul(V a, V b)             {return a * b;}
+   static inline V div(V a, V b)             {return a / b;}
+   static inline V sqrt(V a)                 {return __builtin_sqrtf(a);}
+   static inline V min(V a, V b)             {return a < b ? a : b;}  // as minps
+   static inline V max(V a, V b)             {return a > b ? a : b;}  // as maxps
+   static inline V trunc(V a)                {return (float) (int) a;}
+   static inline M cmpgt(V a, V b)           {return a > b;}
+   static inline M cmpge(V a, V b)           {return a >= b;}
+   static inline M cmpeq(V a, V b)           {return a == b;}
+   static inline V select(M m, V a, V b)     {return m ? a : b;}
+   static inline V gather(const float* p, V i) {return p[(int) i];}
+};
+
+}
+
+#endif
@@ -0,0 +1,159 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+using namespace std;
+
+static unsigned long long packRange(unsigned int front, unsigned int back)
+{
+   return ((unsigned long long) front << 32) | back;
+}
+
+static unsigned int rangeFront(unsigned long long range) {return range >> 32;}
+static unsigned int rangeBack(unsigned long long range)  {return range & 0xFFFFFFFFu;}
+
+
+ThreadPool::ThreadPool(int threads)
+: numThreads(threads > 0 ? threads : max(1u, thread::hardware_concurrency())),
+job(NULL),
+generation(0),
+running(0),
+stopping(false),
+shares(numThreads),
+steals(0)
+{
+   // the caller is worker 0
+   for (int i = 1; i < numThreads; i++)
+      workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      unique_lock<mutex> guard(lock);
+      stopping = true;
+   }
+   wake.notify_all();
+   for (int i = 0; i < workers.size(); i++)
+      workers[i].join();
+}
+
+void ThreadPool::workerLoop(int worker)
+{
+   unsigned long seen = 0;
+   while (true)
+   {
+      const function<void(int)>* current;
+      {
+         unique_lock<mutex> guard(lock);
+         while (!stopping && generation == seen)
+            wake.wait(guard);
+         if (stopping)
+            return;
+         seen    = generation;
+         current = job;
+      }
+
+      (*current)(worker);
+
+      {
+         unique_lock<mutex> guard(lock);
+         if (--running == 0)
+            finished.notify_one();
+      }
+   }
+}
+
+void ThreadPool::run(const function<void(int)>& _job)
+{
+   if (numThreads == 1)
+   {
+      _job(0);
+      return;
+   }
+
+   {
+      unique_lock<mutex> guard(lock);
+      job     = &_job;
+      running = numThreads - 1;
+      generation++;
+   }
+   wake.notify_all();
+
+   _job(0);
+
+   unique_lock<mutex> guard(lock);
+   while (running > 0)
+      finished.wait(guard);
+}
+
+// The front chunk of the worker's own share
+bool ThreadPool::takeChunk(int worker, int& chunk)
+{
+   atomic<unsigned long long>& range = shares[worker].range;
+   unsigned long long current = range.load();
+   while (rangeFront(current) < rangeBack(current))
+   {
+      if (range.compare_exchange_weak(current, packRange(rangeFront(current) + 1,
+                                                         rangeBack(current))))
+      {
+         chunk = rangeFront(current);
+         return true;
+      }
+   }
+   return false;
+}
+
+// Move the back half of the next non-empty share into the worker's own,
+// which is empty; false once every share is
+bool ThreadPool::steal(int worker)
+{
+   for (int i = 1; i < numThreads; i++)
+   {
+      atomic<unsigned long long>& victim = shares[(worker + i) % numThreads].range;
+      unsigned long long current = victim.load();
+      while (rangeFront(current) < rangeBack(current))
+      {
+         unsigned int front = rangeFront(current);
+         unsigned int back  = rangeBack(current);
+         unsigned int mid   = front + (back - front) / 2;
+         if (victim.compare_exchange_weak(current, packRange(front, mid)))
+         {
+            shares[worker].range.store(packRange(mid, back));
+            steals += back - mid;
+            return true;
+         }
+      }
+   }
+   return false;
+}
+
+void ThreadPool::parallelFor(int n, int grain,
+                             const function<void(int, int, int)>& body)
+{
+   grain = max(1, grain);
+   if (n <= grain || numThreads == 1)
+   {
+      if (n > 0)
+         body(0, n, 0);
+      return;
+   }
+
+   int chunks = (n + grain - 1) / grain;
+   for (int w = 0; w < numThreads; w++)
+      shares[w].range.store(packRange((long long) chunks * w / numThreads,
+                                      (long long) chunks * (w + 1) / numThreads));
+
+   function<void(int)> job = [&](int worker) {
+      int chunk;
+      do
+      {
+         while (takeChunk(worker, chunk))
+         {
+            int begin = chunk * grain;
+            body(begin, min(n, begin + grain), worker);
+         }
+      } while (steal(worker));
+   };
+   run(job);
+}
@@ -0,0 +1,68 @@
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Fixed set of worker threads for the simulation step.
+ *
+ * run() hands the same job to every thread (the caller takes part as
+ * worker 0) and returns once all of them are done, so the threads are
+ * created once and reused every tick.
+ *
+ * parallelFor() gives each worker an equal share of the chunks up front.
+ * A worker that runs out steals the back half of another's remaining
+ * share, so one slow core does not hold up the tick, while the common
+ * case touches nothing but the worker's own share.
+ */
+class ThreadPool
+{
+public:
+   // threads <= 0 uses one per hardware thread
+   ThreadPool(int threads = 0);
+   ~ThreadPool();
+
+   int   size() const {return numThreads;}
+
+   void  run(const std::function<void(int)>& job);
+
+   // body(begin, end, worker) over [0, n) in chunks of grain items
+   void  parallelFor(int n, int grain,
+                     const std::function<void(int, int, int)>& body);
+
+   // chunks taken from another worker's share, since the pool was made
+   long long numSteals() const {return steals.load();}
+
+private:
+   int                        numThreads;
+   std::vector<std::thread>   workers;
+
+   std::mutex                 lock;
+   std::condition_variable    wake;
+   std::condition_variable    finished;
+   const std::function<void(int)>* job;
+   unsigned long              generation; // bumped for every run()
+   int                        running;    // workers still busy with a job
+   bool                       stopping;
+
+   // per worker, the chunks [front, back) not taken yet as front << 32 | back,
+   // each on its own cache line
+   struct Share {
+      std::atomic<unsigned long long> range;
+      char  pad[64 - sizeof(std::atomic<unsigned long long>)];
+   };
+   std::vector<Share>         shares;
+   std::atomic<long long>     steals;
+
+   void  workerLoop(int worker);
+   bool  takeChunk(int worker, int& chunk);
+   bool  steal(int worker);
+};
+
+#endif
@@ -0,0 +1,347 @@
+#include "trajectory.h"
+#include "swarm.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+const char TRAJECTORY_MAGIC[8] = {'V', 'E', 'H', 'T', 'R', 'A', 'J', '\0'};
+
+// ticks the simulation can run ahead of the writer before they are dropped
+const int TRAJECTORY_STAGED = 4;
+// the frames start on their own cache line
+const size_t TRAJECTORY_HEADER_SIZE = 64;
+const uint64_t TRAJECTORY_REWRITING = ~(uint64_t) 0;
+
+namespace {
+
+size_t slotBytes(int maxCars, int maxLights)
+{
+   size_t bytes = sizeof(TrajectoryFrameHeader) + maxCars * sizeof(TrajectoryCar) +
+                  maxLights * sizeof(TrajectoryLight);
+   return (bytes + 7) / 8 * 8;
+}
+
+uint16_t quantize(float value, float scale)
+{
+   float q = floor(value * scale + 0.5f);
+   return (uint16_t) min(max(q, 0.0f), 65535.0f);
+}
+
+}
+
+
+TrajectoryRecorder::TrajectoryRecorder()
+: fd(-1),
+mapSize(0),
+header(NULL),
+slots(NULL),
+stopping(false),
+waiting(false),
+ticks(0),
+recorded(0),
+dropped(0)
+{
+}
+
+TrajectoryRecorder::~TrajectoryRecorder()
+{
+   close();
+}
+
+bool TrajectoryRecorder::open(const string& path, int maxCars, int maxLights, int numSlots)
+{
+   close();
+   maxCars   = max(maxCars, 0);
+   maxLights = max(maxLights, 0);
+   numSlots  = max(numSlots, 1);
+
+   size_t slotSize = slotBytes(maxCars, maxLights);
+   mapSize = TRAJECTORY_HEADER_SIZE + slotSize * numSlots;
+
+   fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0)
+   {
+      cout << "ERROR: cannot create " << path << ": " << strerror(errno) << endl;
+      return false;
+   }
+   if (ftruncate(fd, mapSize) != 0)
+   {
+      cout << "ERROR: cannot size " << path << ": " << strerror(errno) << endl;
+      ::close(fd);
+      fd = -1;
+      return false;
+   }
+   void* map = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   if (map == MAP_FAILED)
+   {
+      cout << "ERROR: cannot map " << path << ": " << strerror(errno) << endl;
+      ::close(fd);
+      fd = -1;
+      return false;
+   }
+
+   // a fresh file reads as zeros, so no slot claims a frame yet
+   header = (TrajectoryHeader*) map;
+   slots  = (char*) map + TRAJECTORY_HEADER_SIZE;
+   header->version   = TRAJECTORY_VERSION;
+   header->maxCars   = maxCars;
+   header->maxLights = maxLights;
+   header->numSlots  = numSlots;
+   header->slotSize  = slotSize;
+   header->framesWritten.store(0);
+   for (int i = 0; i < numSlots; i++)
+      ((TrajectoryFrameHeader*) (slots + (size_t) i * slotSize))->frame.store(TRAJECTORY_REWRITING);
+   // the magic last: a reader never sees a half made header
+   atomic_thread_fence(memory_order_release);
+   memcpy(header->magic, TRAJECTORY_MAGIC, sizeof(header->magic));
+
+   staged.assign(TRAJECTORY_STAGED, Staged());
+   spare.clear();
+   queued.clear();
+   for (int i = 0; i < TRAJECTORY_STAGED; i++)
+      spare.push_back(i);
+   stopping = false;
+   ticks    = 0;
+   recorded = 0;
+   dropped  = 0;
+   writer = thread(&TrajectoryRecorder::writerLoop, this);
+   return true;
+}
+
+void TrajectoryRecorder::close()
+{
+   if (!header)
+      return;
+   {
+      lock_guard<mutex> guard(lock);
+      stopping = true;
+   }
+   wake.notify_all();
+   writer.join();
+
+   msync(header, mapSize, MS_ASYNC);
+   munmap(header, mapSize);
+   ::close(fd);
+   header = NULL;
+   slots  = NULL;
+   fd     = -1;
+}
+
+void TrajectoryRecorder::record(const Swarm& swarm, const Lights& lights)
+{
+   if (!header)
+      return;
+   uint64_t tick = ticks++;
+
+   int index;
+   {
+      unique_lock<mutex> guard(lock);
+      if (waiting)
+         freed.wait(guard, [this] {return !spare.empty();});
+      if (spare.empty())
+      {
+         dropped++;
+         return;
+      }
+      index = spare.back();
+      spare.pop_back();
+   }
+
+   // only the copies run on the simulation's thread, into buffers that
+   // keep their capacity from tick to tick
+   Staged& frame = staged[index];
+   int cars = min(swarm.size(), (int) header->maxCars);
+   frame.tick = tick;
+   frame.x.assign(swarm.getX(), swarm.getX() + cars);
+   frame.y.assign(swarm.getY(), swarm.getY() + cars);
+   frame.heading.assign(swarm.getHeading(), swarm.getHeading() + cars);
+   frame.sign.assign(swarm.getSign(), swarm.getSign() + cars);
+   frame.lights.assign(lights.begin(),
+                       lights.begin() + min((int) lights.size(), (int) header->maxLights));
+
+   {
+      lock_guard<mutex> guard(lock);
+      queued.push_back(index);
+   }
+   wake.notify_one();
+}
+
+void TrajectoryRecorder::writerLoop()
+{
+   unique_lock<mutex> guard(lock);
+   while (true)
+   {
+      wake.wait(guard, [this] {return stopping || !queued.empty();});
+      if (queued.empty())
+         return;   // stopping, and everything is written
+      int index = queued.front();
+      queued.erase(queued.begin());
+
+      guard.unlock();
+      writeFrame(staged[index]);
+      guard.lock();
+      spare.push_back(index);
+      freed.notify_one();
+   }
+}
+
+// The slot is marked as being rewritten while its contents change, so a
+// reader that copied it meanwhile sees the mark and throws the copy away
+void TrajectoryRecorder::writeFrame(const Staged& frame)
+{
+   uint64_t number = header->framesWritten.load(memory_order_relaxed);
+   char* slot = slots + (size_t) (number % header->numSlots) * header->slotSize;
+   TrajectoryFrameHeader* frameHeader = (TrajectoryFrameHeader*) slot;
+   frameHeader->frame.store(TRAJECTORY_REWRITING, memory_order_relaxed);
+   atomic_thread_fence(memory_order_release);
+
+   frameHeader->tick      = frame.tick;
+   frameHeader->numCars   = frame.x.size();
+   frameHeader->numLights = frame.lights.size();
+
+   const float headingScale = 65536 / (2 * (float) PI);
+   TrajectoryCar* cars = (TrajectoryCar*) (slot + sizeof(TrajectoryFrameHeader));
+   for (int i = 0; i < frame.x.size(); i++)
+   {
+      cars[i].x       = quantize(frame.x[i], 16);
+      cars[i].y       = quantize(frame.y[i], 16);
+      // wraps around at pi
+      cars[i].heading = (uint16_t) (int) floor((frame.heading[i] + (float) PI) * headingScale + 0.5f);
+      cars[i].flags   = frame.sign[i] > 0 ? TRAJECTORY_DIRECT : 0;
+   }
+   TrajectoryLight* lights = (TrajectoryLight*) (cars + header->maxCars);
+   for (int j = 0; j < frame.lights.size(); j++)
+   {
+      lights[j].x = quantize(frame.lights[j].X, 1);
+      lights[j].y = quantize(frame.lights[j].Y, 1);
+   }
+
+   frameHeader->frame.store(number, memory_order_release);
+   header->framesWritten.store(number + 1, memory_order_release);
+   recorded++;
+}
+
+
+TrajectoryReader::TrajectoryReader()
+: fd(-1),
+mapSize(0),
+header(NULL),
+slots(NULL)
+{
+}
+
+TrajectoryReader::~TrajectoryReader()
+{
+   close();
+}
+
+bool TrajectoryReader::open(const string& path)
+{
+   close();
+   fd = ::open(path.c_str(), O_RDONLY);
+   if (fd < 0)
+   {
+      cout << "ERROR: cannot open " << path << ": " << strerror(errno) << endl;
+      return false;
+   }
+   struct stat info;
+   void* map = MAP_FAILED;
+   if (fstat(fd, &info) == 0 && info.st_size >= TRAJECTORY_HEADER_SIZE)
+      map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   if (map == MAP_FAILED)
+   {
+      cout << "ERROR: cannot map " << path << endl;
+      ::close(fd);
+      fd = -1;
+      return false;
+   }
+
+   const TrajectoryHeader* h = (const TrajectoryHeader*) map;
+   if (memcmp(h->magic, TRAJECTORY_MAGIC, sizeof(h->magic)) != 0 ||
+       h->version != TRAJECTORY_VERSION ||
+       h->slotSize < slotBytes(h->maxCars, h->maxLights) ||
+       TRAJECTORY_HEADER_SIZE + (size_t) h->slotSize * h->numSlots > (size_t) info.st_size)
+   {
+      cout << "ERROR: " << path << " is not a vehicles trajectory" << endl;
+      munmap(map, info.st_size);
+      ::close(fd);
+      fd = -1;
+      return false;
+   }
+   atomic_thread_fence(memory_order_acquire);
+
+   mapSize = info.st_size;
+   header  = h;
+   slots   = (const char*) map + TRAJECTORY_HEADER_SIZE;
+   return true;
+}
+
+void TrajectoryReader::close()
+{
+   if (!header)
+      return;
+   munmap((void*) header, mapSize);
+   ::close(fd);
+   header = NULL;
+   slots  = NULL;
+   fd     = -1;
+}
+
+long long TrajectoryReader::firstFrame() const
+{
+   if (!header)
+      return 0;
+   long long end = header->framesWritten.load(memory_order_acquire);
+   return max(0LL, end - (long long) header->numSlots);
+}
+
+long long TrajectoryReader::endFrame() const
+{
+   return header ? header->framesWritten.load(memory_order_acquire) : 0;
+}
+
+bool TrajectoryReader::read(long long number, TrajectoryFrame& out) const
+{
+   if (!header || number < firstFrame() || number >= endFrame())
+      return false;
+
+   const char* slot = slots + (size_t) (number % header->numSlots) * header->slotSize;
+   const TrajectoryFrameHeader* frameHeader = (const TrajectoryFrameHeader*) slot;
+   if (frameHeader->frame.load(memory_order_acquire) != (uint64_t) number)
+      return false;
+
+   int numCars   = min(frameHeader->numCars, header->maxCars);
+   int numLights = min(frameHeader->numLights, header->maxLights);
+   out.tick = frameHeader->tick;
+   out.x.resize(numCars);
+   out.y.resize(numCars);
+   out.heading.resize(numCars);
+   out.direct.resize(numCars);
+   out.lights.resize(numLights);
+
+   const float headingScale = 2 * (float) PI / 65536;
+   const TrajectoryCar* cars = (const TrajectoryCar*) (slot + sizeof(TrajectoryFrameHeader));
+   for (int i = 0; i < numCars; i++)
+   {
+      out.x[i]       = cars[i].x / 16.0f;
+      out.y[i]       = cars[i].y / 16.0f;
+      out.heading[i] = cars[i].heading * headingScale - (float) PI;
+      out.direct[i]  = cars[i].flags & TRAJECTORY_DIRECT;
+   }
+   const TrajectoryLight* lights = (const TrajectoryLight*) (cars + header->maxCars);
+   for (int j = 0; j < numLights; j++)
+      out.lights[j] = Light(lights[j].x, lights[j].y);
+
+   // still the same frame, or the recorder went round and rewrote it
+   atomic_thread_fence(memory_order_acquire);
+   return frameHeader->frame.load(memory_order_relaxed) == (uint64_t) number;
+}
@@ -0,0 +1,167 @@
+
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include "consts.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Swarm;
+
+/*
+ * Binary recording of the swarm, tick by tick, for offline analysis and
+ * replay.
+ *
+ * The file is a ring of fixed size frame slots behind a header and is
+ * memory mapped, so it always holds the last numSlots ticks and a reader
+ * can follow a recording while it is being written.  A car takes 8 bytes:
+ * position in 1/16 pixels, heading in 1/65536 turns and its mapping.  A
+ * light takes 4 bytes, its position in pixels.
+ *
+ * TrajectoryRecorder::record() only copies the tick's arrays into a spare
+ * buffer and wakes the writer thread, which quantizes the frame into the
+ * mapping.  When the writer is behind and no buffer is spare the tick is
+ * dropped instead of stalling the simulation; frame ticks show the gap.
+ * Headless runs can have record() wait for the writer instead.
+ */
+
+// on disk, in host byte order
+struct TrajectoryHeader {
+   char     magic[8];     // TRAJECTORY_MAGIC
+   uint32_t version;
+   uint32_t maxCars;      // per frame, the rest of a tick's cars are cut
+   uint32_t maxLights;
+   uint32_t numSlots;
+   uint32_t slotSize;     // bytes per frame slot
+   uint32_t reserved;
+   std::atomic<uint64_t> framesWritten;   // the last numSlots are in the ring
+};
+
+struct TrajectoryFrameHeader {
+   // sequence number, frame % numSlots is the slot; all ones while the
+   // slot is being rewritten
+   std::atomic<uint64_t> frame;
+   uint64_t tick;         // simulation ticks since recording started
+   uint32_t numCars;
+   uint32_t numLights;
+};
+
+struct TrajectoryCar {
+   uint16_t x;            // 1/16 pixel
+   uint16_t y;
+   uint16_t heading;      // 1/65536 turn from -pi
+   uint16_t flags;        // TRAJECTORY_DIRECT
+};
+
+struct TrajectoryLight {
+   uint16_t x;            // pixels
+   uint16_t y;
+};
+
+extern const char TRAJECTORY_MAGIC[8];
+const uint32_t TRAJECTORY_VERSION = 1;
+const uint16_t TRAJECTORY_DIRECT  = 1;
+
+
+// one decoded tick
+struct TrajectoryFrame {
+   uint64_t tick;
+   std::vector<float> x;
+   std::vector<float> y;
+   std::vector<float> heading;   // radians in [-pi, pi)
+   std::vector<bool>  direct;
+   Lights   lights;
+};
+
+
+class TrajectoryRecorder
+{
+public:
+   TrajectoryRecorder();
+   ~TrajectoryRecorder();
+
+   // a new file of numSlots frames, replacing any old one
+   bool  open(const std::string& path, int maxCars, int maxLights, int numSlots);
+   // writes out what is queued, then unmaps the file
+   void  close();
+   bool  isOpen() const {return header != NULL;}
+
+   // queue this tick for the writer; unless waiting is on, a tick with
+   // no spare buffer is dropped rather than waiting for one
+   void  record(const Swarm& swarm, const Lights& lights);
+   void  setWait(bool wait)   {waiting = wait;}
+
+   long long numRecorded() const {return recorded.load();}
+   long long numDropped()  const {return dropped.load();}
+
+private:
+   // a tick copied out of the simulation, waiting for the writer
+   struct Staged {
+      uint64_t tick;
+      std::vector<float> x;
+      std::vector<float> y;
+      std::vector<float> heading;
+      std::vector<float> sign;
+      Lights   lights;
+   };
+
+   int                  fd;
+   size_t               mapSize;
+   TrajectoryHeader*    header;
+   char*                slots;
+
+   std::vector<Staged>  staged;
+   std::vector<int>     spare;      // staged buffers free to fill
+   std::vector<int>     queued;     // filled, in tick order
+   std::mutex           lock;
+   std::condition_variable wake;
+   std::condition_variable freed;   // a staged buffer is spare again
+   std::thread          writer;
+   bool                 stopping;
+   bool                 waiting;  // record() waits for a spare buffer
+
+   uint64_t                ticks;
+   std::atomic<long long>  recorded;
+   std::atomic<long long>  dropped;
+
+   void  writerLoop();
+   void  writeFrame(const Staged& frame);
+};
+
+
+class TrajectoryReader
+{
+public:
+   TrajectoryReader();
+   ~TrajectoryReader();
+
+   bool  open(const std::string& path);
+   void  close();
+   bool  isOpen() const {return header != NULL;}
+
+   // frames [firstFrame, endFrame) are in the file; both move on while a
+   // recorder is still writing
+   long long firstFrame() const;
+   long long endFrame() const;
+
+   // false if the frame is not in the ring (any more)
+   bool  read(long long frame, TrajectoryFrame& out) const;
+
+   int   getMaxCars()  const {return header ? header->maxCars : 0;}
+   int   getNumSlots() const {return header ? header->numSlots : 0;}
+
+private:
+   int                  fd;
+   size_t               mapSize;
+   const TrajectoryHeader* header;
+   const char*          slots;
+};
+
+#endif
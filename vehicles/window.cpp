@@ -4,6 +4,7 @@
 #include "canvas.h"
 #include "canvaswidget.h"
 #include "manager.h"
+#include "simulation.h"
 
 #include <QLabel>
 #include <QDebug>
@@ -39,9 +40,12 @@ manager(_manager)
    updateCarBox();
    updateLightBox();
 
-   // Start animating
+   // The simulation ticks every 30 ms on its own thread, the timer only
+   // repaints whatever tick it has reached
+   simulation->setInterval(30);
+   simulation->start();
    QTimer* timer = new QTimer(this);
-	timer->setInterval(30);	//miliseconds
+	timer->setInterval(16);	//miliseconds
    connect(timer, SIGNAL(timeout()), this, SLOT(windowAnimate()));
    timer->start();
 
@@ -50,16 +54,18 @@ manager(_manager)
 
 Window::~Window()
 {
+   simulation->stop();
+   // the widget releases its GL buffers through the canvas
+   delete canvasWidget;
    delete canvas;
+   delete simulation;
 }
 
 void Window::windowAnimate()
 {
-   // move each car based on positions of light sources
-	manager->timeStep();
    // update the combo boxes
    //updateComboBoxes();
-   // draw the new positions
+   // draw the latest positions
 	canvasWidget->animate();
 }
 
@@ -99,7 +105,8 @@ void Window::initCanvas()
 {
    if (!manager)
       manager   = new Manager();
-   canvas       = new Canvas(manager);
+   simulation   = new Simulation(manager);
+   canvas       = new Canvas(simulation);
    canvasWidget = new CanvasWidget(canvas, this);
 }
 
@@ -139,7 +146,8 @@ QWidget* Window::initControlPanel()
 void Window::updateCarBox()
 {
    carComboBox->clear();
-   for (int i = 0; i < manager->numCars(); i++)
+   int cars = simulation->latest().numCars();
+   for (int i = 0; i < cars; i++)
    {
       QString name = "Car " + QString::number(i);
       carComboBox->addItem(name);
@@ -149,7 +157,8 @@ void Window::updateCarBox()
 void Window::updateLightBox()
 {
    lightComboBox->clear();
-   for (int i = 0; i < manager->numLights(); i++)
+   int lights = simulation->latest().lights.size();
+   for (int i = 0; i < lights; i++)
    {
       QString name = "Light " + QString::number(i);
       lightComboBox->addItem(name);
@@ -161,19 +170,23 @@ void Window::carSelected(int index)
    // TODO: DONE: update X and Y
    // TODO: enable/disable delete button (disable if top/empty selected)
    // TODO: change text of create/modify button (modify = apply?)
-   Car car = manager->getCar(index);
+   const Snapshot& snapshot = simulation->latest();
+   if (index < 0 || index >= snapshot.numCars())
+      return;
 
-   carSpinX->setValue(car.getX());
-   carSpinY->setValue(car.getY());
-   directBox->setChecked(car.getDirect());
+   carSpinX->setValue(snapshot.x[index]);
+   carSpinY->setValue(snapshot.y[index]);
+   directBox->setChecked(snapshot.sign[index] > 0);
 }
 
 void Window::lightSelected(int index)
 {
-   Car car = manager->getCar(index);
+   const Snapshot& snapshot = simulation->latest();
+   if (index < 0 || index >= snapshot.lights.size())
+      return;
 
-   lightSpinX->setValue(car.getX());
-   lightSpinY->setValue(car.getY());
+   lightSpinX->setValue(snapshot.lights[index].X);
+   lightSpinY->setValue(snapshot.lights[index].Y);
 }
 
 void Window::setCheckBoxText(int state)
@@ -195,9 +208,13 @@ void Window::createCarClicked()
    bool direct = directBox->isChecked();
 
    Car car(Position(x, y), direct);
-   manager->addNewCar(car);
+   int cars = 0;
+   simulation->edit([&](Manager& m) {
+      m.addNewCar(car);
+      cars = m.numCars();
+   });
 
-   QString name = "Car " + QString::number(manager->numCars());
+   QString name = "Car " + QString::number(cars);
    carComboBox->addItem(name);
 }
 
@@ -211,9 +228,13 @@ void Window::createLightClicked()
    int y = lightSpinY->value();
    
    Light light(x, y);
-   manager->addNewLight(light);
+   int lights = 0;
+   simulation->edit([&](Manager& m) {
+      m.addNewLight(light);
+      lights = m.numLights();
+   });
 
-   QString name = "Light " + QString::number(manager->numLights());
+   QString name = "Light " + QString::number(lights);
    lightComboBox->addItem(name);
 }
 
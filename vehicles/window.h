@@ -16,6 +16,7 @@
 class Canvas;
 class CanvasWidget;
 class Manager;
+class Simulation;
 
 class Window : public QWidget
 {
@@ -60,6 +61,7 @@ private:
    Canvas*        canvas;
    CanvasWidget*  canvasWidget;
 	Manager*			manager;
+   Simulation*    simulation;   // steps the manager on its own thread
 
    // Qt CSS-like style sheet
    QString        controlPanelStyle;